@@ -0,0 +1,233 @@
+#include "air_quality.h"
+#include "sd_logger.h"
+#include "num_format.h"
+#include "config.h"
+
+#define NOWCAST_HOURS 12
+
+// ===================== RTC state =====================
+// Hourly PM sums for NowCast; index 0 is the current hour
+struct HourBuckets {
+  float   sum[NOWCAST_HOURS];
+  uint8_t samples[NOWCAST_HOURS];
+};
+RTC_DATA_ATTR static HourBuckets pm25Hours;
+RTC_DATA_ATTR static HourBuckets pm10Hours;
+RTC_DATA_ATTR static time_t      currentHour = 0;
+
+// Alert state for hysteresis and the previous cycle for rise detection
+RTC_DATA_ATTR static bool  co2Alert = false;
+RTC_DATA_ATTR static bool  pm25Alert = false;
+RTC_DATA_ATTR static bool  havePreviousCo2 = false;
+RTC_DATA_ATTR static bool  havePreviousPm25 = false;
+RTC_DATA_ATTR static float previousCo2 = 0;
+RTC_DATA_ATTR static float previousPm25 = 0;
+
+// ===================== AQI =====================
+
+struct AqiBreakpoint {
+  float   cLow, cHigh;
+  int16_t iLow, iHigh;
+};
+
+// US EPA breakpoints (PM2.5 as revised in 2024)
+static const AqiBreakpoint PM25_BREAKPOINTS[] = {
+  {   0.0,   9.0,   0,  50 },
+  {   9.1,  35.4,  51, 100 },
+  {  35.5,  55.4, 101, 150 },
+  {  55.5, 125.4, 151, 200 },
+  { 125.5, 225.4, 201, 300 },
+  { 225.5, 325.4, 301, 500 },
+};
+
+static const AqiBreakpoint PM10_BREAKPOINTS[] = {
+  {   0,  54,   0,  50 },
+  {  55, 154,  51, 100 },
+  { 155, 254, 101, 150 },
+  { 255, 354, 151, 200 },
+  { 355, 424, 201, 300 },
+  { 425, 604, 301, 500 },
+};
+
+static int16_t aqiFromTable(float c, const AqiBreakpoint *table, size_t n) {
+  if (c < 0) c = 0;
+  for (size_t i = 0; i < n; i++) {
+    const AqiBreakpoint &bp = table[i];
+    if (c <= bp.cHigh) {
+      if (c < bp.cLow) c = bp.cLow; // gap between truncated ranges
+      float aqi = (bp.iHigh - bp.iLow) / (bp.cHigh - bp.cLow) * (c - bp.cLow) + bp.iLow;
+      return (int16_t)lroundf(aqi);
+    }
+  }
+  return 500;
+}
+
+int16_t aqiFromPm25(float ugm3) {
+  // EPA truncates PM2.5 to 0.1 µg/m³ before the lookup
+  return aqiFromTable(floorf(ugm3 * 10.0f) / 10.0f, PM25_BREAKPOINTS,
+                      sizeof(PM25_BREAKPOINTS) / sizeof(PM25_BREAKPOINTS[0]));
+}
+
+int16_t aqiFromPm10(float ugm3) {
+  // ...and PM10 to whole µg/m³
+  return aqiFromTable(floorf(ugm3), PM10_BREAKPOINTS,
+                      sizeof(PM10_BREAKPOINTS) / sizeof(PM10_BREAKPOINTS[0]));
+}
+
+// ===================== NowCast =====================
+
+static void shiftHours(HourBuckets &b, time_t shift) {
+  for (int i = NOWCAST_HOURS - 1; i >= 0; i--) {
+    int from = i - (int)shift;
+    b.sum[i] = (from >= 0) ? b.sum[from] : 0;
+    b.samples[i] = (from >= 0) ? b.samples[from] : 0;
+  }
+}
+
+// Moves the window to the hour of timestamp, leaving empty buckets for hours
+// with no data
+static void advanceHours(time_t timestamp) {
+  time_t hour = timestamp / 3600;
+  if (hour == currentHour) return;
+
+  time_t shift = hour - currentHour;
+  if (shift < 0 || shift >= NOWCAST_HOURS || currentHour == 0) shift = NOWCAST_HOURS;
+  shiftHours(pm25Hours, shift);
+  shiftHours(pm10Hours, shift);
+  currentHour = hour;
+}
+
+static void addToHour(HourBuckets &b, float value) {
+  b.sum[0] += value;
+  if (b.samples[0] < 255) b.samples[0]++;
+}
+
+// EPA NowCast over the hourly averages; returns false if fewer than 2 of the
+// 3 most recent hours have data
+static bool nowcast(const HourBuckets &b, float &result) {
+  int recent = 0;
+  for (int i = 0; i < 3; i++) {
+    if (b.samples[i] > 0) recent++;
+  }
+  if (recent < 2) return false;
+
+  float cMin = 1e30f, cMax = 0;
+  for (int i = 0; i < NOWCAST_HOURS; i++) {
+    if (b.samples[i] == 0) continue;
+    float c = b.sum[i] / b.samples[i];
+    if (c < cMin) cMin = c;
+    if (c > cMax) cMax = c;
+  }
+
+  float w = (cMax > 0) ? cMin / cMax : 1.0f;
+  if (w < 0.5f) w = 0.5f;
+
+  float num = 0, den = 0, weight = 1;
+  for (int i = 0; i < NOWCAST_HOURS; i++) {
+    if (b.samples[i] > 0) {
+      num += weight * (b.sum[i] / b.samples[i]);
+      den += weight;
+    }
+    weight *= w;
+  }
+  result = num / den;
+  return true;
+}
+
+// NowCast for one pollutant, falling back to this cycle's average early on;
+// false if there is neither
+static bool pmConcentration(HourBuckets &b, bool present, float value, float &result) {
+  if (present) addToHour(b, value);
+  if (nowcast(b, result)) return true;
+  result = value;
+  return present;
+}
+
+// ===================== Events =====================
+
+// Raises `on` when value crosses `high` upwards and `off` when it falls back below `low`
+static uint8_t thresholdEvent(float value, float high, float low, bool &alert,
+                              uint8_t on, uint8_t off) {
+  if (!alert && value >= high) {
+    alert = true;
+    return on;
+  }
+  if (alert && value < low) {
+    alert = false;
+    return off;
+  }
+  return 0;
+}
+
+// Rise since the previous cycle; a cycle without the channel restarts it
+static bool riseEvent(bool present, float value, float rise, bool &havePrevious,
+                      float &previous) {
+  bool rose = present && havePrevious && value - previous >= rise;
+  havePrevious = present;
+  previous = value;
+  return rose;
+}
+
+const char *airQualityEventName(uint8_t bit) {
+  switch (bit) {
+    case AQ_EVT_CO2_HIGH:    return "co2_high";
+    case AQ_EVT_CO2_NORMAL:  return "co2_normal";
+    case AQ_EVT_PM25_HIGH:   return "pm2_5_high";
+    case AQ_EVT_PM25_NORMAL: return "pm2_5_normal";
+    case AQ_EVT_CO2_RISE:    return "co2_rise";
+    case AQ_EVT_PM25_RISE:   return "pm2_5_rise";
+    default:                 return "unknown";
+  }
+}
+
+// ===================== Analysis =====================
+
+void analyzeAirQuality(time_t timestamp, const MeasurementData &data, uint32_t channels,
+                       AirQualityResult &result) {
+  unsigned long start = micros();
+
+  bool hasCo2 = channels & CHANNEL_BIT(co2);
+  bool hasPm25 = channels & CHANNEL_BIT(pm25);
+  bool hasPm10 = channels & CHANNEL_BIT(pm10);
+
+  advanceHours(timestamp);
+  bool pm25Known = pmConcentration(pm25Hours, hasPm25, data.pm25, result.nowcastPm25);
+  bool pm10Known = pmConcentration(pm10Hours, hasPm10, data.pm10, result.nowcastPm10);
+  result.aqi = -1;
+  if (pm25Known) result.aqi = aqiFromPm25(result.nowcastPm25);
+  if (pm10Known) result.aqi = max(result.aqi, aqiFromPm10(result.nowcastPm10));
+
+  // Missing channels leave the alerts as they were
+  uint8_t events = 0;
+  if (hasCo2) {
+    events |= thresholdEvent(data.co2, CO2_ALERT_PPM, CO2_CLEAR_PPM, co2Alert,
+                             AQ_EVT_CO2_HIGH, AQ_EVT_CO2_NORMAL);
+  }
+  if (hasPm25) {
+    events |= thresholdEvent(data.pm25, PM25_ALERT_UGM3, PM25_CLEAR_UGM3, pm25Alert,
+                             AQ_EVT_PM25_HIGH, AQ_EVT_PM25_NORMAL);
+  }
+  if (riseEvent(hasCo2, data.co2, CO2_RISE_PPM, havePreviousCo2, previousCo2)) {
+    events |= AQ_EVT_CO2_RISE;
+  }
+  if (riseEvent(hasPm25, data.pm25, PM25_RISE_UGM3, havePreviousPm25, previousPm25)) {
+    events |= AQ_EVT_PM25_RISE;
+  }
+
+  result.events = events;
+  result.priority = (events != 0);
+
+  unsigned long elapsed = micros() - start;
+
+  if (result.aqi < 0) {
+    logToSDf("[AQ] No PM data for an AQI, events=0x%02x%s, %lu us",
+             events, result.priority ? " PRIORITY" : "", elapsed);
+    return;
+  }
+  char pm25[NUM_FORMAT_MAX], pm10[NUM_FORMAT_MAX];
+  formatFixed(pm25, pm25Known ? result.nowcastPm25 : 0, 1);
+  formatFixed(pm10, pm10Known ? result.nowcastPm10 : 0, 0);
+  logToSDf("[AQ] AQI=%d (NowCast PM2.5=%s PM10=%s), events=0x%02x%s, %lu us",
+           result.aqi, pm25Known ? pm25 : "n/a", pm10Known ? pm10 : "n/a", events,
+           result.priority ? " PRIORITY" : "", elapsed);
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <Arduino.h>
+#include "json_utils.h"
+
+// ===================== On-device air quality analytics =====================
+// Runs once per cycle on the averaged data: US EPA AQI from the PM2.5/PM10
+// NowCast (hourly averages kept in RTC memory), plus threshold crossings
+// (with hysteresis) and rapid-rise events for CO2 and PM2.5.
+
+enum AirQualityEvent : uint8_t {
+  AQ_EVT_CO2_HIGH    = 1 << 0,  // CO2 crossed CO2_ALERT_PPM upwards
+  AQ_EVT_CO2_NORMAL  = 1 << 1,  // CO2 fell back below CO2_CLEAR_PPM
+  AQ_EVT_PM25_HIGH   = 1 << 2,
+  AQ_EVT_PM25_NORMAL = 1 << 3,
+  AQ_EVT_CO2_RISE    = 1 << 4,  // CO2 rose by CO2_RISE_PPM since last cycle
+  AQ_EVT_PM25_RISE   = 1 << 5
+};
+
+struct AirQualityResult {
+  int16_t aqi;           // 0-500, max of PM2.5 and PM10 sub-indices; -1 without PM data
+  float   nowcastPm25;   // µg/m³ (falls back to the cycle average early on)
+  float   nowcastPm10;
+  uint8_t events;        // AirQualityEvent bits raised this cycle
+  bool    priority;      // send now instead of deferring/batching
+};
+
+// channels: CHANNEL_BIT()s of the channels the cycle has samples for; the
+// others hold no reading and are left out (alert state and the NowCast
+// window carry over, rise detection restarts)
+void analyzeAirQuality(time_t timestamp, const MeasurementData &data, uint32_t channels,
+                       AirQualityResult &result);
+
+// US EPA AQI for one pollutant (exposed for checking against reference tables)
+int16_t aqiFromPm25(float ugm3);
+int16_t aqiFromPm10(float ugm3);
+
+// Short names for event bits, e.g. "co2_high"; used in the JSON payload
+const char *airQualityEventName(uint8_t bit);
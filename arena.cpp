@@ -0,0 +1,32 @@
+#include "arena.h"
+#include "config.h"
+
+static uint8_t arena[ARENA_SIZE] __attribute__((aligned(4)));
+static size_t  arenaUsed = 0;
+static size_t  arenaHigh = 0;
+
+char *arenaAlloc(size_t size) {
+  size = (size + 3) & ~(size_t)3;
+  if (size > ARENA_SIZE - arenaUsed) return nullptr;
+
+  char *p = (char *)&arena[arenaUsed];
+  arenaUsed += size;
+  if (arenaUsed > arenaHigh) arenaHigh = arenaUsed;
+  return p;
+}
+
+size_t arenaMark() {
+  return arenaUsed;
+}
+
+void arenaRelease(size_t mark) {
+  if (mark < arenaUsed) arenaUsed = mark;
+}
+
+void arenaReset() {
+  arenaUsed = 0;
+}
+
+size_t arenaPeak() {
+  return arenaHigh;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <Arduino.h>
+
+// ===================== Per-wake arena =====================
+// Bump allocator over a fixed static buffer for short-lived buffers
+// (queue lines, URLs, HTTP bodies). Nothing is freed individually: memory
+// goes back via ArenaScope at the end of a block, or arenaReset() between
+// cycle phases, so these paths never allocate from (or fragment) the heap.
+
+char  *arenaAlloc(size_t size);  // 4-byte aligned; nullptr if exhausted
+size_t arenaMark();
+void   arenaRelease(size_t mark);
+void   arenaReset();
+size_t arenaPeak();              // high-water mark in bytes since boot
+
+// Releases everything allocated inside the enclosing block
+struct ArenaScope {
+  size_t mark;
+  ArenaScope() : mark(arenaMark()) {}
+  ~ArenaScope() { arenaRelease(mark); }
+};
@@ -0,0 +1,136 @@
+#pragma once
+#include <stdint.h>
+#include "config.h"
+#include "num_format.h"
+
+// ===================== Channel registry =====================
+// Every measured channel is declared exactly once below. The accumulator
+// (SensorReadings), MeasurementData, the DATA log row, the JSON payload, the
+// per-channel stats and the layout hash are all expanded from these lines at
+// compile time.
+//
+// X(field, jsonKey, logKey, units, source, type, precision)
+//   field     - struct member name in MeasurementData / SensorReadings
+//   jsonKey   - key in the API payload
+//   logKey    - key in the "| DATA |" row written by logDataToFile()
+//   units     - human-readable units (stats log only)
+//   source    - SensorSource that produces the value
+//   type      - float or int32_t (accumulated and averaged in this type)
+//   precision - decimals in the DATA row (ignored for int32_t)
+
+enum SensorSource : uint8_t {
+  SRC_BME280,
+  SRC_SCD30,
+  SRC_SGP40,
+  SRC_SPS30,
+  SRC_COUNT
+};
+
+#define CH_TEMPERATURE(X) X(temperature, "temperature", "temp",  "C",     SRC_BME280, float,   2)
+#define CH_HUMIDITY(X)    X(humidity,    "humidity",    "hum",   "%",     SRC_BME280, float,   2)
+#define CH_PRESSURE(X)    X(pressure,    "pressure",    "press", "hPa",   SRC_BME280, float,   2)
+#define CH_PM1(X)         X(pm1,         "pm1",         "pm1",   "ug/m3", SRC_SPS30,  float,   2)
+#define CH_PM25(X)        X(pm25,        "pm2_5",       "pm2.5", "ug/m3", SRC_SPS30,  float,   2)
+#define CH_PM10(X)        X(pm10,        "pm10",        "pm10",  "ug/m3", SRC_SPS30,  float,   2)
+#define CH_CO2(X)         X(co2,         "co2",         "co2",   "ppm",   SRC_SCD30,  float,   0)
+#define CH_VOC(X)         X(voc,         "voc",         "voc",   "index", SRC_SGP40,  int32_t, 0)
+
+// SPS30 number concentrations (enable with SPS30_NUMBER_CONCENTRATION in config.h).
+// Appended after the default channels so existing log/JSON formats are unchanged when off.
+#define CH_NC05(X)        X(nc05,        "nc0_5",       "nc0.5", "#/cm3", SRC_SPS30,  float,   2)
+#define CH_NC1(X)         X(nc1,         "nc1",         "nc1",   "#/cm3", SRC_SPS30,  float,   2)
+#define CH_NC25(X)        X(nc25,        "nc2_5",       "nc2.5", "#/cm3", SRC_SPS30,  float,   2)
+#define CH_NC4(X)         X(nc4,         "nc4",         "nc4",   "#/cm3", SRC_SPS30,  float,   2)
+#define CH_NC10(X)        X(nc10,        "nc10",        "nc10",  "#/cm3", SRC_SPS30,  float,   2)
+
+// In the order SPS30Sensor::read() returns them
+#define UFAR_SPS30_NC_CHANNELS(X) CH_NC05(X) CH_NC1(X) CH_NC25(X) CH_NC4(X) CH_NC10(X)
+
+#if SPS30_NUMBER_CONCENTRATION
+#define UFAR_EXTRA_CHANNELS(X) UFAR_SPS30_NC_CHANNELS(X)
+#else
+#define UFAR_EXTRA_CHANNELS(X)
+#endif
+
+// Struct layout and JSON key order
+#define UFAR_CHANNELS(X) \
+  CH_TEMPERATURE(X) CH_HUMIDITY(X) CH_PRESSURE(X) \
+  CH_PM1(X) CH_PM25(X) CH_PM10(X) \
+  CH_CO2(X) CH_VOC(X) \
+  UFAR_EXTRA_CHANNELS(X)
+
+// DATA row key order (historically differs from the JSON order)
+#define UFAR_LOG_CHANNELS(X) \
+  CH_TEMPERATURE(X) CH_HUMIDITY(X) CH_PRESSURE(X) \
+  CH_CO2(X) CH_VOC(X) \
+  CH_PM1(X) CH_PM25(X) CH_PM10(X) \
+  UFAR_EXTRA_CHANNELS(X)
+
+// ===================== Generated helpers =====================
+
+enum ChannelId : uint8_t {
+#define UFAR_CHANNEL_ID(field, ...) CHANNEL_##field,
+  UFAR_CHANNELS(UFAR_CHANNEL_ID)
+#undef UFAR_CHANNEL_ID
+  CHANNEL_COUNT
+};
+
+// Number of SPS30 number-concentration channels (size of the array read() fills)
+enum : uint8_t {
+#define UFAR_NC_ID(field, ...) SPS30_NC_##field,
+  UFAR_SPS30_NC_CHANNELS(UFAR_NC_ID)
+#undef UFAR_NC_ID
+  SPS30_NC_COUNT
+};
+
+struct ChannelInfo {
+  const char*  name;
+  const char*  jsonKey;
+  const char*  units;
+  SensorSource source;
+  uint8_t      precision;
+};
+
+static constexpr ChannelInfo CHANNEL_INFO[CHANNEL_COUNT] = {
+#define UFAR_CHANNEL_INFO(field, jsonKey, logKey, units, source, type, precision) \
+  { #field, jsonKey, units, source, precision },
+  UFAR_CHANNELS(UFAR_CHANNEL_INFO)
+#undef UFAR_CHANNEL_INFO
+};
+
+// FNV-1a, usable in constant expressions
+constexpr uint32_t fnv1a(const char *s, uint32_t h = 2166136261u) {
+  return *s ? fnv1a(s + 1, (h ^ (uint8_t)*s) * 16777619u) : h;
+}
+
+// Hash of "field:type;" for every channel in UFAR_CHANNELS order. Anything
+// persisted as raw SensorReadings/MeasurementData bytes carries it, so a
+// build with other channels (e.g. after an OTA update) doesn't read it back.
+#define UFAR_LAYOUT_ENTRY(field, jsonKey, logKey, units, source, type, precision) #field ":" #type ";"
+static constexpr uint32_t CHANNEL_LAYOUT_HASH = fnv1a(UFAR_CHANNELS(UFAR_LAYOUT_ENTRY));
+#undef UFAR_LAYOUT_ENTRY
+
+// Bit of a channel in a channel mask, e.g. CHANNEL_BIT(co2)
+#define CHANNEL_BIT(field) (1UL << CHANNEL_##field)
+static_assert(CHANNEL_COUNT <= 32, "channel masks are uint32_t");
+
+// Formats one value of a channel type into out (see num_format.h), e.g.
+// UFAR_FORMAT_float(out, v, 2) matches "%.2f", UFAR_FORMAT_int32_t matches "%d"
+#define UFAR_FORMAT_float(out, value, precision)   formatFixed(out, value, precision)
+#define UFAR_FORMAT_int32_t(out, value, precision) formatInt(out, value)
+
+// Longest possible DATA row: timestamp, " | DATA |", and " key=value" per channel
+#define UFAR_DATA_ROW_MAX (32 + CHANNEL_COUNT * (12 + NUM_FORMAT_MAX))
+
+// Running min/max/count for one channel across a measurement cycle
+struct ChannelStats {
+  float    min   = 3.4e38f;
+  float    max   = -3.4e38f;
+  uint16_t count = 0;
+
+  void add(float v) {
+    if (v < min) min = v;
+    if (v > max) max = v;
+    count++;
+  }
+};
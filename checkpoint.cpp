@@ -0,0 +1,78 @@
+#include "checkpoint.h"
+#include "sd_logger.h"
+#include "config.h"
+#include <SD.h>
+#include <type_traits>
+
+#define CHECKPOINT_MAGIC 0x55464331  // "UFC1"
+
+// Not cleared on reset (only on power loss), unlike RTC_DATA_ATTR. Raw bytes,
+// not a CycleCheckpoint: its default member initializers would make it a
+// constructed object, zeroed by startup code on every boot (copied in and
+// out with memcpy, so its alignment doesn't matter)
+static_assert(std::is_trivially_copyable<CycleCheckpoint>::value, "checkpoint is copied as bytes");
+RTC_NOINIT_ATTR static uint8_t rtcCheckpoint[sizeof(CycleCheckpoint)];
+
+static uint32_t crc32(const uint8_t *data, size_t len) {
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (uint8_t b = 0; b < 8; b++) {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+static uint32_t checkpointCRC(const CycleCheckpoint &cp) {
+  return crc32((const uint8_t *)&cp, offsetof(CycleCheckpoint, crc));
+}
+
+static bool checkpointValid(const CycleCheckpoint &cp) {
+  return cp.magic == CHECKPOINT_MAGIC && cp.layout == CHANNEL_LAYOUT_HASH &&
+         cp.crc == checkpointCRC(cp);
+}
+
+// ===================== Checkpoint =====================
+
+bool checkpointLoad(CycleCheckpoint &cp) {
+  memcpy(&cp, rtcCheckpoint, sizeof(cp));
+  if (checkpointValid(cp)) return true;
+
+  #if CHECKPOINT_TO_SD
+  File f = SD.open(CHECKPOINT_SD_FILE, FILE_READ);
+  if (f) {
+    size_t n = f.read((uint8_t *)&cp, sizeof(cp));
+    f.close();
+    if (n == sizeof(cp) && checkpointValid(cp)) {
+      logToSD("[CHECKPOINT] Restored from SD");
+      return true;
+    }
+  }
+  #endif
+
+  return false;
+}
+
+void checkpointSave(CycleCheckpoint &cp) {
+  cp.magic = CHECKPOINT_MAGIC;
+  cp.layout = CHANNEL_LAYOUT_HASH;
+  cp.crc = checkpointCRC(cp);
+  memcpy(rtcCheckpoint, &cp, sizeof(cp));
+
+  #if CHECKPOINT_TO_SD
+  File f = SD.open(CHECKPOINT_SD_FILE, FILE_WRITE);
+  if (f) {
+    f.write((const uint8_t *)&cp, sizeof(cp));
+    f.close();
+  }
+  #endif
+}
+
+void checkpointClear() {
+  memset(rtcCheckpoint + offsetof(CycleCheckpoint, magic), 0, sizeof(uint32_t));
+
+  #if CHECKPOINT_TO_SD
+  SD.remove(CHECKPOINT_SD_FILE);
+  #endif
+}
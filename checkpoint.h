@@ -0,0 +1,23 @@
+#pragma once
+#include <Arduino.h>
+#include "json_utils.h"
+
+// ===================== Measurement checkpoint =====================
+// In-progress cycle state, saved after every sample so a brownout, watchdog
+// or panic mid-cycle can resume sampling instead of losing the slot.
+// Kept in RTC_NOINIT memory (survives chip resets, not power loss) and
+// optionally mirrored to SD (CHECKPOINT_TO_SD).
+struct CycleCheckpoint {
+  uint32_t       magic;
+  uint32_t       layout;        // CHANNEL_LAYOUT_HASH of the build that wrote it
+  time_t         cycleId;       // send slot (timestamp) being measured for
+  time_t         warmupStart;   // when the sensors were started
+  uint16_t       samplesDone;
+  SensorReadings accumulated;
+  uint32_t       crc;
+};
+
+// Returns true and fills cp if a valid checkpoint exists
+bool checkpointLoad(CycleCheckpoint &cp);
+void checkpointSave(CycleCheckpoint &cp);
+void checkpointClear();
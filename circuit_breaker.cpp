@@ -0,0 +1,51 @@
+#include "circuit_breaker.h"
+#include "sd_logger.h"
+#include "rtc_utils.h"
+#include "config.h"
+
+// ===================== RTC state =====================
+RTC_DATA_ATTR static uint16_t uplinkFailures = 0;
+RTC_DATA_ATTR static time_t   uplinkRetryAfter = 0;
+
+// ===================== Breaker =====================
+
+bool uplinkAllowed() {
+  if (uplinkFailures < UPLINK_BREAKER_THRESHOLD) return true;
+
+  time_t now = time(nullptr);
+  if (now >= uplinkRetryAfter) {
+    logToSDf("[BREAKER] Half-open, probing API after %u failures", uplinkFailures);
+    return true;
+  }
+
+  logToSDf("[BREAKER] Open, skipping uplink until %s", timeText(uplinkRetryAfter).str);
+  return false;
+}
+
+bool uplinkIsProbing() {
+  return uplinkFailures > 0;
+}
+
+void uplinkSucceeded() {
+  if (uplinkFailures > 0) {
+    logToSDf("[BREAKER] Closed after %u failures", uplinkFailures);
+  }
+  uplinkFailures = 0;
+  uplinkRetryAfter = 0;
+}
+
+void uplinkFailed() {
+  if (uplinkFailures < 0xFFFF) uplinkFailures++;
+  if (uplinkFailures < UPLINK_BREAKER_THRESHOLD) return;
+
+  // BASE, 2*BASE, 4*BASE, ... capped at MAX
+  uint32_t shift = uplinkFailures - UPLINK_BREAKER_THRESHOLD;
+  uint32_t backoff = UPLINK_BACKOFF_MAX_SEC;
+  if (shift < 16 && ((uint32_t)UPLINK_BACKOFF_BASE_SEC << shift) < UPLINK_BACKOFF_MAX_SEC) {
+    backoff = (uint32_t)UPLINK_BACKOFF_BASE_SEC << shift;
+  }
+
+  uplinkRetryAfter = time(nullptr) + backoff;
+  logToSDf("[BREAKER] Open after %u failures, backing off %us", uplinkFailures,
+           (unsigned)backoff);
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include <Arduino.h>
+#include <time.h>
+
+// Circuit breaker for the API uplink. Consecutive failures open the breaker
+// with exponential backoff; state lives in RTC memory so it survives deep sleep.
+bool uplinkAllowed();      // false while the breaker is open (skip the attempt)
+bool uplinkIsProbing();    // true if the last attempt failed (use short timeouts)
+void uplinkSucceeded();
+void uplinkFailed();
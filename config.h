@@ -6,8 +6,13 @@
 #define WIFI_TIMEOUT_SEC 30
 
 /* ================= DEVICE ================= */
+// Can also be set from the build (the host tests in tests/ do)
+#ifndef DEVICE_ID
 #define DEVICE_ID ""
+#endif
+#ifndef POST_URL
 #define POST_URL ""
+#endif
 /* ================= MEASUREMENT INTERVALS ================= */
 // Send interval in minutes
 #define MEASURE_INTERVAL_MIN 5
@@ -21,6 +26,181 @@
 // Interval between samples during measurement
 #define SAMPLE_INTERVAL_SEC 2
 
+// SCD30 is kept stopped during SPS30 warm-up and started this many seconds
+// before sampling begins, so its first valid reading lands on the first sample
+// (its measurement interval is the 2 s Adafruit_SCD30::begin() sets, which
+// SAMPLE_INTERVAL_SEC has to match, see sensors.cpp)
+#define SCD30_LEAD_SEC SAMPLE_INTERVAL_SEC
+// SCD30 automatic self-calibration (stored in sensor NVM, only written on change)
+#define SCD30_ASC_ENABLED 1
+
+// SGP40 is only sampled during the last N seconds of the window; its VOC
+// algorithm state is carried across deep sleep so it doesn't need a long run-in
+#define SGP40_SAMPLE_WINDOW_SEC SAMPLE_DURATION_SEC
+
+// Also sample/log/send SPS30 number concentrations (nc0.5..nc10), see channels.h
+#define SPS30_NUMBER_CONCENTRATION 0
+
+/* ================= UPLINK ================= */
+// Normal POST timeout, and the shorter one used to probe an API that was failing
+#define HTTP_TIMEOUT_MS        15000
+#define HTTP_PROBE_TIMEOUT_MS  4000
+
+// Per-wake budget for replaying the pending queue, shared by every flush in
+// the wake (the boot-time one and the one after sendData())
+#define QUEUE_FLUSH_BUDGET_SEC   20
+#define QUEUE_FLUSH_BUDGET_BYTES 16384
+
+// Circuit breaker: after this many consecutive API failures, skip uplink
+// attempts for BASE * 2^n seconds (capped at MAX), persisted across deep sleep
+#define UPLINK_BREAKER_THRESHOLD 2
+#define UPLINK_BACKOFF_BASE_SEC  (MEASURE_INTERVAL_MIN * 60)
+#define UPLINK_BACKOFF_MAX_SEC   (6 * 3600)
+
+/* ================= TLS ================= */
+// PEM root certificates used to verify each endpoint. There is no unverified
+// fallback: an https request to an endpoint whose root is "" is refused.
+// API_ROOT_CA is only used when POST_URL is https; set it to the root your
+// API's chain ends in (or from the build, like DEVICE_ID).
+#ifndef API_ROOT_CA
+#define API_ROOT_CA ""
+#endif
+
+// S3 virtual-hosted endpoints chain to Amazon Root CA 1
+#define S3_ROOT_CA \
+  "-----BEGIN CERTIFICATE-----\n" \
+  "MIIDQTCCAimgAwIBAgITBmyfz5m/jAo54vB4ikPmljZbyjANBgkqhkiG9w0BAQsF\n" \
+  "ADA5MQswCQYDVQQGEwJVUzEPMA0GA1UEChMGQW1hem9uMRkwFwYDVQQDExBBbWF6\n" \
+  "b24gUm9vdCBDQSAxMB4XDTE1MDUyNjAwMDAwMFoXDTM4MDExNzAwMDAwMFowOTEL\n" \
+  "MAkGA1UEBhMCVVMxDzANBgNVBAoTBkFtYXpvbjEZMBcGA1UEAxMQQW1hem9uIFJv\n" \
+  "b3QgQ0EgMTCCASIwDQYJKoZIhvcNAQEBBQADggEPADCCAQoCggEBALJ4gHHKeNXj\n" \
+  "ca9HgFB0fW7Y14h29Jlo91ghYPl0hAEvrAIthtOgQ3pOsqTQNroBvo3bSMgHFzZM\n" \
+  "9O6II8c+6zf1tRn4SWiw3te5djgdYZ6k/oI2peVKVuRF4fn9tBb6dNqcmzU5L/qw\n" \
+  "IFAGbHrQgLKm+a/sRxmPUDgH3KKHOVj4utWp+UhnMJbulHheb4mjUcAwhmahRWa6\n" \
+  "VOujw5H5SNz/0egwLX0tdHA114gk957EWW67c4cX8jJGKLhD+rcdqsq08p8kDi1L\n" \
+  "93FcXmn/6pUCyziKrlA4b9v7LWIbxcceVOF34GfID5yHI9Y/QCB/IIDEgEw+OyQm\n" \
+  "jgSubJrIqg0CAwEAAaNCMEAwDwYDVR0TAQH/BAUwAwEB/zAOBgNVHQ8BAf8EBAMC\n" \
+  "AYYwHQYDVR0OBBYEFIQYzIU07LwMlJQuCFmcx7IQTgoIMA0GCSqGSIb3DQEBCwUA\n" \
+  "A4IBAQCY8jdaQZChGsV2USggNiMOruYou6r4lK5IpDB/G/wkjUu0yKGX9rbxenDI\n" \
+  "U5PMCCjjmCXPI6T53iHTfIUJrU6adTrCC2qJeHZERxhlbI1Bjjt/msv0tadQ1wUs\n" \
+  "N+gDS63pYaACbvXy8MWy7Vu33PqUXHeeE6V/Uq2V8viTO96LXFvKWlJbYK8U90vv\n" \
+  "o/ufQJVtMVT8QtPHRh8jrdkPSHCa2XV4cdFyQzR1bldZwgJcJmApzyMZFo6IQ6XU\n" \
+  "5MsI+yMRQ+hDKXJioaldXgjUkK642M4UwtBV8ob2xJNDd2ZhwLnoQdeXeGADbkpy\n" \
+  "rqXRfboQnoZsG4q5WTP468SQvvG5\n" \
+  "-----END CERTIFICATE-----\n"
+
+// raw.githubusercontent.com (and the release objects OTA downloads) chain to
+// DigiCert Global Root G2; GitHub has also served from Sectigo chains ending
+// in USERTrust RSA, so both are trusted
+#define OTA_ROOT_CA \
+  "-----BEGIN CERTIFICATE-----\n" \
+  "MIIDjjCCAnagAwIBAgIQAzrx5qcRqaC7KGSxHQn65TANBgkqhkiG9w0BAQsFADBh\n" \
+  "MQswCQYDVQQGEwJVUzEVMBMGA1UEChMMRGlnaUNlcnQgSW5jMRkwFwYDVQQLExB3\n" \
+  "d3cuZGlnaWNlcnQuY29tMSAwHgYDVQQDExdEaWdpQ2VydCBHbG9iYWwgUm9vdCBH\n" \
+  "MjAeFw0xMzA4MDExMjAwMDBaFw0zODAxMTUxMjAwMDBaMGExCzAJBgNVBAYTAlVT\n" \
+  "MRUwEwYDVQQKEwxEaWdpQ2VydCBJbmMxGTAXBgNVBAsTEHd3dy5kaWdpY2VydC5j\n" \
+  "b20xIDAeBgNVBAMTF0RpZ2lDZXJ0IEdsb2JhbCBSb290IEcyMIIBIjANBgkqhkiG\n" \
+  "9w0BAQEFAAOCAQ8AMIIBCgKCAQEAuzfNNNx7a8myaJCtSnX/RrohCgiN9RlUyfuI\n" \
+  "2/Ou8jqJkTx65qsGGmvPrC3oXgkkRLpimn7Wo6h+4FR1IAWsULecYxpsMNzaHxmx\n" \
+  "1x7e/dfgy5SDN67sH0NO3Xss0r0upS/kqbitOtSZpLYl6ZtrAGCSYP9PIUkY92eQ\n" \
+  "q2EGnI/yuum06ZIya7XzV+hdG82MHauVBJVJ8zUtluNJbd134/tJS7SsVQepj5Wz\n" \
+  "tCO7TG1F8PapspUwtP1MVYwnSlcUfIKdzXOS0xZKBgyMUNGPHgm+F6HmIcr9g+UQ\n" \
+  "vIOlCsRnKPZzFBQ9RnbDhxSJITRNrw9FDKZJobq7nMWxM4MphQIDAQABo0IwQDAP\n" \
+  "BgNVHRMBAf8EBTADAQH/MA4GA1UdDwEB/wQEAwIBhjAdBgNVHQ4EFgQUTiJUIBiV\n" \
+  "5uNu5g/6+rkS7QYXjzkwDQYJKoZIhvcNAQELBQADggEBAGBnKJRvDkhj6zHd6mcY\n" \
+  "1Yl9PMWLSn/pvtsrF9+wX3N3KjITOYFnQoQj8kVnNeyIv/iPsGEMNKSuIEyExtv4\n" \
+  "NeF22d+mQrvHRAiGfzZ0JFrabA0UWTW98kndth/Jsw1HKj2ZL7tcu7XUIOGZX1NG\n" \
+  "Fdtom/DzMNU+MeKNhJ7jitralj41E6Vf8PlwUHBHQRFXGU7Aj64GxJUTFy8bJZ91\n" \
+  "8rGOmaFvE7FBcf6IKshPECBV1/MUReXgRPTqh5Uykw7+U0b6LJ3/iyK5S9kJRaTe\n" \
+  "pLiaWN0bfVKfjllDiIGknibVb63dDcY3fe0Dkhvld1927jyNxF1WW6LZZm6zNTfl\n" \
+  "MrY=\n" \
+  "-----END CERTIFICATE-----\n" \
+  "-----BEGIN CERTIFICATE-----\n" \
+  "MIIF3jCCA8agAwIBAgIQAf1tMPyjylGoG7xkDjUDLTANBgkqhkiG9w0BAQwFADCB\n" \
+  "iDELMAkGA1UEBhMCVVMxEzARBgNVBAgTCk5ldyBKZXJzZXkxFDASBgNVBAcTC0pl\n" \
+  "cnNleSBDaXR5MR4wHAYDVQQKExVUaGUgVVNFUlRSVVNUIE5ldHdvcmsxLjAsBgNV\n" \
+  "BAMTJVVTRVJUcnVzdCBSU0EgQ2VydGlmaWNhdGlvbiBBdXRob3JpdHkwHhcNMTAw\n" \
+  "MjAxMDAwMDAwWhcNMzgwMTE4MjM1OTU5WjCBiDELMAkGA1UEBhMCVVMxEzARBgNV\n" \
+  "BAgTCk5ldyBKZXJzZXkxFDASBgNVBAcTC0plcnNleSBDaXR5MR4wHAYDVQQKExVU\n" \
+  "aGUgVVNFUlRSVVNUIE5ldHdvcmsxLjAsBgNVBAMTJVVTRVJUcnVzdCBSU0EgQ2Vy\n" \
+  "dGlmaWNhdGlvbiBBdXRob3JpdHkwggIiMA0GCSqGSIb3DQEBAQUAA4ICDwAwggIK\n" \
+  "AoICAQCAEmUXNg7D2wiz0KxXDXbtzSfTTK1Qg2HiqiBNCS1kCdzOiZ/MPans9s/B\n" \
+  "3PHTsdZ7NygRK0faOca8Ohm0X6a9fZ2jY0K2dvKpOyuR+OJv0OwWIJAJPuLodMkY\n" \
+  "tJHUYmTbf6MG8YgYapAiPLz+E/CHFHv25B+O1ORRxhFnRghRy4YUVD+8M/5+bJz/\n" \
+  "Fp0YvVGONaanZshyZ9shZrHUm3gDwFA66Mzw3LyeTP6vBZY1H1dat//O+T23LLb2\n" \
+  "VN3I5xI6Ta5MirdcmrS3ID3KfyI0rn47aGYBROcBTkZTmzNg95S+UzeQc0PzMsNT\n" \
+  "79uq/nROacdrjGCT3sTHDN/hMq7MkztReJVni+49Vv4M0GkPGw/zJSZrM233bkf6\n" \
+  "c0Plfg6lZrEpfDKEY1WJxA3Bk1QwGROs0303p+tdOmw1XNtB1xLaqUkL39iAigmT\n" \
+  "Yo61Zs8liM2EuLE/pDkP2QKe6xJMlXzzawWpXhaDzLhn4ugTncxbgtNMs+1b/97l\n" \
+  "c6wjOy0AvzVVdAlJ2ElYGn+SNuZRkg7zJn0cTRe8yexDJtC/QV9AqURE9JnnV4ee\n" \
+  "UB9XVKg+/XRjL7FQZQnmWEIuQxpMtPAlR1n6BB6T1CZGSlCBst6+eLf8ZxXhyVeE\n" \
+  "Hg9j1uliutZfVS7qXMYoCAQlObgOK6nyTJccBz8NUvXt7y+CDwIDAQABo0IwQDAd\n" \
+  "BgNVHQ4EFgQUU3m/WqorSs9UgOHYm8Cd8rIDZsswDgYDVR0PAQH/BAQDAgEGMA8G\n" \
+  "A1UdEwEB/wQFMAMBAf8wDQYJKoZIhvcNAQEMBQADggIBAFzUfA3P9wF9QZllDHPF\n" \
+  "Up/L+M+ZBn8b2kMVn54CVVeWFPFSPCeHlCjtHzoBN6J2/FNQwISbxmtOuowhT6KO\n" \
+  "VWKR82kV2LyI48SqC/3vqOlLVSoGIG1VeCkZ7l8wXEskEVX/JJpuXior7gtNn3/3\n" \
+  "ATiUFJVDBwn7YKnuHKsSjKCaXqeYalltiz8I+8jRRa8YFWSQEg9zKC7F4iRO/Fjs\n" \
+  "8PRF/iKz6y+O0tlFYQXBl2+odnKPi4w2r78NBc5xjeambx9spnFixdjQg3IM8WcR\n" \
+  "iQycE0xyNN+81XHfqnHd4blsjDwSXWXavVcStkNr/+XeTWYRUc+ZruwXtuhxkYze\n" \
+  "Sf7dNXGiFSeUHM9h4ya7b6NnJSFd5t0dCy5oGzuCr+yDZ4XUmFF0sbmZgIn/f3gZ\n" \
+  "XHlKYC6SQK5MNyosycdiyA5d9zZbyuAlJQG03RoHnHcAP9Dc1ew91Pq7P8yF1m9/\n" \
+  "qS3fuQL39ZeatTXaw2ewh0qpKJ4jjv9cJ2vhsE/zB+4ALtRZh8tSQZXq9EfX7mRB\n" \
+  "VXyNWQKV3WKdwrnuWih0hKWbt5DHDAff9Yk2dDLWKMGwsAvgnEzDHNb842m1R0aB\n" \
+  "L6KCq9NjRHDEjf8tM7qtj3u1cIiuPhnPQCjY/MiQu12ZIvVS5ljFH4gxQ+6IHdfG\n" \
+  "jjxDah2nGN59PRbxYvnKkKj9\n" \
+  "-----END CERTIFICATE-----\n"
+
+// Sessions resumed across deep sleep (tls_session.h) skip the full handshake.
+// A session saved with its peer certificate (mbedTLS KEEP_PEER_CERTIFICATE)
+// needs ~1.5 KB; one larger than a slot is simply not cached.
+#define TLS_SESSION_SLOTS       2
+#define TLS_SESSION_MAX_BYTES   1600
+#define TLS_SESSION_MAX_AGE_SEC (12 * 3600)
+
+/* ================= MEMORY ================= */
+// Static arena for per-wake scratch buffers (queue lines, URLs, HTTP bodies)
+#define ARENA_SIZE 4096
+// Longest queue line / manifest body / logged HTTP response we handle
+#define QUEUE_LINE_MAX     512
+#define HTTP_BODY_MAX      512
+
+/* ================= SGP40 VOC STATE ================= */
+// Sleep gap up to which the full VOC algorithm state (incl. uptime/learning
+// phase) is restored; longer gaps keep only the learned mean/std baseline
+#define SGP40_STATE_FULL_RESTORE_SEC (2 * 3600)
+// Gaps longer than this discard the saved state and cold-start the algorithm
+#define SGP40_STATE_MAX_AGE_SEC      (24 * 3600)
+
+/* ================= WAKE SCHEDULER ================= */
+// Starting guess for wake-to-ready latency (boot + SD + WiFi + sensor init)
+#define WAKE_LATENCY_INIT_SEC 10
+// Lead = mean + Z * stddev of learned latency; 1.645 ~ 95th percentile
+#define WAKE_LATENCY_Z        1.645f
+// EWMA weight of each new latency / drift observation
+#define WAKE_EWMA_ALPHA       0.2f
+// RTC drift is only observable against NTP: re-sync after this much deep
+// sleep, and take a sync's step as a drift sample once at least
+// WAKE_DRIFT_MIN_SLEPT_SEC of sleep stands behind it
+#define WAKE_RESYNC_SEC          (6 * 3600)
+#define WAKE_DRIFT_MIN_SLEPT_SEC 3600
+// Reject drift samples beyond this fraction (clock set by other means, bad NTP answer)
+#define WAKE_DRIFT_MAX        0.05f
+// Shortest deep sleep worth taking
+#define WAKE_MIN_SLEEP_SEC    10
+
+/* ================= AIR QUALITY EVENTS ================= */
+// Threshold alerts with hysteresis (raise at ALERT, clear below CLEAR)
+#define CO2_ALERT_PPM    1500
+#define CO2_CLEAR_PPM    1300
+#define PM25_ALERT_UGM3  35.5f
+#define PM25_CLEAR_UGM3  30.0f
+// Rapid-rise events: increase since the previous cycle
+#define CO2_RISE_PPM     300
+#define PM25_RISE_UGM3   20.0f
+// Routine (no-event) readings are queued and sent in a batch every N cycles;
+// readings with an event always go out immediately. 1 = send every cycle.
+#define UPLINK_ROUTINE_BATCH 1
+
 /* ================= TIMEZONE ================= */
 // Armenia UTC+4
 #define ARMENIA_TZ_OFFSET  (4 * 3600)
@@ -46,7 +226,9 @@
 /* ================= OTA ================= */
 // Raw URL to version.json in your GitHub repo, e.g.:
 // https://raw.githubusercontent.com/YOUR_USER/YOUR_REPO/main/firmware/version.json
+#ifndef OTA_MANIFEST_URL
 #define OTA_MANIFEST_URL ""
+#endif
 // Bump FIRMWARE_VERSION in ota_updater.h before each release
 
 
@@ -58,3 +240,21 @@
 #define SD_LOG_FILE     "/ufar_project/device_" DEVICE_ID "_log.txt"
 // Pending queue: one JSON payload per line, retried when connectivity returns
 #define SD_QUEUE_FILE   "/ufar_project/pending_queue.txt"
+// Log records are handed to an SD writer task on the other core through a
+// lock-free ring (power of two). Log lines never block; overflow is counted.
+// The last LOG_RING_DATA_RESERVE slots only take DATA rows, and a DATA row
+// that still finds the ring full waits for the writer rather than be lost.
+#define LOG_RING_RECORDS      128
+#define LOG_RING_DATA_RESERVE 8
+// Text bytes per log record; longer messages span several records
+// (128 x 120 keeps the ring at ~17 KB, most lines fit one record)
+#define LOG_RECORD_TEXT       120
+// Writer task core and idle flush period
+#define LOG_WRITER_CORE    0
+#define LOG_FLUSH_INTERVAL_MS 20000
+// Measurement checkpoint is always kept in RTC memory; set to 1 to also
+// mirror it to SD after every sample (survives full power loss, costs a write)
+#define CHECKPOINT_TO_SD   0
+#define CHECKPOINT_SD_FILE "/ufar_project/checkpoint.bin"
+// Scratch file used while rewriting the queue after a partial flush
+#define SD_QUEUE_TMP_FILE "/ufar_project/pending_queue.tmp"
@@ -3,56 +3,96 @@
 #include <HTTPClient.h>
 #include <WiFi.h>
 #include "rtc_utils.h"
+#include "circuit_breaker.h"
+#include "net_client.h"
+#include "arena.h"
+#include "air_quality.h"
 #include "config.h"
 
 // ===================== JSON / HTTP =====================
 
-String prepareJSON(const char* deviceId, time_t t, MeasurementData data) {
+size_t prepareJSON(char *out, size_t size, const char* deviceId, time_t t,
+                   const MeasurementData &data, const AirQualityResult *aq) {
   StaticJsonDocument<512> doc;
   char buffer[20];
   snprintf(buffer, sizeof(buffer), "device%s", deviceId);
   doc["device"] = buffer;
   JsonObject d = doc.createNestedArray("data").createNestedObject();
-  d["time"] = timeToStr(t);
-  d["temperature"] = data.temperature;
-  d["humidity"] = data.humidity;
-  d["pressure"] = data.pressure;
-  d["pm1"] = data.pm1;
-  d["pm2_5"] = data.pm25;
-  d["pm10"] = data.pm10;
-  d["co2"] = data.co2;
-  d["voc"] = data.voc;
-
-  String payload;
-  serializeJson(doc, payload);
-
-  logToSD("[JSON] Payload prepared (" + String(payload.length()) + " bytes)");
-
-  return payload;
+  char timeBuf[20];
+  timeToBuf(t, timeBuf, sizeof(timeBuf));
+  d["time"] = timeBuf;
+#define UFAR_JSON_FIELD(field, jsonKey, ...) d[jsonKey] = data.field;
+  UFAR_CHANNELS(UFAR_JSON_FIELD)
+#undef UFAR_JSON_FIELD
+
+  if (aq) {
+    if (aq->aqi >= 0) d["aqi"] = aq->aqi;
+    if (aq->events) {
+      JsonArray events = d.createNestedArray("events");
+      for (uint8_t bit = 1; bit != 0; bit <<= 1) {
+        if (aq->events & bit) events.add(airQualityEventName(bit));
+      }
+    }
+  }
+
+  size_t len = measureJson(doc);
+  if (len >= size) {
+    logToSDf("[JSON] ERROR: Payload needs %u bytes, buffer holds %u", (unsigned)len,
+             (unsigned)size - 1);
+    return 0;
+  }
+  serializeJson(doc, out, size);
+
+  logToSDf("[JSON] Payload prepared (%u bytes)", (unsigned)len);
+
+  return len;
+}
+
+bool payloadRejected(int status) {
+  return status == 400 || status == 413 || status == 422;
 }
 
-bool sendHTTP(String payload) {
-  logToSD("[HTTP] Sending to: " + String(POST_URL));
+bool sendHTTP(const char *payload, size_t len, uint16_t timeoutMs, int *statusOut) {
+  logToSD("[HTTP] Sending to: " POST_URL);
 
+  unsigned long start = millis();
   HTTPClient http;
-  http.begin(POST_URL);
+  if (!netBegin(http, POST_URL, API_ROOT_CA, timeoutMs)) {
+    if (statusOut) *statusOut = HTTPC_ERROR_CONNECTION_REFUSED;
+    uplinkFailed();
+    return false;
+  }
   http.addHeader("Content-Type", "application/json");
-  http.setTimeout(15000);
+  // timeoutMs bounds the whole request: the response gets what connecting left
+  uint32_t connectElapsed = millis() - start;
+  http.setTimeout(connectElapsed < timeoutMs ? timeoutMs - connectElapsed : 1);
 
-  int status = http.POST(payload);
+  int status = http.POST((uint8_t *)payload, len);
+  if (statusOut) *statusOut = status;
 
-  logToSD("[HTTP] Response code: " + String(status));
+  logToSDf("[HTTP] Response code: %d", status);
 
   if (status > 0) {
-    String response = http.getString();
-    if (response.length() > 0 && response.length() < 200) {
-      logToSD("[HTTP] Response: " + response);
+    // The whole body is read off the pooled connection; its start is logged
+    const size_t LOGGED = 200;
+    ArenaScope scope;
+    char *response = arenaAlloc(LOGGED);
+    if (netEnd(http, response, response ? LOGGED : 0) > 0) {
+      logToSDf("[HTTP] Response: %s", response);
     }
   } else {
-    logToSD("[HTTP] ERROR: " + http.errorToString(status));
+    logToSDf("[HTTP] ERROR: %s", http.errorToString(status).c_str());
+    http.end();
   }
 
-  http.end();
+  // The backend is only known to be up if it took the request or rejected
+  // the payload itself; transport errors, 5xx, auth failures and rate
+  // limiting all mean later requests would fail the same way
+  if ((status >= 200 && status < 400) || payloadRejected(status)) {
+    uplinkSucceeded();
+  } else {
+    uplinkFailed();
+  }
 
   return (status == 200 || status == 201);
 }
@@ -1,17 +1,41 @@
 #pragma once
 #include <ArduinoJson.h>
 #include <Arduino.h>
+#include "channels.h"
+#include "config.h"
 
+// One member per channel in channels.h (temperature, humidity, ..., voc)
 struct MeasurementData {
-  float temperature;
-  float humidity;
-  float pressure;
-  float pm1;
-  float pm25;
-  float pm10;
-  float co2;
-  int32_t voc;
+#define UFAR_DATA_FIELD(field, jsonKey, logKey, units, source, type, precision) type field;
+  UFAR_CHANNELS(UFAR_DATA_FIELD)
+#undef UFAR_DATA_FIELD
 };
 
-String prepareJSON(const char* deviceId, time_t t, MeasurementData data);
-bool sendHTTP(String payload);
+// Running sums and stats for every channel declared in channels.h
+// (plain data: checkpointed to RTC memory as-is, see checkpoint.h)
+struct SensorReadings {
+#define UFAR_ACC_FIELD(field, jsonKey, logKey, units, source, type, precision) type field = 0;
+  UFAR_CHANNELS(UFAR_ACC_FIELD)
+#undef UFAR_ACC_FIELD
+
+  ChannelStats stats[CHANNEL_COUNT];
+  int validSamples = 0;
+};
+
+struct AirQualityResult;
+
+// Serializes one reading into out (size bytes, e.g. QUEUE_LINE_MAX from the
+// arena). aq (optional) adds "aqi" (if known) and, if any were raised, "events".
+// Returns the payload length, or 0 if it didn't fit.
+size_t prepareJSON(char *out, size_t size, const char* deviceId, time_t t,
+                   const MeasurementData &data, const AirQualityResult *aq = nullptr);
+// True if the backend refused the payload itself (400, 413, 422): resending
+// it can never succeed. Any other failure - transport errors, 5xx, and auth
+// or rate-limit answers (401, 403, 408, 429) - may pass, so the entry is kept.
+bool payloadRejected(int status);
+// POSTs payload to POST_URL within timeoutMs (connect + response). statusOut
+// (optional) receives the HTTP status (<= 0 for transport errors). Outcome is
+// reported to the uplink circuit breaker: only a 2xx/3xx or a rejected
+// payload counts as the backend being reachable.
+bool sendHTTP(const char *payload, size_t len, uint16_t timeoutMs = HTTP_TIMEOUT_MS,
+              int *statusOut = nullptr);
@@ -0,0 +1,157 @@
+#include "net_client.h"
+#include "sd_logger.h"
+#include "config.h"
+#include "tls_client.h"
+
+#define NET_POOL_SIZE 3
+
+struct PooledClient {
+  char        host[64];
+  uint16_t    port;
+  bool        secure;
+  WiFiClient *client;
+};
+
+static PooledClient pool[NET_POOL_SIZE];
+static uint16_t     handshakes = 0;  // full TLS handshakes, or plain TCP connects
+static uint16_t     resumed = 0;     // TLS sessions resumed (tls_session.h)
+static uint16_t     reused = 0;
+static uint32_t     connectMs = 0;
+
+// ===================== URL parsing =====================
+// Splits "scheme://host[:port]/path" into host/port/secure.
+static bool parseURL(const char *url, char *host, size_t hostLen, uint16_t &port, bool &secure) {
+  const char *hostStart = strstr(url, "://");
+  if (!hostStart) return false;
+
+  secure = strncmp(url, "https", 5) == 0;
+  port = secure ? 443 : 80;
+
+  hostStart += 3;
+  const char *hostEnd = hostStart + strcspn(hostStart, ":/");
+  if (*hostEnd == ':') {
+    port = atoi(hostEnd + 1);
+  }
+
+  size_t n = hostEnd - hostStart;
+  if (n == 0 || n >= hostLen) return false;
+  memcpy(host, hostStart, n);
+  host[n] = '\0';
+  return true;
+}
+
+// ===================== Pool =====================
+
+WiFiClient *netClientFor(const char *url, const char *rootCA, uint32_t connectTimeoutMs) {
+  char host[64];
+  uint16_t port;
+  bool secure;
+  if (!parseURL(url, host, sizeof(host), port, secure)) {
+    logToSDf("[NET] ERROR: Cannot parse URL: %s", url);
+    return nullptr;
+  }
+
+  PooledClient *slot = nullptr;
+  for (int i = 0; i < NET_POOL_SIZE; i++) {
+    PooledClient &p = pool[i];
+    if (p.client && p.port == port && p.secure == secure && strcmp(p.host, host) == 0) {
+      slot = &p;
+      break;
+    }
+  }
+
+  if (slot && slot->client->connected()) {
+    reused++;
+    return slot->client;
+  }
+
+  if (secure && !(rootCA && *rootCA)) {
+    logToSDf("[NET] ERROR: No root CA configured for %s, refusing unverified TLS", host);
+    return nullptr;
+  }
+
+  if (slot) {
+    // Dropped by the peer: release its socket and TLS state before reconnecting
+    slot->client->stop();
+  } else {
+    for (int i = 0; i < NET_POOL_SIZE && !slot; i++) {
+      if (!pool[i].client) slot = &pool[i];
+    }
+    if (!slot) {
+      // Pool full — evict the first slot
+      slot = &pool[0];
+      slot->client->stop();
+      delete slot->client;
+      slot->client = nullptr;
+    }
+
+    strncpy(slot->host, host, sizeof(slot->host));
+    slot->port = port;
+    slot->secure = secure;
+
+    slot->client = secure ? new TlsClient() : new WiFiClient();
+  }
+
+  // connect(host, port, timeout) is not virtual — call the TLS overload explicitly
+  unsigned long start = millis();
+  TlsClient *tls = secure ? static_cast<TlsClient *>(slot->client) : nullptr;
+  if (tls) tls->setCACert(rootCA);
+  int ok = tls ? tls->connect(host, port, connectTimeoutMs)
+               : slot->client->connect(host, port, connectTimeoutMs);
+  if (!ok) {
+    logToSDf("[NET] ERROR: Connect to %s:%u failed", host, port);
+    slot->client->stop();
+    return nullptr;
+  }
+
+  uint32_t elapsed = millis() - start;
+  connectMs += elapsed;
+  if (tls && tls->resumed()) {
+    resumed++;
+  } else {
+    handshakes++;
+  }
+  logToSDf("[NET] Connected to %s%s in %u ms", host,
+           !tls ? "" : tls->resumed() ? " (TLS, resumed)" : " (TLS)", (unsigned)elapsed);
+
+  return slot->client;
+}
+
+bool netBegin(HTTPClient &http, const char *url, const char *rootCA,
+              uint32_t connectTimeoutMs) {
+  WiFiClient *client = netClientFor(url, rootCA, connectTimeoutMs);
+  if (!client) return false;
+
+  http.setReuse(true);
+  return http.begin(*client, url);
+}
+
+size_t netEnd(HTTPClient &http, char *buf, size_t cap) {
+  WiFiClient *client = http.getStreamPtr();
+  BodySink sink(buf, buf && cap > 0 ? cap - 1 : 0);
+  if (http.writeToStream(&sink) < 0 && client) {
+    // Cut short: the rest would be read as the next response
+    client->stop();
+  }
+  http.end();
+  if (buf && cap > 0) buf[sink.length()] = '\0';
+  return sink.length();
+}
+
+void netCloseAll() {
+  for (int i = 0; i < NET_POOL_SIZE; i++) {
+    if (!pool[i].client) continue;
+    pool[i].client->stop();
+    delete pool[i].client;
+    pool[i].client = nullptr;
+  }
+
+  if (handshakes > 0 || resumed > 0 || reused > 0) {
+    logToSDf("[NET] This wake: %u full handshake(s), %u resumed, %u ms connecting, "
+             "%u reused connection(s)", handshakes, resumed, (unsigned)connectMs, reused);
+  }
+  handshakes = 0;
+  resumed = 0;
+  reused = 0;
+  connectMs = 0;
+}
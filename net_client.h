@@ -0,0 +1,50 @@
+#pragma once
+#include <Arduino.h>
+#include <HTTPClient.h>
+
+// Per-wake connection pool: one client per host, kept alive between requests
+// so e.g. the OTA manifest and binary fetch share a single TLS handshake.
+// https connections are verified against `rootCA` and refused without one.
+// Returns false if the TCP/TLS connection could not be established.
+bool netBegin(HTTPClient &http, const char *url, const char *rootCA,
+              uint32_t connectTimeoutMs);
+
+// Ends a request begun with netBegin(): reads the rest of the response body
+// (chunked or not), keeping up to cap-1 bytes of it in buf, NUL-terminated,
+// if given. A pooled connection is only clean for the next request once the
+// body has been read to its end; if it can't be, the connection is closed.
+// Returns the number of bytes kept.
+size_t netEnd(HTTPClient &http, char *buf = nullptr, size_t cap = 0);
+
+// Collects a response body into a fixed buffer through
+// HTTPClient::writeToStream(); bytes past the end are counted, not stored.
+class BodySink : public Stream {
+public:
+  BodySink(char *buf, size_t capacity) : buf_(buf), capacity_(capacity) {}
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *data, size_t n) override {
+    if (length_ < capacity_) memcpy(buf_ + length_, data, min(n, capacity_ - length_));
+    length_ += n;
+    return n;
+  }
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+
+  size_t length() const { return min(length_, capacity_); }
+  bool overflowed() const { return length_ > capacity_; }
+
+private:
+  char  *buf_;
+  size_t capacity_;
+  size_t length_ = 0;
+};
+
+// Same pooled client, for APIs that take a WiFiClient& (e.g. HTTPUpdate)
+WiFiClient *netClientFor(const char *url, const char *rootCA, uint32_t connectTimeoutMs);
+
+// Close every pooled connection and log handshake stats for this wake.
+// Must be called before WiFi is turned off. TLS sessions outlive it
+// (tls_session.h): reconnecting after it resumes instead of a full handshake.
+void netCloseAll();
@@ -0,0 +1,84 @@
+#include "num_format.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static const uint32_t POW10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+
+// Writes the decimal digits of v, at least minDigits wide (zero-padded)
+static size_t writeDigits(char *out, uint64_t v, uint8_t minDigits) {
+  char tmp[20];
+  uint8_t n = 0;
+  do {
+    tmp[n++] = '0' + (v % 10);
+    v /= 10;
+  } while (v > 0);
+  while (n < minDigits) tmp[n++] = '0';
+
+  for (uint8_t i = 0; i < n; i++) {
+    out[i] = tmp[n - 1 - i];
+  }
+  return n;
+}
+
+size_t formatFixed(char *out, float value, uint8_t decimals) {
+  if (!isfinite(value) || decimals > 6) {
+    int n = snprintf(out, NUM_FORMAT_MAX, "%.*f", decimals, value);
+    return (n < 0) ? 0 : (n >= NUM_FORMAT_MAX ? NUM_FORMAT_MAX - 1 : n);
+  }
+
+  // Decompose: value = mant * 2^exp exactly
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  bool negative = bits >> 31;
+  int32_t exp = (bits >> 23) & 0xFF;
+  uint32_t mant = bits & 0x7FFFFF;
+  if (exp == 0) {
+    exp = 1;              // subnormal
+  } else {
+    mant |= 0x800000;     // implicit leading bit
+  }
+  exp -= 150;
+
+  // value * 10^decimals = mant * 10^decimals * 2^exp; mant * 10^6 < 2^44
+  uint64_t scaled = (uint64_t)mant * POW10[decimals];
+  uint64_t q;
+  if (exp >= 0) {
+    if (exp > 19) {
+      // Doesn't fit in 64 bits — rare enough to hand to printf
+      int n = snprintf(out, NUM_FORMAT_MAX, "%.*f", decimals, value);
+      return (n < 0) ? 0 : (n >= NUM_FORMAT_MAX ? NUM_FORMAT_MAX - 1 : n);
+    }
+    q = scaled << exp;
+  } else if (-exp >= 64) {
+    q = 0;                // below half a unit in the last place
+  } else {
+    uint32_t k = -exp;
+    q = scaled >> k;
+    uint64_t rem  = scaled & ((1ULL << k) - 1);
+    uint64_t half = 1ULL << (k - 1);
+    if (rem > half || (rem == half && (q & 1))) q++;
+  }
+
+  size_t n = 0;
+  if (negative) out[n++] = '-';
+  n += writeDigits(&out[n], q / POW10[decimals], 1);
+  if (decimals > 0) {
+    out[n++] = '.';
+    n += writeDigits(&out[n], q % POW10[decimals], decimals);
+  }
+  out[n] = '\0';
+  return n;
+}
+
+size_t formatInt(char *out, int32_t value) {
+  size_t n = 0;
+  uint32_t v = (uint32_t)value;
+  if (value < 0) {
+    out[n++] = '-';
+    v = 0u - v;
+  }
+  n += writeDigits(&out[n], v, 1);
+  out[n] = '\0';
+  return n;
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// ===================== Number formatting =====================
+// printf-compatible decimal formatting without newlib's float printf:
+// no heap, no locale, bounded stack. Output is NUL-terminated and never
+// longer than NUM_FORMAT_MAX bytes (including the NUL). That holds every
+// finite float with up to 6 decimals in full, the longest being -FLT_MAX
+// at 6 (47 chars); more decimals than that are cut to fit.
+#define NUM_FORMAT_MAX 48
+
+// Same output as snprintf("%.<decimals>f", value), correctly rounded
+// (round-half-even on exact ties), for decimals <= 6. Returns the length
+// written.
+size_t formatFixed(char *out, float value, uint8_t decimals);
+
+// Same output as snprintf("%d", value)
+size_t formatInt(char *out, int32_t value);
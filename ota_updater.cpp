@@ -1,9 +1,10 @@
 #include "ota_updater.h"
 #include "sd_logger.h"
+#include "net_client.h"
+#include "arena.h"
 #include "config.h"
 #include <HTTPClient.h>
 #include <HTTPUpdate.h>
-#include <WiFiClientSecure.h>
 #include <ArduinoJson.h>
 
 // ===================== Version comparison =====================
@@ -25,46 +26,61 @@ static void otaProgressCallback(int current, int total) {
   static int lastPct = -1;
   int pct = (total > 0) ? (current * 100 / total) : 0;
   if (pct != lastPct && pct % 10 == 0) {
-    logToSD("[OTA] Progress: " + String(pct) + "% (" + String(current) + "/" + String(total) + " bytes)");
+    logToSDf("[OTA] Progress: %d%% (%d/%d bytes)", pct, current, total);
     lastPct = pct;
   }
 }
 
 // ===================== Main OTA function =====================
 bool checkAndApplyOTA() {
-  logToSD("[OTA] Current firmware: v" + String(FIRMWARE_VERSION));
-  logToSD("[OTA] Checking for update at: " + String(OTA_MANIFEST_URL));
+  logToSD("[OTA] Current firmware: v" FIRMWARE_VERSION);
+  logToSD("[OTA] Checking for update at: " OTA_MANIFEST_URL);
 
   // ---- Step 1: Fetch version manifest ----
-  WiFiClientSecure manifestClient;
-  manifestClient.setInsecure(); // GitHub uses HTTPS; skip cert validation on ESP32
-  manifestClient.setTimeout(10);
-
+  // Pooled client: the binary on the same host reuses this TLS session
   HTTPClient http;
-  http.begin(manifestClient, OTA_MANIFEST_URL);
+  if (!netBegin(http, OTA_MANIFEST_URL, OTA_ROOT_CA, 10000)) {
+    logToSD("[OTA] Cannot reach manifest host, skipping update");
+    return false;
+  }
   http.setTimeout(10000);
   // Follow GitHub raw redirects
   http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
 
   int code = http.GET();
-  logToSD("[OTA] Manifest response code: " + String(code));
+  logToSDf("[OTA] Manifest response code: %d", code);
 
   if (code != 200) {
     logToSD("[OTA] Failed to fetch manifest, skipping update");
-    http.end();
+    netEnd(http);
     return false;
   }
 
-  String body = http.getString();
+  // Manifest is tiny — read it into the arena rather than a heap String.
+  // writeToStream() handles chunked bodies and a missing Content-Length.
+  ArenaScope scope;
+  char *body = arenaAlloc(HTTP_BODY_MAX);
+  if (!body) {
+    netEnd(http);
+    return false;
+  }
+  BodySink sink(body, HTTP_BODY_MAX - 1);
+  int got = http.writeToStream(&sink);
   http.end();
+  if (got < 0 || sink.overflowed()) {
+    logToSDf("[OTA] ERROR: Cannot read manifest (%d, %u bytes)", got, (unsigned)sink.length());
+    return false;
+  }
+  size_t size = sink.length();
+  body[size] = '\0';
 
   // ---- Step 2: Parse manifest JSON ----
   // Expected format:
   // { "version": "1.2.0", "url": "https://github.com/.../firmware.bin" }
   StaticJsonDocument<256> doc;
-  DeserializationError err = deserializeJson(doc, body);
+  DeserializationError err = deserializeJson(doc, body, size);
   if (err) {
-    logToSD("[OTA] ERROR: Failed to parse manifest JSON: " + String(err.c_str()));
+    logToSDf("[OTA] ERROR: Failed to parse manifest JSON: %s", err.c_str());
     return false;
   }
 
@@ -76,30 +92,32 @@ bool checkAndApplyOTA() {
     return false;
   }
 
-  logToSD("[OTA] Remote version: v" + String(remoteVersion));
+  logToSDf("[OTA] Remote version: v%s", remoteVersion);
 
   // ---- Step 3: Compare versions ----
   if (!isNewerVersion(FIRMWARE_VERSION, remoteVersion)) {
-    logToSD("[OTA] Already up to date (v" + String(FIRMWARE_VERSION) + ")");
+    logToSD("[OTA] Already up to date (v" FIRMWARE_VERSION ")");
     return false;
   }
 
-  logToSD("[OTA] New version available: v" + String(remoteVersion) + " — starting download");
-  logToSD("[OTA] Binary URL: " + String(binUrl));
+  logToSDf("[OTA] New version available: v%s — starting download", remoteVersion);
+  logToSDf("[OTA] Binary URL: %s", binUrl);
 
   // ---- Step 4: Download and flash ----
-  WiFiClientSecure binClient;
-  binClient.setInsecure();
-  binClient.setTimeout(60); // 60s socket timeout for large binary
+  WiFiClient *binClient = netClientFor(binUrl, OTA_ROOT_CA, 10000);
+  if (!binClient) {
+    logToSD("[OTA] ERROR: Cannot reach binary host");
+    return false;
+  }
 
   httpUpdate.onProgress(otaProgressCallback);
   httpUpdate.rebootOnUpdate(false); // We'll reboot manually after logging
 
-  t_httpUpdate_return result = httpUpdate.update(binClient, binUrl);
+  t_httpUpdate_return result = httpUpdate.update(*binClient, binUrl);
 
   switch (result) {
     case HTTP_UPDATE_OK:
-      logToSD("[OTA] Update successful! Rebooting to v" + String(remoteVersion) + "...");
+      logToSDf("[OTA] Update successful! Rebooting to v%s...", remoteVersion);
       flushSDLog();
       delay(500);
       ESP.restart();
@@ -110,11 +128,11 @@ bool checkAndApplyOTA() {
       return false;
 
     case HTTP_UPDATE_FAILED:
-      logToSD("[OTA] ERROR: Update failed — " + httpUpdate.getLastErrorString());
+      logToSDf("[OTA] ERROR: Update failed — %s", httpUpdate.getLastErrorString().c_str());
       return false;
 
     default:
-      logToSD("[OTA] ERROR: Unknown update result: " + String(result));
+      logToSDf("[OTA] ERROR: Unknown update result: %d", (int)result);
       return false;
   }
 }
@@ -15,9 +15,28 @@ time_t calculateNextSend(time_t now, time_t lastSent, int intervalMin){
   return next;
 }
 
+void applyTimezone(){
+  // POSIX TZ offsets are west-positive: UTC+4 is "UTC-4:00"
+  long offset = ARMENIA_TZ_OFFSET + ARMENIA_DST_OFFSET;
+  long mag = offset < 0 ? -offset : offset;
+  char tz[16];
+  snprintf(tz, sizeof(tz), "UTC%c%ld:%02ld", offset < 0 ? '+' : '-', mag / 3600, (mag % 3600) / 60);
+  setenv("TZ", tz, 1);
+  tzset();
+}
 
 String timeToStr(time_t t){
   char buf[25];
-  strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", localtime(&t));
+  timeToBuf(t, buf, sizeof(buf));
   return String(buf);
 }
+
+void timeToBuf(time_t t, char *buf, size_t len){
+  strftime(buf, len, "%Y-%m-%d %H:%M:%S", localtime(&t));
+}
+
+TimeText timeText(time_t t){
+  TimeText text;
+  timeToBuf(t, text.str, sizeof(text.str));
+  return text;
+}
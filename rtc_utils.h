@@ -3,4 +3,14 @@
 #include <Arduino.h>
 
 time_t calculateNextSend(time_t now, time_t lastSent, int intervalMin);
+// Sets the local timezone (ARMENIA_TZ_OFFSET) the way configTime() does,
+// without restarting SNTP
+void applyTimezone();
 String timeToStr(time_t t);
+// Heap-free variant: writes "YYYY-MM-DD HH:MM:SS" into buf (>= 20 bytes)
+void timeToBuf(time_t t, char *buf, size_t len);
+
+// The same, held on the stack for log arguments:
+//   logToSDf("Next wake: %s", timeText(t).str);
+struct TimeText { char str[20]; };
+TimeText timeText(time_t t);
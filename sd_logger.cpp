@@ -1,6 +1,11 @@
 #include "sd_logger.h"
 #include "json_utils.h"
 #include "rtc_utils.h"
+#include "circuit_breaker.h"
+#include "net_client.h"
+#include "arena.h"
+#include "num_format.h"
+#include "spsc_ring.h"
 #include "config.h"
 #include <SD.h>
 #include <SPI.h>
@@ -14,23 +19,229 @@
 #define SD_CS       13
 
 bool sdInitialized = false;
-String logBuffer = "";
+
+// ===================== Log records =====================
+// logToSD()/logDataToFile() only push fixed-size records into the ring; the
+// writer task pinned to LOG_WRITER_CORE formats them and does all SD I/O, so
+// a slow card never stalls sampling on the main core.
+
+enum LogRecordKind : uint8_t {
+  REC_LOG,       // first (or only) chunk of a log message
+  REC_LOG_CONT,  // continuation chunk of the previous message
+  REC_DATA       // measurement row, formatted by the writer
+};
+
+struct LogRecord {
+  uint8_t  kind;
+  bool     more;      // another REC_LOG_CONT chunk follows
+  uint16_t length;    // text bytes used
+  time_t   timestamp;
+  union {
+    char            text[LOG_RECORD_TEXT];
+    MeasurementData data;
+  };
+};
+
+static_assert(LOG_RING_DATA_RESERVE < LOG_RING_RECORDS, "LOG_RING_DATA_RESERVE leaves no room for log lines");
+static SpscRing<LogRecord, LOG_RING_RECORDS> logRing;
+static std::atomic<uint32_t> droppedRecords{0};
+static std::atomic<uint32_t> flushRequested{0};
+static std::atomic<uint32_t> flushCompleted{0};
+static TaskHandle_t writerTask = nullptr;
+
+// ===================== Writer side =====================
+
+// Fixed log buffer — flushed once it holds LOG_BUFFER_SIZE bytes; the extra
+// capacity lets a full line land before the flush without reallocating
 const int LOG_BUFFER_SIZE = 1024;
+const int LOG_BUFFER_CAPACITY = 2048;
+static char   logBuffer[LOG_BUFFER_CAPACITY];
+static size_t logLength = 0;
+static uint32_t lostLogBytes = 0;  // dropped because the card couldn't be opened
+
+static bool writeLogBuffer() {
+  if (logLength == 0) return true;
+
+  File f = SD.open(SD_LOG_FILE, FILE_APPEND);
+  if (!f) {
+    #if DEBUG
+    Serial.println("[SD] Failed to open log file");
+    #endif
+    return false;
+  }
 
-static void appendRaw(const String& line) {
-  logBuffer += line + "\n";
+  f.write((const uint8_t *)logBuffer, logLength);
+  f.close();
+  logLength = 0;
+  return true;
+}
 
+// Appends raw bytes to the log buffer (no newline)
+static void appendRaw(const char *text, size_t len) {
   #if DEBUG
-  Serial.println(line);
+  Serial.write((const uint8_t *)text, len);
   #endif
 
-  if (logBuffer.length() >= LOG_BUFFER_SIZE) {
-    flushSDLog();
+  if (logLength + len > LOG_BUFFER_CAPACITY && !writeLogBuffer()) {
+    // Card unwritable: drop what's buffered rather than overrun the buffer
+    lostLogBytes += logLength;
+    logLength = 0;
+  }
+  if (len > LOG_BUFFER_CAPACITY) { // can't happen with record-sized chunks
+    lostLogBytes += len;
+    return;
+  }
+
+  memcpy(&logBuffer[logLength], text, len);
+  logLength += len;
+}
+
+// Formats a DATA row (field list and format from UFAR_LOG_CHANNELS in channels.h)
+static size_t formatDataRow(char *row, time_t timestamp, const MeasurementData &data) {
+  // Hand-assembled instead of snprintf: formatFixed() gives the same
+  // "%.2f"-style output without newlib's float printf
+  timeToBuf(timestamp, row, 25);
+  char *p = row + strlen(row);
+
+  static const char dataTag[] = " | DATA |";
+  memcpy(p, dataTag, sizeof(dataTag) - 1);
+  p += sizeof(dataTag) - 1;
+
+#define UFAR_LOG_FIELD(field, jsonKey, logKey, units, source, type, precision) \
+  {                                                                            \
+    static const char key[] = " " logKey "=";                                  \
+    memcpy(p, key, sizeof(key) - 1);                                           \
+    p += sizeof(key) - 1;                                                      \
+    p += UFAR_FORMAT_##type(p, data.field, precision);                         \
+  }
+  UFAR_LOG_CHANNELS(UFAR_LOG_FIELD)
+#undef UFAR_LOG_FIELD
+
+  *p++ = '\n';
+  return p - row;
+}
+
+static void writeRecord(const LogRecord &rec, bool &midLine) {
+  // A message whose continuation was dropped still ends its line
+  if (midLine && rec.kind != REC_LOG_CONT) {
+    appendRaw("\n", 1);
+    midLine = false;
+  }
+
+  if (rec.kind == REC_DATA) {
+    char row[UFAR_DATA_ROW_MAX];
+    appendRaw(row, formatDataRow(row, rec.timestamp, rec.data));
+    return;
+  }
+
+  if (rec.kind == REC_LOG) {
+    char prefix[40];
+    timeToBuf(rec.timestamp, prefix, sizeof(prefix));
+    strlcat(prefix, " | LOG  | ", sizeof(prefix));
+    appendRaw(prefix, strlen(prefix));
+  }
+  appendRaw(rec.text, rec.length);
+
+  if (rec.more) {
+    midLine = true;
+  } else {
+    appendRaw("\n", 1);
   }
 }
 
+static void logWriterTask(void *) {
+  LogRecord rec;
+  bool midLine = false;
+  unsigned long lastWrite = millis();
+
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+
+    // Snapshot the request before draining: everything pushed before it was
+    // raised is already visible in the ring
+    uint32_t requested = flushRequested.load(std::memory_order_acquire);
+
+    bool wroteData = false;
+    while (logRing.pop(rec)) {
+      writeRecord(rec, midLine);
+      wroteData |= (rec.kind == REC_DATA);
+      if (logLength >= LOG_BUFFER_SIZE) writeLogBuffer();
+    }
+
+    uint32_t dropped = droppedRecords.exchange(0);
+    if (dropped > 0) {
+      char msg[64];
+      int n = snprintf(msg, sizeof(msg), "[SD] WARNING: log ring full, %u record(s) dropped\n",
+                       (unsigned)dropped);
+      appendRaw(msg, n);
+    }
+
+    // Data rows are written immediately so they're never lost
+    bool flushNow = wroteData ||
+                    requested != flushCompleted.load(std::memory_order_relaxed) ||
+                    millis() - lastWrite >= LOG_FLUSH_INTERVAL_MS;
+    if (flushNow) {
+      if (writeLogBuffer() && lostLogBytes > 0) {
+        // Reported once the card takes writes again
+        char msg[64];
+        int n = snprintf(msg, sizeof(msg), "[SD] WARNING: log file unwritable, %u byte(s) lost\n",
+                         (unsigned)lostLogBytes);
+        lostLogBytes = 0;
+        appendRaw(msg, n);
+        writeLogBuffer();
+      }
+      lastWrite = millis();
+      flushCompleted.store(requested, std::memory_order_release);
+    }
+  }
+}
+
+// ===================== Producer side =====================
+
+static void pushRecord(const LogRecord &rec) {
+  bool queued;
+  if (rec.kind == REC_DATA) {
+    queued = logRing.push(rec);
+    if (!queued && writerTask) {
+      // Even the reserve is taken: wait for the writer, a row is never dropped
+      flushSDLog();
+      queued = logRing.push(rec);
+    }
+  } else {
+    // Log lines leave the reserved slots free for DATA rows
+    queued = logRing.size() < LOG_RING_RECORDS - LOG_RING_DATA_RESERVE && logRing.push(rec);
+  }
+  if (!queued) {
+    droppedRecords.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (writerTask) xTaskNotifyGive(writerTask);
+}
+
+// One consumer per ring: a second initSDCard() keeps the running writer
+static void startLogWriter() {
+  if (writerTask) return;
+  xTaskCreatePinnedToCore(logWriterTask, "sd_log", 6144, nullptr, 1, &writerTask, LOG_WRITER_CORE);
+}
+
 // ===================== SD init =====================
 
+// flushPendingQueue() swaps the queue by removing it and renaming the temp
+// file into place. A temp file found at boot is either the unsent remainder
+// from a flush cut off between those steps (no queue left) or a partial copy
+// from a flush cut off earlier (queue still intact).
+static void recoverPendingQueue() {
+  if (!SD.exists(SD_QUEUE_TMP_FILE)) return;
+
+  if (SD.exists(SD_QUEUE_FILE)) {
+    SD.remove(SD_QUEUE_TMP_FILE);
+    logToSD("[QUEUE] Discarded partial temp queue from an interrupted flush");
+  } else if (SD.rename(SD_QUEUE_TMP_FILE, SD_QUEUE_FILE)) {
+    logToSD("[QUEUE] Recovered queue from an interrupted flush");
+  } else {
+    logToSD("[QUEUE] ERROR: Cannot recover temp queue file");
+  }
+}
+
 bool initSDCard() {
   #if DEBUG
   Serial.println("[SD] Initializing SD card...");
@@ -71,7 +282,10 @@ bool initSDCard() {
     SD.mkdir(SD_LOG_DIR);
   }
 
+  startLogWriter();
+
   logToSD("[SYSTEM] ========== BOOT ==========");
+  recoverPendingQueue();
   flushSDLog();
 
   return true;
@@ -79,50 +293,74 @@ bool initSDCard() {
 
 // ===================== Logging =====================
 
-void logToSD(String message) {
+static void logLine(const char *message, size_t len) {
   if (!sdInitialized) {
     #if DEBUG
-    Serial.println(message);
+    Serial.write((const uint8_t *)message, len);
+    Serial.println();
     #endif
     return;
   }
 
-  time_t now = time(nullptr);
-  appendRaw(timeToStr(now) + " | LOG  | " + message);
+  LogRecord rec;
+  rec.kind = REC_LOG;
+  rec.timestamp = time(nullptr);
+  do {
+    size_t chunk = min(len, (size_t)LOG_RECORD_TEXT);
+    memcpy(rec.text, message, chunk);
+    rec.length = chunk;
+    message += chunk;
+    len -= chunk;
+    rec.more = (len > 0);
+    pushRecord(rec);
+    rec.kind = REC_LOG_CONT;
+  } while (len > 0);
+}
+
+void logToSD(const char *message) {
+  logLine(message, strlen(message));
+}
+
+void logToSDf(const char *fmt, ...) {
+  char message[256];
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(message, sizeof(message), fmt, args);
+  va_end(args);
+  if (n < 0) return;
+  logLine(message, min((size_t)n, sizeof(message) - 1));
 }
 
+// Barrier: blocks until every record pushed so far is written to the card.
+// Must be called before deep sleep, restart, or reading the log file.
 void flushSDLog() {
-  if (!sdInitialized || logBuffer.length() == 0) return;
+  if (!sdInitialized || !writerTask) return;
 
-  File f = SD.open(SD_LOG_FILE, FILE_APPEND);
-  if (!f) {
-    #if DEBUG
-    Serial.println("[SD] Failed to open log file");
-    #endif
-    return;
-  }
+  uint32_t ticket = flushRequested.fetch_add(1, std::memory_order_acq_rel) + 1;
+  xTaskNotifyGive(writerTask);
 
-  f.print(logBuffer);
-  f.close();
-  logBuffer = "";
+  unsigned long start = millis();
+  while (flushCompleted.load(std::memory_order_acquire) != ticket &&
+         millis() - start < 5000) {
+    vTaskDelay(pdMS_TO_TICKS(2));
+  }
 }
 
 // ===================== Combined log: data row =====================
 
-// Writes a human-readable DATA line into the same daily log file.
+// Queues a human-readable DATA line for the same log file; the writer task
+// formats it and writes it straight through.
 // Always called regardless of transmission success.
-void logDataToFile(time_t timestamp, float temp, float hum, float press,
-                   float co2, int32_t voc, float pm1, float pm25, float pm10) {
+void logDataToFile(time_t timestamp, const MeasurementData &data) {
   if (!sdInitialized) return;
 
-  char row[160];
-  snprintf(row, sizeof(row),
-    "%s | DATA | temp=%.2f hum=%.2f press=%.2f co2=%.0f voc=%d pm1=%.2f pm2.5=%.2f pm10=%.2f",
-    timeToStr(timestamp).c_str(),
-    temp, hum, press, co2, voc, pm1, pm25, pm10);
-
-  appendRaw(String(row));
-  flushSDLog(); // flush immediately so data line is never lost
+  LogRecord rec;
+  rec.kind = REC_DATA;
+  rec.more = false;
+  rec.length = 0;
+  rec.timestamp = timestamp;
+  rec.data = data;
+  pushRecord(rec);
 }
 
 // ===================== S3 log mirror =====================
@@ -151,14 +389,23 @@ bool uploadLogToS3() {
     return false;
   }
 
-  String objectKey = "logs/device_" + String(DEVICE_ID) + "_log.txt";
-  String url = "https://" + String(S3_BUCKET) + ".s3." + String(S3_REGION) +
-               ".amazonaws.com/" + objectKey;
+  ArenaScope scope;
+  const size_t urlLen = 200;
+  char *url = arenaAlloc(urlLen);
+  if (!url) {
+    f.close();
+    return false;
+  }
+  snprintf(url, urlLen, "https://%s.s3.%s.amazonaws.com/logs/device_%s_log.txt",
+           S3_BUCKET, S3_REGION, DEVICE_ID);
 
-  logToSD("[S3-LOG] Streaming " + String(fileSize) + " bytes to: " + url);
+  logToSDf("[S3-LOG] Streaming %u bytes to: %s", (unsigned)fileSize, url);
 
   HTTPClient http;
-  http.begin(url);
+  if (!netBegin(http, url, S3_ROOT_CA, HTTP_TIMEOUT_MS)) {
+    f.close();
+    return false;
+  }
   http.addHeader("Content-Type", "text/plain");
   http.setTimeout(60000); // 60s — large files need more time
 
@@ -166,18 +413,18 @@ bool uploadLogToS3() {
   int status = http.sendRequest("PUT", &f, fileSize);
   f.close();
 
-  logToSD("[S3-LOG] Response code: " + String(status));
+  logToSDf("[S3-LOG] Response code: %d", status);
 
   if (status > 0 && status < 300) {
     logToSD("[S3-LOG] Log uploaded successfully");
-    http.end();
+    netEnd(http);
     return true;
   } else {
-    String errBody = http.getString();
-    if (errBody.length() > 0 && errBody.length() < 300) {
-      logToSD("[S3-LOG] Error: " + errBody);
+    const size_t LOGGED = 300;
+    char *errBody = arenaAlloc(LOGGED);
+    if (netEnd(http, errBody, errBody ? LOGGED : 0) > 0) {
+      logToSDf("[S3-LOG] Error: %s", errBody);
     }
-    http.end();
     return false;
   }
 }
@@ -187,13 +434,19 @@ bool uploadLogToS3() {
 // Each line is a complete JSON payload ready to POST/PUT as-is.
 // On reconnect, flushPendingQueue() replays each line and removes it if sent.
 
-void queueFailedData(time_t timestamp, MeasurementData data) {
+void queueFailedData(time_t timestamp, MeasurementData data, const AirQualityResult *aq) {
   if (!sdInitialized) {
     logToSD("[QUEUE] ERROR: SD not available, measurement lost");
     return;
   }
 
-  String payload = prepareJSON(DEVICE_ID, timestamp, data);
+  ArenaScope scope;
+  char *payload = arenaAlloc(QUEUE_LINE_MAX);
+  size_t len = payload ? prepareJSON(payload, QUEUE_LINE_MAX, DEVICE_ID, timestamp, data, aq) : 0;
+  if (len == 0) {
+    logToSD("[QUEUE] ERROR: Cannot build payload, measurement lost");
+    return;
+  }
 
   File f = SD.open(SD_QUEUE_FILE, FILE_APPEND);
   if (!f) {
@@ -201,10 +454,11 @@ void queueFailedData(time_t timestamp, MeasurementData data) {
     return;
   }
 
-  f.println(payload);
+  f.write((const uint8_t *)payload, len);
+  f.println();
   f.close();
 
-  logToSD("[QUEUE] Entry saved (" + String(payload.length()) + " bytes) → " + SD_QUEUE_FILE);
+  logToSDf("[QUEUE] Entry saved (%u bytes) → " SD_QUEUE_FILE, (unsigned)len);
 }
 
 bool hasPendingQueue() {
@@ -219,65 +473,121 @@ bool hasPendingQueue() {
   return hasData;
 }
 
-// Reads every line from the queue, tries to send each one (API + S3).
-// Entries that succeed are removed; failures are kept for the next attempt.
-// Returns true if the queue is now empty.
+// What this wake has spent replaying the queue. Plain statics, so they start
+// from zero on every boot while the queue itself persists on the card.
+static uint32_t flushSpentMs = 0;
+static size_t   flushSentBytes = 0;
+
+// Replays queued entries oldest-first until the first failure or until the
+// per-wake time/byte budget runs out. Sent entries are removed; the rest are
+// kept in order for the next wake. Skipped entirely while the uplink circuit
+// breaker is open. Returns true if the queue is now empty.
 bool flushPendingQueue() {
   if (!sdInitialized || !SD.exists(SD_QUEUE_FILE)) return true;
 
+  if (!uplinkAllowed()) {
+    logToSD("[QUEUE] Uplink backing off, leaving queue for a later wake");
+    return false;
+  }
+
+  const uint32_t budgetMs = QUEUE_FLUSH_BUDGET_SEC * 1000UL;
+  if (flushSpentMs >= budgetMs || flushSentBytes >= QUEUE_FLUSH_BUDGET_BYTES) {
+    logToSD("[QUEUE] Flush budget for this wake already spent");
+    return false;
+  }
+
   File f = SD.open(SD_QUEUE_FILE, FILE_READ);
   if (!f) {
     logToSD("[QUEUE] ERROR: Cannot open queue for reading");
     return false;
   }
 
-  // Read all lines into memory (queue should stay small — one entry per failed cycle)
-  std::vector<String> pending;
-  while (f.available()) {
-    String line = f.readStringUntil('\n');
-    line.trim();
-    if (line.length() > 0) {
-      pending.push_back(line);
-    }
-  }
-  f.close();
+  logToSDf("[QUEUE] Replaying queued entries (budget left %u ms, %u bytes)...",
+           (unsigned)(budgetMs - flushSpentMs),
+           (unsigned)(QUEUE_FLUSH_BUDGET_BYTES - flushSentBytes));
 
-  if (pending.empty()) {
-    SD.remove(SD_QUEUE_FILE);
-    return true;
+  // One reusable line buffer from the arena instead of a String per entry
+  ArenaScope scope;
+  char *line = arenaAlloc(QUEUE_LINE_MAX);
+  if (!line) {
+    f.close();
+    return false;
   }
 
-  logToSD("[QUEUE] Replaying " + String(pending.size()) + " queued entry/entries...");
+  SD.remove(SD_QUEUE_TMP_FILE);
+  File rest;
+
+  unsigned long start = millis();
+  int sent = 0, dropped = 0, kept = 0;
+  bool stopped = false;
 
-  std::vector<String> failed;
-  for (auto& payload : pending) {
-    bool ok = sendHTTP(payload);
+  while (f.available()) {
+    size_t len = f.readBytesUntil('\n', line, QUEUE_LINE_MAX);
+    if (len == QUEUE_LINE_MAX) {
+      // Longer than any payload we produce — skip the remainder and drop it
+      while (f.available() && f.read() != '\n') {}
+      logToSD("[QUEUE] Oversized entry, dropping");
+      continue;
+    }
+    while (len > 0 && isspace((unsigned char)line[len - 1])) len--;
+    if (len == 0) continue;
+
+    if (!stopped) {
+      // The budget is hard: no request may run past what is left of it
+      uint32_t spentMs = flushSpentMs + (millis() - start);
+      bool overBudget = (spentMs >= budgetMs) ||
+                        (flushSentBytes > 0 && flushSentBytes + len > QUEUE_FLUSH_BUDGET_BYTES);
+      if (overBudget) {
+        logToSD("[QUEUE] Flush budget exhausted, deferring the rest");
+        stopped = true;
+      } else {
+        int status = 0;
+        uint32_t timeoutMs = uplinkIsProbing() ? HTTP_PROBE_TIMEOUT_MS : HTTP_TIMEOUT_MS;
+        timeoutMs = min(budgetMs - spentMs, timeoutMs);
+        if (sendHTTP(line, len, timeoutMs, &status)) {
+          sent++;
+          flushSentBytes += len;
+          continue;
+        }
+        if (payloadRejected(status)) {
+          // Backend is up but rejects this entry — retrying will never help
+          logToSDf("[QUEUE] Entry rejected (%d), dropping", status);
+          dropped++;
+          continue;
+        }
+        // Transport errors, 5xx, auth and rate limiting: keep this entry
+        // and the rest (sendHTTP() told the breaker)
+        logToSDf("[QUEUE] Entry failed (%d), stopping flush until next wake", status);
+        stopped = true;
+      }
+    }
 
-    if (ok) {
-      logToSD("[QUEUE] Entry sent successfully");
-    } else {
-      logToSD("[QUEUE] Entry still failing, keeping for next attempt");
-      failed.push_back(payload);
+    if (!rest) {
+      rest = SD.open(SD_QUEUE_TMP_FILE, FILE_WRITE);
+      if (!rest) {
+        logToSD("[QUEUE] ERROR: Cannot open temp queue file, keeping queue as-is");
+        f.close();
+        SD.remove(SD_QUEUE_TMP_FILE);
+        flushSpentMs += millis() - start;
+        return false;
+      }
     }
+    rest.write((const uint8_t *)line, len);
+    rest.write('\n');
+    kept++;
   }
+  f.close();
+  if (rest) rest.close();
+  flushSpentMs += millis() - start;
 
-  // Rewrite queue file with only the still-failed entries
+  // Swap in the remaining entries (or clear the queue if nothing is left).
+  // A reset between the two steps leaves only the temp file, which
+  // initSDCard() renames back into place.
   SD.remove(SD_QUEUE_FILE);
-
-  if (!failed.empty()) {
-    File fw = SD.open(SD_QUEUE_FILE, FILE_WRITE);
-    if (fw) {
-      for (auto& line : failed) {
-        fw.println(line);
-      }
-      fw.close();
-    }
-    logToSD("[QUEUE] " + String(failed.size()) + " entry/entries remain in queue");
-    return false;
+  if (kept > 0) {
+    SD.rename(SD_QUEUE_TMP_FILE, SD_QUEUE_FILE);
   }
 
-  logToSD("[QUEUE] All queued entries sent, queue cleared");
-  return true;
+  logToSDf("[QUEUE] Sent %d, dropped %d, %d entry/entries remain in queue", sent, dropped, kept);
+  return kept == 0;
 }
-
-
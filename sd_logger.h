@@ -3,17 +3,21 @@
 #include "json_utils.h"
 
 bool initSDCard();
-void logToSD(String message);
+void logToSD(const char *message);
+// printf-style variant that formats into a stack buffer (no String temporaries)
+void logToSDf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+// Blocks until all queued log/data records are on the card (drain barrier:
+// call before deep sleep, ESP.restart() or reading the log file)
 void flushSDLog();
 
 // Combined log file (logs + data lines, always written)
-void logDataToFile(time_t timestamp, float temp, float hum, float press,
-                   float co2, int32_t voc, float pm1, float pm25, float pm10);
+void logDataToFile(time_t timestamp, const MeasurementData &data);
 
 // Upload today's log file to S3 (called after a successful send cycle)
 bool uploadLogToS3();
 
 // Offline retry queue (only written on send failure, flushed when back online)
-void queueFailedData(time_t timestamp, MeasurementData data);
+void queueFailedData(time_t timestamp, MeasurementData data,
+                     const AirQualityResult *aq = nullptr);
 bool hasPendingQueue();
 bool flushPendingQueue();  // returns true if all entries sent successfully
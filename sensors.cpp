@@ -1,4 +1,6 @@
 #include "sensors.h"
+#include "sd_logger.h"
+#include "config.h"
 
 // ===================== BME280 =====================
 bool BME280Sensor::init(uint8_t address) {
@@ -32,27 +34,62 @@ bool BME280Sensor::read(float &temperature, float &humidity, float &pressure) {
 }
 
 // ===================== SCD30 =====================
+// Adafruit_SCD30::begin() soft-resets the sensor, starts continuous
+// measurement and sets a 2 s interval on every call, and the interval is
+// stored in the sensor's NVM. Any other SAMPLE_INTERVAL_SEC would mean two
+// NVM writes per boot (begin()'s and ours), so it is pinned to what begin()
+// writes instead of being reprogrammed here.
+static_assert(SAMPLE_INTERVAL_SEC == 2,
+              "SCD30 interval is set to 2 s by Adafruit_SCD30::begin() on every boot");
+
 bool SCD30Sensor::init() {
-    return scd30.begin();
+    if (!scd30.begin()) return false;
+    // Idle until start() during the cycle, whatever state begin() left
+    stop();
+
+    // ASC also lives in NVM but begin() leaves it alone: only write it on
+    // change, so power cycling the I2C rail never disturbs calibration
+    if (scd30.selfCalibrationEnabled() != (bool)SCD30_ASC_ENABLED) {
+        scd30.selfCalibrationEnabled((bool)SCD30_ASC_ENABLED);
+    }
+    return true;
 }
 
-void SCD30Sensor::start(uint16_t pressure_hPa) {
-    if (pressure_hPa > 0) {
-        scd30.startContinuousMeasurement(pressure_hPa);
-    } else {
-        scd30.startContinuousMeasurement();
+bool SCD30Driver::attach() {
+    delete i2c_dev;
+    i2c_dev = new Adafruit_I2CDevice(SCD30_I2C_ADDR, &Wire);
+    return i2c_dev->begin();
+}
+
+// After a reset mid-cycle: no reset, no start, no NVM writes
+bool SCD30Sensor::attach() {
+    return scd30.attach();
+}
+
+void SCD30Sensor::start(float pressure_hPa) {
+    // Ambient pressure in mbar (== hPa); 0 disables compensation
+    uint16_t mbar = 0;
+    if (pressure_hPa >= 700.0F && pressure_hPa <= 1400.0F) {
+        mbar = (uint16_t)lroundf(pressure_hPa);
     }
+    scd30.startContinuousMeasurement(mbar);
 }
 
 void SCD30Sensor::stop() {
-    // No real stop command, best we can do is slow it down
-    scd30.setMeasurementInterval(60);
+    writeCommand(0x0104); // Stop continuous measurement
 }
 
 void SCD30Sensor::sleep() {
     stop();
 }
 
+bool SCD30Sensor::writeCommand(uint16_t cmd) {
+    Wire.beginTransmission(SCD30_I2C_ADDR);
+    Wire.write(cmd >> 8);
+    Wire.write(cmd & 0xFF);
+    return (Wire.endTransmission() == 0);
+}
+
 bool SCD30Sensor::read(float &co2) {
     if (!scd30.dataReady()) return false;
     if (!scd30.read()) return false;
@@ -62,9 +99,49 @@ bool SCD30Sensor::read(float &co2) {
 }
 
 // ===================== SGP40 =====================
+// VOC algorithm state saved at the end of each cycle (survives deep sleep only)
+RTC_DATA_ATTR static VocAlgorithmParams rtcVocParams;
+RTC_DATA_ATTR static time_t rtcVocSavedAt = 0;
+RTC_DATA_ATTR static bool rtcVocValid = false;
+
 bool SGP40Sensor::init() {
     if (!sgp40.begin()) return false;
-    return sgp40.selfTest();
+    if (!sgp40.selfTest()) return false;
+    restoreVocState();
+    return true;
+}
+
+// The saved state stays valid until saveVocState() replaces it, so a wake
+// that ends before the VOC window doesn't throw the baseline away
+void SGP40Sensor::restoreVocState() {
+    VocAlgorithm_init(&vocParams);
+    vocReady = true;
+    if (!rtcVocValid) {
+        logToSD("[SGP40] VOC algorithm cold start");
+        return;
+    }
+
+    time_t gap = time(nullptr) - rtcVocSavedAt;
+    if (gap < 0 || gap > SGP40_STATE_MAX_AGE_SEC) {
+        logToSDf("[SGP40] Saved VOC state too old (%lds), cold start", (long)gap);
+    } else if (gap <= SGP40_STATE_FULL_RESTORE_SEC) {
+        // Short sleep: resume where we left off, past blackout/learning
+        vocParams = rtcVocParams;
+        logToSDf("[SGP40] VOC state restored after %lds", (long)gap);
+    } else {
+        // Long sleep: keep only the learned baseline (Sensirion's set_states path)
+        int32_t mean, std;
+        VocAlgorithm_get_states(&rtcVocParams, &mean, &std);
+        VocAlgorithm_set_states(&vocParams, mean, std);
+        logToSDf("[SGP40] VOC baseline restored after %lds", (long)gap);
+    }
+}
+
+void SGP40Sensor::saveVocState() {
+    if (!vocReady) return;  // init() failed: nothing newer than what's saved
+    rtcVocParams = vocParams;
+    rtcVocSavedAt = time(nullptr);
+    rtcVocValid = true;
 }
 
 void SGP40Sensor::start() {
@@ -73,6 +150,7 @@ void SGP40Sensor::start() {
 
 void SGP40Sensor::stop() {
     sgp40.heaterOff();
+    saveVocState();
 }
 
 void SGP40Sensor::sleep() {
@@ -80,7 +158,10 @@ void SGP40Sensor::sleep() {
 }
 
 bool SGP40Sensor::read(int32_t &vocIndex, float temperature, float humidity) {
-    vocIndex = sgp40.measureVocIndex(temperature, humidity);
+    uint16_t sraw = sgp40.measureRaw(temperature, humidity);
+    if (sraw == 0) return false;
+
+    VocAlgorithm_process(&vocParams, sraw, &vocIndex);
     return true;
 }
 
@@ -134,8 +215,8 @@ bool SPS30Sensor::wakeUp() {
     return result;
 }
 
-bool SPS30Sensor::read(float &pm1, float &pm25, float &pm10) {
-    // Check if data is ready
+bool SPS30Sensor::dataReady() {
+    // Read data-ready flag: 0x0202
     Wire.beginTransmission(SPS30_I2C_ADDR);
     Wire.write(0x02);
     Wire.write(0x02);
@@ -151,7 +232,11 @@ bool SPS30Sensor::read(float &pm1, float &pm25, float &pm10) {
     uint8_t crc = Wire.read();
     
     if (crc != calcCRC(ready_h, ready_l)) return false;
-    if (ready_l == 0x00) return false; // Not ready
+    return ready_l != 0x00;
+}
+
+bool SPS30Sensor::read(float &pm1, float &pm25, float &pm10, float *numberConc) {
+    if (!dataReady()) return false;
     
     // Read measured values: 0x0300
     Wire.beginTransmission(SPS30_I2C_ADDR);
@@ -170,10 +255,18 @@ bool SPS30Sensor::read(float &pm1, float &pm25, float &pm10) {
         data[i] = Wire.read();
     }
     
-    // Extract PM values (each float is 4 bytes + 2 CRC bytes)
+    // Extract PM values (each float is 4 bytes + 2 CRC bytes); the mass
+    // concentrations are PM1.0, PM2.5, PM4.0, PM10 in that order
     pm1  = bytesToFloatWithCRC(&data[0]);   // PM1.0
     pm25 = bytesToFloatWithCRC(&data[6]);   // PM2.5
-    pm10 = bytesToFloatWithCRC(&data[12]);  // PM10
+    pm10 = bytesToFloatWithCRC(&data[18]);  // PM10 (data[12] is PM4.0)
+
+    // Number concentrations follow the four mass values
+    if (numberConc) {
+        for (int i = 0; i < 5; i++) {
+            numberConc[i] = bytesToFloatWithCRC(&data[24 + i * 6]);
+        }
+    }
 
     return true;
 }
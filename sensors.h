@@ -21,17 +21,29 @@ private:
 };
 
 // ===================== SCD30 =====================
+#define SCD30_I2C_ADDR 0x61
+
+// Adafruit_SCD30::begin() always soft-resets and restarts the sensor;
+// attach() only connects the driver to it
+class SCD30Driver : public Adafruit_SCD30 {
+public:
+    bool attach();
+};
+
 class SCD30Sensor {
 public:
-    bool init();
-    void start(uint16_t pressure_hPa = 0); // optional pressure compensation
-    void stop();                           // no true stop, but interval can be increased
-    void sleep();                          // alias for stop
+    bool init();                        // leaves the sensor stopped, see start()
+    bool attach();                      // driver only, for a sensor left measuring
+    void start(float pressure_hPa = 0); // optional pressure compensation (700-1400 hPa)
+    void stop();                        // stop continuous measurement (0x0104)
+    void sleep();                       // alias for stop
 
     bool read(float &co2);
 
 private:
-    Adafruit_SCD30 scd30;
+    bool writeCommand(uint16_t cmd);
+
+    SCD30Driver scd30;
 };
 
 // ===================== SGP40 =====================
@@ -45,7 +57,14 @@ public:
     bool read(int32_t &vocIndex, float temperature = 25.0, float humidity = 50.0);
 
 private:
+    // VOC index is computed here from raw ticks (instead of measureVocIndex())
+    // so the algorithm state can be saved to RTC memory across deep sleep
+    void restoreVocState();
+    void saveVocState();
+
     Adafruit_SGP40 sgp40;
+    VocAlgorithmParams vocParams;
+    bool vocReady = false;  // vocParams initialized (or restored) this wake
 };
 
 // ===================== SPS30 =====================
@@ -58,7 +77,9 @@ public:
     bool stop();
     bool sleep();
     bool wakeUp();
-    bool read(float &pm1, float &pm25, float &pm10);
+    bool dataReady();   // true while measuring and a new sample is available
+    // numberConc (optional): 5 floats, #/cm3 for PM0.5, PM1.0, PM2.5, PM4.0, PM10
+    bool read(float &pm1, float &pm25, float &pm10, float *numberConc = nullptr);
 
 private:
     bool writeCommand(uint16_t cmd);
@@ -0,0 +1,20 @@
+#pragma once
+#include <Wire.h>
+
+// Fixed readings; enough for code paths that need a BME280
+class Adafruit_BME280 {
+public:
+  enum sensor_mode { MODE_SLEEP = 0, MODE_FORCED = 1, MODE_NORMAL = 3 };
+  enum sensor_sampling { SAMPLING_NONE, SAMPLING_X1, SAMPLING_X2, SAMPLING_X4, SAMPLING_X8, SAMPLING_X16 };
+  enum sensor_filter { FILTER_OFF, FILTER_X2, FILTER_X4, FILTER_X8, FILTER_X16 };
+  enum standby_duration { STANDBY_MS_0_5, STANDBY_MS_62_5, STANDBY_MS_125, STANDBY_MS_250,
+                          STANDBY_MS_500, STANDBY_MS_1000 };
+
+  bool begin(uint8_t address = 0x77) { return true; }
+  void setSampling(sensor_mode mode = MODE_NORMAL, sensor_sampling t = SAMPLING_X16,
+                   sensor_sampling p = SAMPLING_X16, sensor_sampling h = SAMPLING_X16,
+                   sensor_filter filter = FILTER_OFF, standby_duration standby = STANDBY_MS_0_5) {}
+  float readTemperature() { return 22.5f; }
+  float readHumidity() { return 41.0f; }
+  float readPressure() { return 87650.0f; }
+};
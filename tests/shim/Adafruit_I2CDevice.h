@@ -0,0 +1,18 @@
+#pragma once
+// Adafruit BusIO I2C device: begin() only probes the address, no command
+#include <Wire.h>
+
+class Adafruit_I2CDevice {
+public:
+  Adafruit_I2CDevice(uint8_t addr, TwoWire *theWire = &Wire) : addr_(addr), wire_(theWire) {}
+  bool begin(bool addr_detect = true) { return !addr_detect || detected(); }
+  bool detected() {
+    wire_->beginTransmission(addr_);
+    return wire_->endTransmission() == 0;
+  }
+  uint8_t address() { return addr_; }
+
+private:
+  uint8_t  addr_;
+  TwoWire *wire_;
+};
@@ -0,0 +1,41 @@
+#pragma once
+#include <Adafruit_I2CDevice.h>
+
+namespace shim {
+bool     scd30Begin();
+bool     scd30DataReady();
+bool     scd30Read(float &co2);
+bool     scd30Start(uint16_t pressure);
+bool     scd30SetInterval(uint16_t interval);
+uint16_t scd30Interval();
+bool     scd30Asc();
+bool     scd30SetAsc(bool enabled);
+}
+
+// Absent unless a test installs a CO2 source (shim::setScd30Co2()). begin()
+// does what the library's does: attach the I2C device, then soft reset,
+// start continuous measurement and set a 2 s interval. Reads need the
+// device attached.
+class Adafruit_SCD30 {
+public:
+  ~Adafruit_SCD30() { delete i2c_dev; }
+
+  bool begin(uint8_t address = 0x61) {
+    delete i2c_dev;
+    i2c_dev = new Adafruit_I2CDevice(address, &Wire);
+    if (!i2c_dev->begin()) return false;
+    return shim::scd30Begin();
+  }
+  bool dataReady() { return i2c_dev && shim::scd30DataReady(); }
+  bool read() { return i2c_dev && shim::scd30Read(CO2); }
+  bool startContinuousMeasurement(uint16_t pressure = 0) { return shim::scd30Start(pressure); }
+  bool setMeasurementInterval(uint16_t interval) { return shim::scd30SetInterval(interval); }
+  uint16_t getMeasurementInterval() { return shim::scd30Interval(); }
+  bool selfCalibrationEnabled() { return shim::scd30Asc(); }
+  bool selfCalibrationEnabled(bool enabled) { return shim::scd30SetAsc(enabled); }
+
+  float CO2 = 0, temperature = 0, relative_humidity = 0;
+
+protected:
+  Adafruit_I2CDevice *i2c_dev = nullptr;
+};
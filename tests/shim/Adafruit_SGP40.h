@@ -0,0 +1,17 @@
+#pragma once
+#include <Wire.h>
+#include "sensirion_voc_algorithm.h"
+
+namespace shim {
+bool     sgp40Present();
+uint16_t sgp40MeasureRaw();
+}
+
+// Absent unless a test installs an SRAW source (shim::setSgp40Raw())
+class Adafruit_SGP40 {
+public:
+  bool begin(TwoWire *wire = &Wire) { return shim::sgp40Present(); }
+  bool selfTest() { return shim::sgp40Present(); }
+  bool heaterOff() { return shim::sgp40Present(); }
+  uint16_t measureRaw(float temperature = 25, float humidity = 50) { return shim::sgp40MeasureRaw(); }
+};
@@ -0,0 +1,207 @@
+#pragma once
+// Host stand-in for the parts of the Arduino-ESP32 core the firmware uses.
+// Time is simulated (see shim.h); everything else behaves like the target
+// closely enough for the host tests in tests/.
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <string>
+#include "freertos_shim.h"
+
+using std::min;
+using std::max;
+
+// Named sections so shim::runWake() can carry RTC memory from one wake
+// process to the next (see shim.h)
+#define RTC_DATA_ATTR   __attribute__((section("ufar_rtc_data")))
+#define RTC_NOINIT_ATTR __attribute__((section("ufar_rtc_noinit")))
+#define IRAM_ATTR
+
+#define HIGH   1
+#define LOW    0
+#define INPUT  0
+#define OUTPUT 1
+#define DEC    10
+#define HEX    16
+
+typedef uint8_t byte;
+
+// ===================== String =====================
+// Buffers are also allocated from the simulated heap in shim.cpp, sized the
+// way the ESP32 core's WString sizes them: up to SSO_CHARS characters inline,
+// longer strings in a block reallocated to the exact length on growth.
+namespace shim {
+size_t heapAlloc(size_t bytes);  // block handle, 0 if the heap is exhausted
+void   heapFree(size_t block);
+}
+
+class String {
+public:
+  String() {}
+  String(const char *s) : s_(s ? s : "") { fit(); }
+  String(const std::string &s) : s_(s) { fit(); }
+  explicit String(char c) : s_(1, c) {}
+  String(int v, unsigned base = DEC)                { fmtInt(v, base); fit(); }
+  String(unsigned v, unsigned base = DEC)           { fmtUnsigned(v, base); fit(); }
+  String(long v, unsigned base = DEC)               { fmtInt(v, base); fit(); }
+  String(unsigned long v, unsigned base = DEC)      { fmtUnsigned(v, base); fit(); }
+  String(long long v, unsigned base = DEC)          { fmtInt(v, base); fit(); }
+  String(unsigned long long v, unsigned base = DEC) { fmtUnsigned(v, base); fit(); }
+  String(float v, unsigned decimals = 2)            { fmtFloat(v, decimals); fit(); }
+  String(double v, unsigned decimals = 2)           { fmtFloat(v, decimals); fit(); }
+  String(const String &o) : s_(o.s_) { fit(); }
+  String(String &&o) noexcept : s_(std::move(o.s_)), block_(o.block_), cap_(o.cap_) {
+    o.block_ = 0;
+    o.cap_ = 0;
+  }
+  ~String() { shim::heapFree(block_); }
+  String &operator=(const String &o) { s_ = o.s_; fit(); return *this; }
+  String &operator=(String &&o) noexcept {
+    std::swap(s_, o.s_);
+    std::swap(block_, o.block_);
+    std::swap(cap_, o.cap_);
+    return *this;
+  }
+
+  const char *c_str() const { return s_.c_str(); }
+  unsigned length() const { return s_.size(); }
+  bool isEmpty() const { return s_.empty(); }
+  void reserve(unsigned n) { s_.reserve(n); fit(n); }
+
+  String &operator+=(const String &o) { s_ += o.s_; fit(); return *this; }
+  String &operator+=(const char *o) { s_ += o; fit(); return *this; }
+  String &operator+=(char c) { s_ += c; fit(); return *this; }
+  bool concat(const char *p, unsigned n) { s_.append(p, n); fit(); return true; }
+  friend String operator+(String a, const String &b) { a += b; return a; }
+  friend String operator+(String a, const char *b) { a += b; return a; }
+  friend String operator+(const char *a, const String &b) { String r(a); r += b; return r; }
+  bool operator==(const String &o) const { return s_ == o.s_; }
+  bool operator==(const char *o) const { return s_ == o; }
+  bool operator!=(const String &o) const { return s_ != o.s_; }
+  char operator[](unsigned i) const { return i < s_.size() ? s_[i] : 0; }
+
+  int indexOf(char c, unsigned from = 0) const { return pos(s_.find(c, from)); }
+  int indexOf(const char *p, unsigned from = 0) const { return pos(s_.find(p, from)); }
+  String substring(unsigned from) const { return from < s_.size() ? String(s_.substr(from)) : String(); }
+  String substring(unsigned from, unsigned to) const {
+    if (from > to) std::swap(from, to);
+    return from < s_.size() ? String(s_.substr(from, to - from)) : String();
+  }
+  bool startsWith(const char *p) const { return s_.compare(0, strlen(p), p) == 0; }
+  bool endsWith(const char *p) const {
+    size_t n = strlen(p);
+    return n <= s_.size() && s_.compare(s_.size() - n, n, p) == 0;
+  }
+  void trim();
+  long toInt() const { return atol(s_.c_str()); }
+  float toFloat() const { return atof(s_.c_str()); }
+
+private:
+  static const size_t SSO_CHARS = 11;
+  static int pos(size_t p) { return p == std::string::npos ? -1 : (int)p; }
+  void fit() { fit(s_.size()); }
+  void fit(size_t n) {
+    if (n <= cap_ || (!block_ && n <= SSO_CHARS)) return;
+    shim::heapFree(block_);  // realloc: freed and reallocated first-fit
+    block_ = shim::heapAlloc(n + 1);
+    cap_ = n;
+  }
+  void fmtInt(long long v, unsigned base);
+  void fmtUnsigned(unsigned long long v, unsigned base);
+  void fmtFloat(double v, unsigned decimals);
+
+  std::string s_;
+  size_t      block_ = 0;
+  size_t      cap_ = 0;
+};
+
+// ===================== Print / Stream =====================
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buf, size_t n) {
+    size_t i = 0;
+    while (i < n && write(buf[i])) i++;
+    return i;
+  }
+  size_t write(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+  size_t write(const char *buf, size_t n) { return write((const uint8_t *)buf, n); }
+
+  size_t print(const char *s) { return write(s); }
+  size_t print(const String &s) { return write(s.c_str(), s.length()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int v) { return print(String(v)); }
+  size_t print(unsigned v) { return print(String(v)); }
+  size_t print(long v) { return print(String(v)); }
+  size_t print(unsigned long v) { return print(String(v)); }
+  size_t print(double v, int decimals = 2) { return print(String(v, decimals)); }
+  size_t println() { return write("\r\n"); }
+  template <typename T> size_t println(const T &v) { size_t n = print(v); return n + println(); }
+  size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual void flush() {}
+
+  void setTimeout(unsigned long ms) { timeout_ = ms; }
+  virtual size_t readBytes(char *buf, size_t n);
+  size_t readBytes(uint8_t *buf, size_t n) { return readBytes((char *)buf, n); }
+  size_t readBytesUntil(char terminator, char *buf, size_t n);
+  String readString();
+  String readStringUntil(char terminator);
+
+protected:
+  unsigned long timeout_ = 1000;
+};
+
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long) {}
+  operator bool() const { return true; }
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buf, size_t n) override;
+  using Print::write;
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+};
+extern HardwareSerial Serial;
+
+// ===================== Core =====================
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+
+class EspClass {
+public:
+  [[noreturn]] void restart();
+  uint32_t getFreeHeap();
+  uint32_t getMinFreeHeap();
+  uint32_t getHeapSize();
+  uint32_t getCpuFreqMHz() { return 240; }
+};
+extern EspClass ESP;
+
+// newlib has these, glibc < 2.38 doesn't
+extern "C" size_t strlcpy(char *dst, const char *src, size_t size);
+extern "C" size_t strlcat(char *dst, const char *src, size_t size);
+
+// esp32-hal-time
+void configTime(long gmtOffsetSec, int daylightOffsetSec, const char *server1,
+                const char *server2 = nullptr, const char *server3 = nullptr);
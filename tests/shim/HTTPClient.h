@@ -0,0 +1,62 @@
+#pragma once
+// HTTPClient over the simulated network: each request is answered by the
+// handler installed with shim::setHttpHandler(), or on a routed connection
+// (shim::routeToLoopback()) by the server listening there. Either way the
+// response is read off the connection like the ESP32 HTTPClient does: status
+// line and headers by the request, the body left on the stream for the
+// caller, end() flush()ing what arrived before keeping the connection.
+#include <WiFi.h>
+#include <string>
+
+#define HTTPC_ERROR_CONNECTION_REFUSED  (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED  (-2)
+#define HTTPC_ERROR_NOT_CONNECTED       (-4)
+#define HTTPC_ERROR_CONNECTION_LOST     (-5)
+#define HTTPC_ERROR_NO_HTTP_SERVER      (-7)
+#define HTTPC_ERROR_READ_TIMEOUT        (-11)
+
+typedef enum {
+  HTTPC_DISABLE_FOLLOW_REDIRECTS,
+  HTTPC_STRICT_FOLLOW_REDIRECTS,
+  HTTPC_FORCE_FOLLOW_REDIRECTS
+} followRedirects_t;
+
+class HTTPClient {
+public:
+  bool begin(WiFiClient &client, const String &url);
+  void end();
+  void setReuse(bool reuse) { reuse_ = reuse; }
+  void setTimeout(uint16_t ms) { timeoutMs_ = ms; }
+  void setConnectTimeout(int32_t ms) {}
+  void setFollowRedirects(followRedirects_t) {}
+  void addHeader(const String &name, const String &value) {}
+
+  int GET();
+  int POST(uint8_t *payload, size_t size);
+  int POST(const String &payload) { return POST((uint8_t *)payload.c_str(), payload.length()); }
+  int PUT(uint8_t *payload, size_t size) { return sendRequest("PUT", payload, size); }
+  int sendRequest(const char *method, uint8_t *payload = nullptr, size_t size = 0);
+  int sendRequest(const char *method, Stream *stream, size_t size);
+
+  int getSize() { return size_; }  // Content-Length, or -1 (chunked or none)
+  String getString();
+  int writeToStream(Stream *stream);  // the body, chunk framing removed; then end()
+  WiFiClient *getStreamPtr() { return client_; }
+  WiFiClient &getStream() { return *client_; }
+  static String errorToString(int error);
+
+private:
+  int request(const char *method, std::string body);
+  int fail(int error);
+  bool waitForData();
+  bool readLine(std::string &line);
+  int copyBody(Stream *stream, int len);
+
+  WiFiClient *client_ = nullptr;
+  std::string url_;
+  uint16_t    timeoutMs_ = 5000;
+  int         size_ = -1;
+  bool        chunked_ = false;
+  bool        reuse_ = true;
+  bool        canReuse_ = true;  // the response allows keep-alive
+};
@@ -0,0 +1,20 @@
+#pragma once
+#include <HTTPClient.h>
+#include <functional>
+
+enum HTTPUpdateResult { HTTP_UPDATE_FAILED, HTTP_UPDATE_NO_UPDATES, HTTP_UPDATE_OK };
+typedef HTTPUpdateResult t_httpUpdate_return;
+
+// Fetches the binary through the shim network; a 200 counts as flashed
+class HTTPUpdate {
+public:
+  void onProgress(std::function<void(int, int)> cb) { progress_ = cb; }
+  void rebootOnUpdate(bool reboot) {}
+  t_httpUpdate_return update(WiFiClient &client, const String &url);
+  String getLastErrorString() { return lastError_; }
+
+private:
+  std::function<void(int, int)> progress_;
+  String lastError_;
+};
+extern HTTPUpdate httpUpdate;
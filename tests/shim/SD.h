@@ -0,0 +1,52 @@
+#pragma once
+// In-memory SD card (FS::File / SDFS subset); contents are inspected and
+// seeded by tests through shim.h
+#include <Arduino.h>
+#include <memory>
+
+#define FILE_READ   "r"
+#define FILE_WRITE  "w"
+#define FILE_APPEND "a"
+
+typedef enum { CARD_NONE, CARD_MMC, CARD_SD, CARD_SDHC, CARD_UNKNOWN } sdcard_type_t;
+
+struct ShimOpenFile;
+
+class File : public Stream {
+public:
+  File() {}
+  explicit File(std::shared_ptr<ShimOpenFile> f) : f_(std::move(f)) {}
+
+  operator bool() const { return (bool)f_; }
+  void close();
+  size_t size() const;
+  size_t position() const;
+  bool seek(uint32_t pos);
+  const char *name() const;
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *buf, size_t n) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t read(uint8_t *buf, size_t n);
+  size_t readBytes(char *buf, size_t n) override { return read((uint8_t *)buf, n); }
+  void flush() override {}
+
+private:
+  std::shared_ptr<ShimOpenFile> f_;
+};
+
+class SDFS {
+public:
+  bool begin(uint8_t ssPin = 5) { return true; }
+  sdcard_type_t cardType() { return CARD_SDHC; }
+  uint64_t cardSize() { return 32ULL << 30; }
+  bool exists(const char *path);
+  bool mkdir(const char *path) { return true; }
+  File open(const char *path, const char *mode = FILE_READ);
+  bool remove(const char *path);
+  bool rename(const char *from, const char *to);
+};
+extern SDFS SD;
@@ -0,0 +1,89 @@
+#pragma once
+#include <Arduino.h>
+
+typedef enum {
+  WL_IDLE_STATUS   = 0,
+  WL_CONNECTED     = 3,
+  WL_DISCONNECTED  = 6
+} wl_status_t;
+
+typedef enum { WIFI_OFF = 0, WIFI_STA = 1 } wifi_mode_t;
+
+class IPAddress {
+public:
+  IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : a_{a, b, c, d} {}
+  String toString() const;
+  uint8_t operator[](int i) const { return a_[i]; }
+
+private:
+  uint8_t a_[4];
+};
+
+class WiFiClass {
+public:
+  bool mode(wifi_mode_t m);
+  wl_status_t begin(const char *ssid, const char *pass);
+  wl_status_t status();
+  bool disconnect(bool wifiOff = false);
+  IPAddress localIP() { return IPAddress(192, 168, 4, 20); }
+
+private:
+  wifi_mode_t mode_ = WIFI_OFF;
+  bool        joined_ = false;
+};
+extern WiFiClass WiFi;
+
+class Client : public Stream {
+public:
+  virtual int connect(const char *host, uint16_t port) = 0;
+  virtual int read(uint8_t *buf, size_t size) = 0;
+  using Stream::read;
+  virtual void stop() = 0;
+  virtual uint8_t connected() = 0;
+  virtual operator bool() = 0;
+};
+
+// Simulated TCP connection: connect() succeeds while the shim network is up
+// (see shim::setNetworkUp). Response bytes are queued by HTTPClient.
+// Hosts routed with shim::routeToLoopback() get a real socket instead, and
+// every byte goes over it: a TLS client runs on top, and HTTPClient speaks
+// HTTP/1.1 to whatever listens there.
+class WiFiClient : public Client {
+public:
+  virtual ~WiFiClient() { stop(); }
+
+  int connect(const char *host, uint16_t port) override { return connect(host, port, 3000); }
+  virtual int connect(const char *host, uint16_t port, int32_t timeoutMs);
+  void stop() override;
+  uint8_t connected() override;
+  operator bool() override { return connected(); }
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *buf, size_t n) override;
+  using Print::write;
+  // On a real socket, gives the peer up to a millisecond (real time) to
+  // deliver before reporting nothing, like bytes still in flight
+  int available() override;
+  int read() override;
+  int read(uint8_t *buf, size_t n) override;
+  int peek() override;
+  void flush() override;  // discards what has arrived, as on the ESP32
+
+  // Shim: bytes the "server" sent on a simulated connection, after any the
+  // client hasn't read yet
+  void shimReceive(const std::string &bytes) {
+    rx_.erase(0, rxPos_);
+    rxPos_ = 0;
+    rx_ += bytes;
+  }
+  // Shim: drop the connection as if the peer/NAT closed it
+  void shimDrop() { connected_ = false; }
+  // Shim: the real socket of a routed connection, or -1
+  int shimFd() const { return fd_; }
+
+protected:
+  bool        connected_ = false;
+  int         fd_ = -1;
+  std::string rx_;
+  size_t      rxPos_ = 0;
+};
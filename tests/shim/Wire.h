@@ -0,0 +1,43 @@
+#pragma once
+// I2C bus: transactions go to the shim's emulated devices (see shim.h,
+// Sensors); any other address is NACKed
+#include <Arduino.h>
+#include <string>
+
+namespace shim {
+uint8_t     i2cTransmit(uint8_t address, const std::string &bytes);  // endTransmission() status
+std::string i2cRequest(uint8_t address, size_t size);                // empty: NACK
+}
+
+class TwoWire : public Stream {
+public:
+  bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0) { return true; }
+  bool setClock(uint32_t frequency) { return true; }
+  void setTimeOut(uint16_t ms) {}
+  void beginTransmission(uint16_t address) {
+    address_ = (uint8_t)address;
+    tx_.clear();
+  }
+  uint8_t endTransmission(bool sendStop = true) { return shim::i2cTransmit(address_, tx_); }
+  uint8_t requestFrom(uint16_t address, uint8_t size) {
+    rx_ = shim::i2cRequest((uint8_t)address, size);
+    rxPos_ = 0;
+    return (uint8_t)rx_.size();
+  }
+
+  size_t write(uint8_t c) override {
+    tx_ += (char)c;
+    return 1;
+  }
+  using Print::write;
+  size_t write(int c) { return write((uint8_t)c); }
+  int available() override { return (int)(rx_.size() - rxPos_); }
+  int read() override { return rxPos_ < rx_.size() ? (uint8_t)rx_[rxPos_++] : -1; }
+  int peek() override { return rxPos_ < rx_.size() ? (uint8_t)rx_[rxPos_] : -1; }
+
+private:
+  uint8_t     address_ = 0;
+  std::string tx_, rx_;
+  size_t      rxPos_ = 0;
+};
+extern TwoWire Wire;
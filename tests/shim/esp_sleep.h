@@ -0,0 +1,11 @@
+#pragma once
+#include <stdint.h>
+
+typedef enum {
+  ESP_SLEEP_WAKEUP_UNDEFINED = 0,
+  ESP_SLEEP_WAKEUP_TIMER     = 4
+} esp_sleep_wakeup_cause_t;
+
+void esp_sleep_enable_timer_wakeup(uint64_t us);
+[[noreturn]] void esp_deep_sleep_start();
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause();
@@ -0,0 +1,10 @@
+#pragma once
+
+typedef enum {
+  SNTP_SYNC_STATUS_RESET,
+  SNTP_SYNC_STATUS_COMPLETED,
+  SNTP_SYNC_STATUS_IN_PROGRESS
+} sntp_sync_status_t;
+
+// COMPLETED once per sync, RESET before and after (see shim.h, Clock)
+sntp_sync_status_t sntp_get_sync_status();
@@ -0,0 +1,22 @@
+#pragma once
+// FreeRTOS task/notification API on top of std::thread (see shim.cpp)
+#include <stdint.h>
+
+typedef struct ShimTask *TaskHandle_t;
+typedef int      BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portMAX_DELAY     ((TickType_t)0xFFFFFFFF)
+#define pdTRUE            1
+#define pdFALSE           0
+#define pdPASS            1
+
+BaseType_t xTaskCreatePinnedToCore(void (*fn)(void *), const char *name, uint32_t stackDepth,
+                                   void *arg, UBaseType_t priority, TaskHandle_t *handle,
+                                   BaseType_t core);
+void       vTaskDelay(TickType_t ticks);
+void       xTaskNotifyGive(TaskHandle_t task);
+uint32_t   ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks);
+BaseType_t xPortGetCoreID();
@@ -0,0 +1,379 @@
+#pragma once
+// Minimal stand-in for the ArduinoJson 6 API used by the firmware, for hosts
+// without the library. Key order, nesting and types match; numbers print as
+// the shortest round-trip decimal, which the real library does not always do,
+// so byte-exact payload checks need the real one (ARDUINOJSON_DIR, see
+// tests/Makefile).
+#include <Arduino.h>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+struct JsonNode {
+  enum Type { Null, Bool, Int, Float, Double, Str, Arr, Obj } type = Null;
+  bool        b = false;
+  long long   i = 0;
+  double      f = 0;
+  std::string s;
+  std::vector<std::pair<std::string, std::unique_ptr<JsonNode>>> members;
+  std::vector<std::unique_ptr<JsonNode>> items;
+
+  void clear() { type = Null; s.clear(); members.clear(); items.clear(); }
+
+  JsonNode *member(const char *key, bool create) {
+    if (type != Obj) {
+      if (!create) return nullptr;
+      clear();
+      type = Obj;
+    }
+    for (auto &m : members) {
+      if (m.first == key) return m.second.get();
+    }
+    if (!create) return nullptr;
+    members.emplace_back(key, std::unique_ptr<JsonNode>(new JsonNode));
+    return members.back().second.get();
+  }
+
+  JsonNode *append() {
+    if (type != Arr) { clear(); type = Arr; }
+    items.emplace_back(new JsonNode);
+    return items.back().get();
+  }
+};
+
+class JsonArray;
+class JsonObject;
+
+class JsonVariant {
+public:
+  JsonVariant(JsonNode *n = nullptr) : n_(n) {}
+
+  JsonVariant &operator=(const char *v) {
+    if (n_) { n_->clear(); if (v) { n_->type = JsonNode::Str; n_->s = v; } }
+    return *this;
+  }
+  JsonVariant &operator=(char *v) { return *this = (const char *)v; }
+  JsonVariant &operator=(const String &v) { return *this = v.c_str(); }
+  JsonVariant &operator=(bool v) {
+    if (n_) { n_->clear(); n_->type = JsonNode::Bool; n_->b = v; }
+    return *this;
+  }
+  JsonVariant &operator=(float v) {
+    if (n_) { n_->clear(); n_->type = JsonNode::Float; n_->f = v; }
+    return *this;
+  }
+  JsonVariant &operator=(double v) {
+    if (n_) { n_->clear(); n_->type = JsonNode::Double; n_->f = v; }
+    return *this;
+  }
+  template <typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+  JsonVariant &operator=(T v) {
+    if (n_) { n_->clear(); n_->type = JsonNode::Int; n_->i = (long long)v; }
+    return *this;
+  }
+
+  JsonVariant operator[](const char *key) const { return JsonVariant(n_ ? n_->member(key, false) : nullptr); }
+  JsonVariant operator[](size_t index) const {
+    return JsonVariant(n_ && n_->type == JsonNode::Arr && index < n_->items.size() ? n_->items[index].get() : nullptr);
+  }
+
+  bool isNull() const { return !n_ || n_->type == JsonNode::Null; }
+  const char *operator|(const char *fallback) const {
+    return n_ && n_->type == JsonNode::Str ? n_->s.c_str() : fallback;
+  }
+  long operator|(long fallback) const { return n_ && n_->type == JsonNode::Int ? (long)n_->i : fallback; }
+  int operator|(int fallback) const { return n_ && n_->type == JsonNode::Int ? (int)n_->i : fallback; }
+  double operator|(double fallback) const {
+    if (!n_) return fallback;
+    if (n_->type == JsonNode::Int) return (double)n_->i;
+    if (n_->type == JsonNode::Float || n_->type == JsonNode::Double) return n_->f;
+    return fallback;
+  }
+
+  JsonNode *node() const { return n_; }
+
+protected:
+  JsonNode *n_;
+};
+
+class JsonObject : public JsonVariant {
+public:
+  JsonObject(JsonNode *n = nullptr) : JsonVariant(n) {}
+  JsonVariant operator[](const char *key) { return JsonVariant(n_ ? n_->member(key, true) : nullptr); }
+  JsonArray createNestedArray(const char *key);
+};
+
+class JsonArray : public JsonVariant {
+public:
+  JsonArray(JsonNode *n = nullptr) : JsonVariant(n) {
+    if (n_ && n_->type != JsonNode::Arr) { n_->clear(); n_->type = JsonNode::Arr; }
+  }
+  JsonObject createNestedObject() {
+    if (!n_) return JsonObject();
+    JsonNode *o = n_->append();
+    o->type = JsonNode::Obj;
+    return JsonObject(o);
+  }
+  template <typename T> bool add(const T &v) {
+    if (!n_) return false;
+    JsonVariant(n_->append()) = v;
+    return true;
+  }
+  size_t size() const { return n_ ? n_->items.size() : 0; }
+};
+
+inline JsonArray JsonObject::createNestedArray(const char *key) {
+  return JsonArray(n_ ? n_->member(key, true) : nullptr);
+}
+
+class JsonDocument {
+public:
+  JsonVariant operator[](const char *key) { return JsonVariant(root_.member(key, true)); }
+  JsonArray createNestedArray(const char *key) { return JsonArray(root_.member(key, true)); }
+  JsonObject as_object() { return JsonObject(&root_); }
+  void clear() { root_.clear(); }
+  JsonNode &root() { return root_; }
+  const JsonNode &root() const { return root_; }
+
+private:
+  JsonNode root_;
+};
+
+template <size_t N> class StaticJsonDocument : public JsonDocument {};
+
+class DynamicJsonDocument : public JsonDocument {
+public:
+  explicit DynamicJsonDocument(size_t capacity) {}
+};
+
+// ===================== Serialization =====================
+namespace shimjson {
+
+inline void writeNumber(std::string &out, double v, int maxDigits, bool asFloat) {
+  if (!isfinite(v)) { out += "null"; return; }
+  // Shortest round-trip digits; like ArduinoJson, no exponent between 1e-5
+  // and 1e7 (80, not 8e+01)
+  bool plain = v == 0 || (fabs(v) >= 1e-5 && fabs(v) < 1e7);
+  char buf[40];
+  for (int digits = 1; digits <= maxDigits; digits++) {
+    snprintf(buf, sizeof(buf), "%.*g", digits, v);
+    if (plain && strchr(buf, 'e')) continue;
+    if (asFloat ? (float)strtod(buf, nullptr) == (float)v : strtod(buf, nullptr) == v) break;
+  }
+  out += buf;
+}
+
+inline void writeString(std::string &out, const std::string &s) {
+  out += '"';
+  for (unsigned char c : s) {
+    switch (c) {
+      case '"':  out += "\\\""; break;
+      case '\\': out += "\\\\"; break;
+      case '\n': out += "\\n"; break;
+      case '\r': out += "\\r"; break;
+      case '\t': out += "\\t"; break;
+      default:
+        if (c < 0x20) {
+          char esc[8];
+          snprintf(esc, sizeof(esc), "\\u%04x", c);
+          out += esc;
+        } else {
+          out += (char)c;
+        }
+    }
+  }
+  out += '"';
+}
+
+inline void write(std::string &out, const JsonNode &n) {
+  switch (n.type) {
+    case JsonNode::Null:   out += "null"; break;
+    case JsonNode::Bool:   out += n.b ? "true" : "false"; break;
+    case JsonNode::Int:    out += std::to_string(n.i); break;
+    case JsonNode::Float:  writeNumber(out, n.f, 9, true); break;
+    case JsonNode::Double: writeNumber(out, n.f, 17, false); break;
+    case JsonNode::Str:    writeString(out, n.s); break;
+    case JsonNode::Arr:
+      out += '[';
+      for (size_t i = 0; i < n.items.size(); i++) {
+        if (i) out += ',';
+        write(out, *n.items[i]);
+      }
+      out += ']';
+      break;
+    case JsonNode::Obj:
+      out += '{';
+      for (size_t i = 0; i < n.members.size(); i++) {
+        if (i) out += ',';
+        writeString(out, n.members[i].first);
+        out += ':';
+        write(out, *n.members[i].second);
+      }
+      out += '}';
+      break;
+  }
+}
+
+// Recursive-descent parser; returns false on malformed or truncated input
+struct Parser {
+  const char *p, *end;
+
+  void ws() { while (p < end && isspace((unsigned char)*p)) p++; }
+
+  bool string(std::string &out) {
+    if (p >= end || *p != '"') return false;
+    p++;
+    while (p < end && *p != '"') {
+      char c = *p++;
+      if (c == '\\') {
+        if (p >= end) return false;
+        char e = *p++;
+        switch (e) {
+          case 'n': out += '\n'; break;
+          case 'r': out += '\r'; break;
+          case 't': out += '\t'; break;
+          case 'b': out += '\b'; break;
+          case 'f': out += '\f'; break;
+          case 'u': {
+            if (end - p < 4) return false;
+            unsigned cp = strtoul(std::string(p, 4).c_str(), nullptr, 16);
+            p += 4;
+            if (cp < 0x80) out += (char)cp;
+            else if (cp < 0x800) { out += (char)(0xC0 | (cp >> 6)); out += (char)(0x80 | (cp & 0x3F)); }
+            else { out += (char)(0xE0 | (cp >> 12)); out += (char)(0x80 | ((cp >> 6) & 0x3F)); out += (char)(0x80 | (cp & 0x3F)); }
+            break;
+          }
+          default: out += e;
+        }
+      } else {
+        out += c;
+      }
+    }
+    if (p >= end) return false;
+    p++;
+    return true;
+  }
+
+  bool value(JsonNode &n, int depth) {
+    if (depth > 10) return false;
+    ws();
+    if (p >= end) return false;
+    if (*p == '{') {
+      p++;
+      n.type = JsonNode::Obj;
+      ws();
+      if (p < end && *p == '}') { p++; return true; }
+      for (;;) {
+        ws();
+        std::string key;
+        if (!string(key)) return false;
+        ws();
+        if (p >= end || *p++ != ':') return false;
+        if (!value(*n.member(key.c_str(), true), depth + 1)) return false;
+        ws();
+        if (p >= end) return false;
+        if (*p == ',') { p++; continue; }
+        if (*p == '}') { p++; return true; }
+        return false;
+      }
+    }
+    if (*p == '[') {
+      p++;
+      n.type = JsonNode::Arr;
+      ws();
+      if (p < end && *p == ']') { p++; return true; }
+      for (;;) {
+        if (!value(*n.append(), depth + 1)) return false;
+        ws();
+        if (p >= end) return false;
+        if (*p == ',') { p++; continue; }
+        if (*p == ']') { p++; return true; }
+        return false;
+      }
+    }
+    if (*p == '"') {
+      n.type = JsonNode::Str;
+      return string(n.s);
+    }
+    if (end - p >= 4 && !strncmp(p, "null", 4)) { p += 4; n.type = JsonNode::Null; return true; }
+    if (end - p >= 4 && !strncmp(p, "true", 4)) { p += 4; n.type = JsonNode::Bool; n.b = true; return true; }
+    if (end - p >= 5 && !strncmp(p, "false", 5)) { p += 5; n.type = JsonNode::Bool; n.b = false; return true; }
+
+    std::string num;
+    while (p < end && (isdigit((unsigned char)*p) || strchr("+-.eE", *p))) num += *p++;
+    if (num.empty()) return false;
+    if (num.find_first_of(".eE") == std::string::npos) {
+      n.type = JsonNode::Int;
+      n.i = strtoll(num.c_str(), nullptr, 10);
+    } else {
+      n.type = JsonNode::Double;
+      n.f = strtod(num.c_str(), nullptr);
+    }
+    return true;
+  }
+};
+
+} // namespace shimjson
+
+inline size_t serializeJson(const JsonDocument &doc, String &out) {
+  std::string s;
+  shimjson::write(s, doc.root());
+  out = String(s);
+  return s.size();
+}
+
+inline size_t serializeJson(const JsonDocument &doc, char *out, size_t size) {
+  std::string s;
+  shimjson::write(s, doc.root());
+  if (size == 0) return 0;
+  size_t n = std::min(s.size(), size - 1);
+  memcpy(out, s.data(), n);
+  out[n] = '\0';
+  return n;
+}
+
+inline size_t measureJson(const JsonDocument &doc) {
+  std::string s;
+  shimjson::write(s, doc.root());
+  return s.size();
+}
+
+class DeserializationError {
+public:
+  enum Code { Ok, EmptyInput, IncompleteInput, InvalidInput, NoMemory };
+  DeserializationError(Code c = Ok) : code_(c) {}
+  explicit operator bool() const { return code_ != Ok; }
+  Code code() const { return code_; }
+  const char *c_str() const {
+    static const char *names[] = { "Ok", "EmptyInput", "IncompleteInput", "InvalidInput", "NoMemory" };
+    return names[code_];
+  }
+
+private:
+  Code code_;
+};
+
+inline DeserializationError deserializeJson(JsonDocument &doc, const char *input, size_t len) {
+  doc.clear();
+  shimjson::Parser parser{ input, input + len };
+  parser.ws();
+  if (parser.p == parser.end) return DeserializationError::EmptyInput;
+  if (!parser.value(doc.root(), 0)) {
+    doc.clear();
+    return parser.p >= parser.end ? DeserializationError::IncompleteInput : DeserializationError::InvalidInput;
+  }
+  return DeserializationError::Ok;
+}
+
+inline DeserializationError deserializeJson(JsonDocument &doc, const char *input) {
+  return deserializeJson(doc, input, strlen(input));
+}
+
+inline DeserializationError deserializeJson(JsonDocument &doc, char *input, size_t len) {
+  return deserializeJson(doc, (const char *)input, len);
+}
+
+inline DeserializationError deserializeJson(JsonDocument &doc, const String &input) {
+  return deserializeJson(doc, input.c_str(), input.length());
+}
@@ -0,0 +1,81 @@
+// Behavioural model of Sensirion's VOC index algorithm for the host tests.
+// Same API, state fields and persistence semantics as the library: a blackout
+// after init, a baseline (mean/std of SRAW) learned fast at first and then
+// over ~12 h, and get/set_states carrying only that baseline. The mapping
+// from SRAW to index is simpler, so values are not bit-exact.
+#include "sensirion_voc_algorithm.h"
+#include <math.h>
+#include <string.h>
+
+static const int32_t BLACKOUT_SAMPLES = 45;          // 1 s sampling, like the library
+static const double  LEARNING_TIME_SEC = 12 * 3600;
+static const double  STD_INITIAL = 50;
+static const int32_t PERSISTENCE_UPTIME_GAMMA = 3 * 3600;
+static const int32_t SRAW_MIN = 20001, SRAW_MAX = 52767;
+
+// Fixed point as in the library: Q16.16, SRAW offset by 20000
+static int32_t f16(double v) { return (int32_t)lround(v * 65536.0); }
+static double  unf16(int32_t v) { return v / 65536.0; }
+
+void VocAlgorithm_init(VocAlgorithmParams *params) {
+  memset(params, 0, sizeof(*params));
+  params->mVoc_Index_Offset = f16(100);
+}
+
+void VocAlgorithm_get_states(VocAlgorithmParams *params, int32_t *state0, int32_t *state1) {
+  *state0 = params->m_Mean_Variance_Estimator___Mean + params->m_Mean_Variance_Estimator___Sraw_Offset;
+  *state1 = params->m_Mean_Variance_Estimator___Std;
+}
+
+// Restores the baseline only; the blackout (mUptime) still runs
+void VocAlgorithm_set_states(VocAlgorithmParams *params, int32_t state0, int32_t state1) {
+  params->m_Mean_Variance_Estimator___Initialized = 1;
+  params->m_Mean_Variance_Estimator___Mean = 0;
+  params->m_Mean_Variance_Estimator___Sraw_Offset = state0;
+  params->m_Mean_Variance_Estimator___Std = state1;
+  params->m_Mean_Variance_Estimator___Uptime_Gamma = PERSISTENCE_UPTIME_GAMMA;
+  params->mSraw = state0;
+}
+
+void VocAlgorithm_process(VocAlgorithmParams *params, int32_t sraw, int32_t *vocIndex) {
+  if (params->mUptime <= BLACKOUT_SAMPLES) {
+    params->mUptime++;
+    *vocIndex = 0;
+    return;
+  }
+
+  sraw = sraw < SRAW_MIN ? SRAW_MIN : sraw > SRAW_MAX ? SRAW_MAX : sraw;
+  double x = sraw - 20000;
+  params->mSraw = f16(x);
+
+  int32_t &initialized = params->m_Mean_Variance_Estimator___Initialized;
+  int32_t &uptimeGamma = params->m_Mean_Variance_Estimator___Uptime_Gamma;
+  if (!initialized) {
+    initialized = 1;
+    params->m_Mean_Variance_Estimator___Sraw_Offset = f16(x);
+    params->m_Mean_Variance_Estimator___Mean = 0;
+    params->m_Mean_Variance_Estimator___Std = f16(STD_INITIAL);
+    uptimeGamma = 0;
+  }
+
+  double offset = unf16(params->m_Mean_Variance_Estimator___Sraw_Offset);
+  double mean = offset + unf16(params->m_Mean_Variance_Estimator___Mean);
+  double std = unf16(params->m_Mean_Variance_Estimator___Std);
+
+  // Index from the baseline before this sample: 100 = typical, higher = more VOC
+  double z = (mean - x) / std;
+  double index = 500.0 / (1.0 + 4.0 * exp(-z));
+  *vocIndex = (int32_t)lround(index < 1 ? 1 : index > 500 ? 500 : index);
+  params->mVoc_Index = *vocIndex;
+
+  // Fast learning at first, settling to the long learning time
+  if (uptimeGamma < 0x7FFFFFFF) uptimeGamma++;
+  double gamma = fmax(1.0 / uptimeGamma, 1.0 / LEARNING_TIME_SEC);
+  double d = x - mean;
+  mean += gamma * d;
+  std = sqrt((1 - gamma) * std * std + gamma * d * d);
+  if (std < 1) std = 1;
+
+  params->m_Mean_Variance_Estimator___Mean = f16(mean - offset);
+  params->m_Mean_Variance_Estimator___Std = f16(std);
+}
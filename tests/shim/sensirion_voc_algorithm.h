@@ -0,0 +1,21 @@
+#pragma once
+// Sensirion VOC index algorithm API (behavioural model in sensirion_voc_algorithm.cpp)
+#include <stdint.h>
+
+typedef struct {
+  int32_t mVoc_Index_Offset;
+  int32_t mUptime;
+  int32_t mSraw;
+  int32_t mVoc_Index;
+  int32_t m_Mean_Variance_Estimator___Initialized;
+  int32_t m_Mean_Variance_Estimator___Mean;
+  int32_t m_Mean_Variance_Estimator___Sraw_Offset;
+  int32_t m_Mean_Variance_Estimator___Std;
+  int32_t m_Mean_Variance_Estimator___Uptime_Gamma;
+  int32_t m_Mean_Variance_Estimator___Uptime_Gating;
+} VocAlgorithmParams;
+
+void VocAlgorithm_init(VocAlgorithmParams *params);
+void VocAlgorithm_get_states(VocAlgorithmParams *params, int32_t *state0, int32_t *state1);
+void VocAlgorithm_set_states(VocAlgorithmParams *params, int32_t state0, int32_t state1);
+void VocAlgorithm_process(VocAlgorithmParams *params, int32_t sraw, int32_t *vocIndex);
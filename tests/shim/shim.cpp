@@ -0,0 +1,1378 @@
+#include "shim.h"
+#include <SD.h>
+#include <SPI.h>
+#include <Wire.h>
+#include <Adafruit_SCD30.h>
+#include <WiFi.h>
+#include <HTTPClient.h>
+#include <HTTPUpdate.h>
+#include <esp_sleep.h>
+#include <esp_heap_caps.h>
+#include <esp_sntp.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <strings.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <initializer_list>
+#include <map>
+#include <mutex>
+#include <thread>
+
+HardwareSerial Serial;
+EspClass       ESP;
+WiFiClass      WiFi;
+SDFS           SD;
+SPIClass       SPI;
+TwoWire        Wire;
+HTTPUpdate     httpUpdate;
+
+// ===================== Clock =====================
+
+// 2026-01-15 08:00:00 UTC
+static std::atomic<uint64_t> wallUs{1768464000ULL * 1000000ULL};
+static std::atomic<uint64_t> bootUs{0};
+
+// True time minus the wall clock: grows over deep sleeps with a drifting
+// slow clock, cleared by an SNTP sync
+static std::atomic<int64_t> trueAheadUs{0};
+static int32_t rtcDriftPpm = 0;
+static bool     sntpPending = false;
+static uint64_t sntpStartUs = 0;
+static const uint64_t SNTP_ROUND_TRIP_US = 200000;
+
+static struct ShimInit {
+  ShimInit() {
+    setenv("TZ", "UTC0", 1);
+    tzset();
+    // A write to a routed socket the peer closed fails (EPIPE), as on lwIP
+    signal(SIGPIPE, SIG_IGN);
+  }
+} shimInit;
+
+namespace shim {
+
+void setEpoch(time_t t) { wallUs = (uint64_t)t * 1000000ULL; }
+
+void advanceMs(uint64_t ms) {
+  wallUs += ms * 1000;
+  bootUs += ms * 1000;
+  // The caller would be blocked (delay, network) and the other core's tasks
+  // get to run; without this one host CPU can starve the log writer
+  std::this_thread::yield();
+}
+
+void sleepSeconds(uint64_t s) {
+  wallUs += s * 1000000ULL;
+  trueAheadUs += (int64_t)s * rtcDriftPpm;
+  bootUs = 0;
+}
+
+void reboot() { bootUs = 0; }
+
+uint64_t epochUs() { return wallUs; }
+
+void setRtcDriftPpm(int32_t ppm) { rtcDriftPpm = ppm; }
+int64_t clockErrorUs() { return trueAheadUs; }
+
+} // namespace shim
+
+unsigned long millis() { return bootUs / 1000; }
+unsigned long micros() { return bootUs; }
+void delay(unsigned long ms) { shim::advanceMs(ms); }
+void delayMicroseconds(unsigned int us) { wallUs += us; bootUs += us; }
+void yield() {}
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t, uint8_t) {}
+
+// The firmware reads the wall clock through libc; these override it
+extern "C" time_t time(time_t *t) noexcept {
+  time_t now = wallUs / 1000000ULL;
+  if (t) *t = now;
+  return now;
+}
+
+extern "C" int gettimeofday(struct timeval *__restrict tv, void *__restrict) noexcept {
+  uint64_t us = wallUs;
+  tv->tv_sec = us / 1000000ULL;
+  tv->tv_usec = us % 1000000ULL;
+  return 0;
+}
+
+extern "C" int settimeofday(const struct timeval *tv, const struct timezone *) noexcept {
+  uint64_t us = (uint64_t)tv->tv_sec * 1000000ULL + tv->tv_usec;
+  trueAheadUs -= (int64_t)(us - wallUs);
+  wallUs = us;
+  return 0;
+}
+
+void configTime(long gmtOffsetSec, int daylightOffsetSec, const char *, const char *, const char *) {
+  // (Re)starts SNTP; see sntp_get_sync_status()
+  sntpPending = true;
+  sntpStartUs = wallUs;
+
+  // POSIX TZ offsets are west-positive
+  char tz[48];
+  int hours = (int)((gmtOffsetSec + daylightOffsetSec) / 3600);
+  snprintf(tz, sizeof(tz), "<%+03d>%+d", hours, -hours);
+  setenv("TZ", tz, 1);
+  tzset();
+}
+
+extern "C" size_t strlcpy(char *dst, const char *src, size_t size) {
+  size_t len = strlen(src);
+  if (size) {
+    size_t n = len < size - 1 ? len : size - 1;
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+  }
+  return len;
+}
+
+extern "C" size_t strlcat(char *dst, const char *src, size_t size) {
+  size_t used = strnlen(dst, size);
+  if (used == size) return size + strlen(src);
+  return used + strlcpy(dst + used, src, size - used);
+}
+
+// ===================== FreeRTOS =====================
+
+struct ShimTask {
+  std::mutex              m;
+  std::condition_variable cv;
+  uint32_t                notified = 0;
+};
+
+static ShimTask *mainTask = new ShimTask;
+static thread_local ShimTask *currentTask = nullptr;
+static std::atomic<uint32_t> taskCount{0};
+
+uint32_t shim::tasksCreated() { return taskCount.load(); }
+
+BaseType_t xTaskCreatePinnedToCore(void (*fn)(void *), const char *, uint32_t, void *arg,
+                                   UBaseType_t, TaskHandle_t *handle, BaseType_t) {
+  ShimTask *task = new ShimTask;
+  if (handle) *handle = task;
+  taskCount++;
+  std::thread([fn, arg, task] {
+    currentTask = task;
+    fn(arg);
+  }).detach();
+  return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+void xTaskNotifyGive(TaskHandle_t task) {
+  {
+    std::lock_guard<std::mutex> lock(task->m);
+    task->notified++;
+  }
+  task->cv.notify_one();
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+  ShimTask *task = currentTask ? currentTask : mainTask;
+  std::unique_lock<std::mutex> lock(task->m);
+  auto ready = [task] { return task->notified > 0; };
+  if (ticks == portMAX_DELAY) {
+    task->cv.wait(lock, ready);
+  } else {
+    task->cv.wait_for(lock, std::chrono::milliseconds(ticks), ready);
+  }
+  uint32_t value = task->notified;
+  if (value) task->notified = clearOnExit ? 0 : value - 1;
+  return value;
+}
+
+BaseType_t xPortGetCoreID() { return currentTask ? 0 : 1; }
+
+// ===================== Sensors =====================
+
+static std::function<uint16_t(time_t)> sgp40Source;
+static std::function<float(time_t)>    scd30Source;
+
+static const uint8_t  SCD30_ADDR = 0x61;
+static const uint16_t SCD30_CMD_STOP = 0x0104;
+
+static std::function<shim::Sps30Mass(time_t)> sps30Source;
+
+static const uint8_t  SPS30_ADDR = 0x69;
+static const uint16_t SPS30_CMD_START = 0x0010;
+static const uint16_t SPS30_CMD_STOP = 0x0104;
+static const uint16_t SPS30_CMD_READY = 0x0202;
+static const uint16_t SPS30_CMD_READ = 0x0300;
+static const uint16_t SPS30_CMD_SLEEP = 0x1001;
+static const uint16_t SPS30_CMD_WAKE_UP = 0x1103;
+
+struct Sps30State {
+  bool     measuring = false;
+  uint64_t startUs = 0;
+  uint64_t consumed = 0;  // measurements since startUs already read
+  uint16_t command = 0;   // the last one written, for the next read
+  uint32_t wakeUps = 0;
+  uint32_t starts = 0;
+};
+static Sps30State sps30;
+
+// What the SCD30 keeps while the ESP32 sleeps or resets: its NVM settings
+// and whether it is measuring (carried between wakes like the SD card)
+struct Scd30State {
+  uint32_t resets = 0;
+  uint32_t starts = 0;
+  uint16_t interval = 2;      // NVM
+  bool     asc = false;       // NVM, off from the factory
+  uint32_t nvmWrites = 0;
+  bool     measuring = false;
+  uint64_t startUs = 0;       // wall clock at the last start
+  uint64_t consumed = 0;      // measurements since startUs already read
+  uint32_t measurements = 0;  // of finished runs
+  uint32_t readings = 0;
+  uint32_t missed = 0;
+  uint64_t measuringUs = 0;   // of finished runs
+};
+static Scd30State scd30;
+
+// Measurements completed since the last start
+static uint64_t scd30Completed() {
+  if (!scd30.measuring) return 0;
+  return (wallUs - scd30.startUs) / (scd30.interval * 1000000ULL);
+}
+
+static void scd30Stop() {
+  if (!scd30.measuring) return;
+  scd30.measurements += scd30Completed();
+  scd30.measuringUs += wallUs - scd30.startUs;
+  scd30.measuring = false;
+}
+
+static void scd30Run() {
+  scd30Stop();
+  scd30.measuring = true;
+  scd30.startUs = wallUs;
+  scd30.consumed = 0;
+}
+
+namespace shim {
+void setSgp40Raw(std::function<uint16_t(time_t)> source) { sgp40Source = source; }
+bool sgp40Present() { return (bool)sgp40Source; }
+uint16_t sgp40MeasureRaw() { return sgp40Source ? sgp40Source(time(nullptr)) : 0; }
+
+void setScd30Co2(std::function<float(time_t)> source) { scd30Source = source; }
+
+Scd30Stats scd30Stats() {
+  Scd30Stats st;
+  st.resets = scd30.resets;
+  st.starts = scd30.starts;
+  st.nvmWrites = scd30.nvmWrites;
+  st.measurements = scd30.measurements + scd30Completed();
+  st.readings = scd30.readings;
+  st.missed = scd30.missed;
+  st.measuringMs = (scd30.measuringUs + (scd30.measuring ? wallUs - scd30.startUs : 0)) / 1000;
+  st.measuring = scd30.measuring;
+  return st;
+}
+
+void scd30Reset() { scd30 = Scd30State(); }
+
+bool scd30Begin() {
+  if (!scd30Source) return false;
+  scd30Stop();  // soft reset
+  scd30.resets++;
+  return scd30Start(0) && scd30SetInterval(2);
+}
+
+bool scd30DataReady() { return scd30Source && scd30Completed() > scd30.consumed; }
+
+bool scd30Read(float &co2) {
+  uint64_t completed = scd30Completed();
+  if (!scd30Source || completed <= scd30.consumed) return false;
+  scd30.missed += completed - scd30.consumed - 1;  // overwritten before this read
+  scd30.consumed = completed;
+  scd30.readings++;
+  co2 = scd30Source(time(nullptr));
+  return true;
+}
+
+bool scd30Start(uint16_t pressure) {
+  if (!scd30Source) return false;
+  scd30.starts++;
+  scd30Run();
+  return true;
+}
+
+bool scd30SetInterval(uint16_t interval) {
+  if (!scd30Source || interval < 2 || interval > 1800) return false;
+  // Counts from here on; what was measured so far stays counted
+  bool measuring = scd30.measuring;
+  scd30Stop();
+  scd30.interval = interval;
+  scd30.nvmWrites++;
+  if (measuring) scd30Run();
+  return true;
+}
+
+uint16_t scd30Interval() { return scd30Source ? scd30.interval : 0; }
+bool scd30Asc() { return scd30Source && scd30.asc; }
+
+bool scd30SetAsc(bool enabled) {
+  if (!scd30Source) return false;
+  scd30.asc = enabled;
+  scd30.nvmWrites++;
+  return true;
+}
+
+void setSps30Mass(std::function<Sps30Mass(time_t)> source) { sps30Source = source; }
+
+Sps30Stats sps30Stats() { return { sps30.wakeUps, sps30.starts, sps30.measuring }; }
+} // namespace shim
+
+// Sensirion CRC-8 over one 16-bit word (polynomial 0x31, init 0xFF)
+static uint8_t sensirionCrc(uint8_t a, uint8_t b) {
+  uint8_t crc = 0xFF;
+  for (uint8_t byte : { a, b }) {
+    crc ^= byte;
+    for (int i = 0; i < 8; i++) crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : crc << 1;
+  }
+  return crc;
+}
+
+static void appendWord(std::string &out, uint8_t hi, uint8_t lo) {
+  out += (char)hi;
+  out += (char)lo;
+  out += (char)sensirionCrc(hi, lo);
+}
+
+static void appendFloat(std::string &out, float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  appendWord(out, bits >> 24, bits >> 16);
+  appendWord(out, bits >> 8, bits);
+}
+
+static uint64_t sps30Completed() {
+  return sps30.measuring ? (wallUs - sps30.startUs) / 1000000 : 0;
+}
+
+static std::string sps30Respond(size_t size) {
+  std::string out;
+  if (sps30.command == SPS30_CMD_READY) {
+    appendWord(out, 0, sps30Completed() > sps30.consumed ? 1 : 0);
+  } else if (sps30.command == SPS30_CMD_READ && sps30Completed() > sps30.consumed) {
+    sps30.consumed = sps30Completed();
+    shim::Sps30Mass m = sps30Source(time(nullptr));
+    for (float v : { m.pm1, m.pm25, m.pm4, m.pm10 }) appendFloat(out, v);
+    for (int i = 0; i < 6; i++) appendFloat(out, 0);  // number concentrations, typical size
+  }
+  if (out.size() > size) out.resize(size);
+  return out;
+}
+
+namespace shim {
+uint8_t i2cTransmit(uint8_t address, const std::string &bytes) {
+  uint16_t command = bytes.size() >= 2 ? (uint8_t)bytes[0] << 8 | (uint8_t)bytes[1] : 0;
+  if (address == SCD30_ADDR && scd30Source) {
+    if (bytes.size() == 2 && command == SCD30_CMD_STOP) scd30Stop();
+    return 0;
+  }
+  if (address == SPS30_ADDR && sps30Source) {
+    sps30.command = command;
+    if (command == SPS30_CMD_START) {
+      sps30.measuring = true;
+      sps30.startUs = wallUs;
+      sps30.consumed = 0;
+      sps30.starts++;
+    } else if (command == SPS30_CMD_STOP || command == SPS30_CMD_SLEEP) {
+      sps30.measuring = false;
+    } else if (command == SPS30_CMD_WAKE_UP) {
+      sps30.wakeUps++;
+    }
+    return 0;
+  }
+  return 2;  // NACK on address
+}
+
+std::string i2cRequest(uint8_t address, size_t size) {
+  if (address == SPS30_ADDR && sps30Source) return sps30Respond(size);
+  return std::string();
+}
+} // namespace shim
+
+// ===================== ESP / sleep / heap =====================
+
+// First-fit over address ranges only (no memory behind them). Blocks carry
+// the allocator's header and 4-byte alignment like multi_heap's.
+namespace {
+struct SimHeap {
+  static const size_t HEADER = 8;
+
+  std::mutex lock;
+  std::map<size_t, size_t> freeRanges{{0, shim::HEAP_FREE_AT_BOOT}};  // start -> size
+  std::map<size_t, size_t> used;
+  shim::HeapStats stats{shim::HEAP_FREE_AT_BOOT, shim::HEAP_FREE_AT_BOOT,
+                        shim::HEAP_FREE_AT_BOOT, shim::HEAP_FREE_AT_BOOT, 0, 0};
+
+  size_t largest() const {
+    size_t best = 0;
+    for (const auto &r : freeRanges) best = std::max(best, r.second);
+    return best;
+  }
+
+  void record() {
+    stats.largestFree = largest();
+    stats.minFreeBytes = std::min(stats.minFreeBytes, stats.freeBytes);
+    stats.minLargestFree = std::min(stats.minLargestFree, stats.largestFree);
+  }
+};
+
+SimHeap &simHeap() {
+  static SimHeap *heap = new SimHeap;  // String globals allocate before main()
+  return *heap;
+}
+} // namespace
+
+namespace shim {
+size_t heapAlloc(size_t bytes) {
+  SimHeap &h = simHeap();
+  std::lock_guard<std::mutex> lock(h.lock);
+  size_t size = (bytes + SimHeap::HEADER + 3) & ~(size_t)3;
+  for (auto r = h.freeRanges.begin(); r != h.freeRanges.end(); ++r) {
+    if (r->second < size) continue;
+    size_t start = r->first, left = r->second - size;
+    h.freeRanges.erase(r);
+    if (left) h.freeRanges[start + size] = left;
+    h.used[start] = size;
+    h.stats.freeBytes -= size;
+    h.stats.allocations++;
+    h.record();
+    return start + 1;
+  }
+  h.stats.failures++;
+  return 0;
+}
+
+void heapFree(size_t block) {
+  if (!block) return;
+  SimHeap &h = simHeap();
+  std::lock_guard<std::mutex> lock(h.lock);
+  auto u = h.used.find(block - 1);
+  if (u == h.used.end()) return;
+  size_t start = u->first, size = u->second;
+  h.used.erase(u);
+  h.stats.freeBytes += size;
+
+  // Coalesce with the free neighbours on both sides
+  auto next = h.freeRanges.lower_bound(start);
+  if (next != h.freeRanges.end() && next->first == start + size) {
+    size += next->second;
+    next = h.freeRanges.erase(next);
+  }
+  if (next != h.freeRanges.begin()) {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == start) {
+      prev->second += size;
+      h.record();
+      return;
+    }
+  }
+  h.freeRanges[start] = size;
+  h.record();
+}
+
+HeapStats heapStats() {
+  SimHeap &h = simHeap();
+  std::lock_guard<std::mutex> lock(h.lock);
+  return h.stats;
+}
+} // namespace shim
+
+void EspClass::restart() { throw shim::Restart{}; }
+uint32_t EspClass::getFreeHeap() { return shim::heapStats().freeBytes; }
+uint32_t EspClass::getMinFreeHeap() { return shim::heapStats().minFreeBytes; }
+uint32_t EspClass::getHeapSize() { return 320 * 1024; }
+
+size_t heap_caps_get_free_size(uint32_t) { return shim::heapStats().freeBytes; }
+size_t heap_caps_get_largest_free_block(uint32_t) { return shim::heapStats().largestFree; }
+
+static uint64_t sleepTimerUs = 0;
+void esp_sleep_enable_timer_wakeup(uint64_t us) { sleepTimerUs = us; }
+void esp_deep_sleep_start() { throw shim::DeepSleep{sleepTimerUs}; }
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() {
+  return sleepTimerUs ? ESP_SLEEP_WAKEUP_TIMER : ESP_SLEEP_WAKEUP_UNDEFINED;
+}
+
+// ===================== String / Print / Stream =====================
+
+void String::fmtInt(long long v, unsigned base) {
+  if (base == DEC) {
+    s_ = std::to_string(v);
+  } else {
+    fmtUnsigned((uint32_t)v, base);  // like the target: two's complement digits
+  }
+}
+
+void String::fmtUnsigned(unsigned long long v, unsigned base) {
+  char buf[72];
+  char *p = buf + sizeof(buf) - 1;
+  *p = '\0';
+  do {
+    unsigned d = v % base;
+    *--p = d < 10 ? '0' + d : 'A' + d - 10;
+    v /= base;
+  } while (v);
+  s_ = p;
+}
+
+void String::fmtFloat(double v, unsigned decimals) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", decimals, v);
+  s_ = buf;
+}
+
+void String::trim() {
+  size_t b = 0, e = s_.size();
+  while (b < e && isspace((unsigned char)s_[b])) b++;
+  while (e > b && isspace((unsigned char)s_[e - 1])) e--;
+  s_ = s_.substr(b, e - b);
+}
+
+size_t Print::printf(const char *fmt, ...) {
+  char buf[512];
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(buf, sizeof(buf), fmt, args);
+  va_end(args);
+  if (n < 0) return 0;
+  return write((const uint8_t *)buf, std::min((size_t)n, sizeof(buf) - 1));
+}
+
+size_t Stream::readBytes(char *buf, size_t n) {
+  size_t i = 0;
+  while (i < n) {
+    int c = read();
+    if (c < 0) break;
+    buf[i++] = (char)c;
+  }
+  return i;
+}
+
+size_t Stream::readBytesUntil(char terminator, char *buf, size_t n) {
+  size_t i = 0;
+  while (i < n) {
+    int c = read();
+    if (c < 0 || c == terminator) break;
+    buf[i++] = (char)c;
+  }
+  return i;
+}
+
+String Stream::readString() {
+  std::string s;
+  int c;
+  while ((c = read()) >= 0) s += (char)c;
+  return String(s);
+}
+
+String Stream::readStringUntil(char terminator) {
+  std::string s;
+  int c;
+  while ((c = read()) >= 0 && c != terminator) s += (char)c;
+  return String(s);
+}
+
+static std::atomic<bool> serialEcho{false};
+
+size_t HardwareSerial::write(uint8_t c) { return write(&c, 1); }
+
+size_t HardwareSerial::write(const uint8_t *buf, size_t n) {
+  if (serialEcho) fwrite(buf, 1, n, stdout);
+  return n;
+}
+
+namespace shim {
+void setSerialEcho(bool echo) { serialEcho = echo; }
+}
+
+// ===================== SD card =====================
+
+struct ShimOpenFile {
+  std::string                  path;
+  std::shared_ptr<std::string> data;
+  size_t                       pos = 0;
+};
+
+static std::mutex sdLock;
+static auto &sdFiles = *new std::map<std::string, std::shared_ptr<std::string>>;
+static std::atomic<int>      sdFailOpens{0};
+static std::atomic<uint32_t> sdWriteDelayUs{0};
+
+namespace shim {
+
+std::string sdRead(const std::string &path) {
+  std::lock_guard<std::mutex> lock(sdLock);
+  auto it = sdFiles.find(path);
+  return it == sdFiles.end() ? std::string() : *it->second;
+}
+
+void sdWrite(const std::string &path, const std::string &contents) {
+  std::lock_guard<std::mutex> lock(sdLock);
+  sdFiles[path] = std::make_shared<std::string>(contents);
+}
+
+bool sdExists(const std::string &path) {
+  std::lock_guard<std::mutex> lock(sdLock);
+  return sdFiles.count(path) > 0;
+}
+
+void sdRemove(const std::string &path) {
+  std::lock_guard<std::mutex> lock(sdLock);
+  sdFiles.erase(path);
+}
+
+void sdReset() {
+  std::lock_guard<std::mutex> lock(sdLock);
+  sdFiles.clear();
+  sdFailOpens = 0;
+  sdWriteDelayUs = 0;
+}
+
+void sdFailNextOpens(int n) { sdFailOpens = n; }
+void sdSetWriteDelayUs(uint32_t us) { sdWriteDelayUs = us; }
+
+} // namespace shim
+
+bool SDFS::exists(const char *path) { return shim::sdExists(path); }
+
+File SDFS::open(const char *path, const char *mode) {
+  if (sdFailOpens > 0) {
+    sdFailOpens--;
+    return File();
+  }
+
+  std::lock_guard<std::mutex> lock(sdLock);
+  auto it = sdFiles.find(path);
+  auto f = std::make_shared<ShimOpenFile>();
+  f->path = path;
+
+  if (mode[0] == 'r') {
+    if (it == sdFiles.end()) return File();
+    f->data = it->second;
+  } else if (mode[0] == 'w' || it == sdFiles.end()) {
+    f->data = std::make_shared<std::string>();
+    sdFiles[path] = f->data;
+  } else {
+    f->data = it->second;
+  }
+  if (mode[0] == 'a') f->pos = f->data->size();
+  return File(f);
+}
+
+bool SDFS::remove(const char *path) {
+  std::lock_guard<std::mutex> lock(sdLock);
+  return sdFiles.erase(path) > 0;
+}
+
+bool SDFS::rename(const char *from, const char *to) {
+  std::lock_guard<std::mutex> lock(sdLock);
+  auto it = sdFiles.find(from);
+  if (it == sdFiles.end()) return false;
+  sdFiles[to] = it->second;
+  sdFiles.erase(from);
+  return true;
+}
+
+void File::close() { f_.reset(); }
+
+size_t File::size() const {
+  if (!f_) return 0;
+  std::lock_guard<std::mutex> lock(sdLock);
+  return f_->data->size();
+}
+
+size_t File::position() const { return f_ ? f_->pos : 0; }
+
+bool File::seek(uint32_t pos) {
+  if (!f_ || pos > size()) return false;
+  f_->pos = pos;
+  return true;
+}
+
+const char *File::name() const { return f_ ? f_->path.c_str() : ""; }
+
+size_t File::write(const uint8_t *buf, size_t n) {
+  if (!f_) return 0;
+  if (sdWriteDelayUs) std::this_thread::sleep_for(std::chrono::microseconds(sdWriteDelayUs));
+  std::lock_guard<std::mutex> lock(sdLock);
+  std::string &d = *f_->data;
+  if (f_->pos > d.size()) f_->pos = d.size();
+  d.replace(f_->pos, std::min(n, d.size() - f_->pos), (const char *)buf, n);
+  f_->pos += n;
+  return n;
+}
+
+int File::available() {
+  if (!f_) return 0;
+  std::lock_guard<std::mutex> lock(sdLock);
+  return f_->pos < f_->data->size() ? (int)(f_->data->size() - f_->pos) : 0;
+}
+
+int File::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::peek() {
+  if (!f_) return -1;
+  std::lock_guard<std::mutex> lock(sdLock);
+  return f_->pos < f_->data->size() ? (uint8_t)(*f_->data)[f_->pos] : -1;
+}
+
+size_t File::read(uint8_t *buf, size_t n) {
+  if (!f_) return 0;
+  std::lock_guard<std::mutex> lock(sdLock);
+  const std::string &d = *f_->data;
+  if (f_->pos >= d.size()) return 0;
+  n = std::min(n, d.size() - f_->pos);
+  memcpy(buf, d.data() + f_->pos, n);
+  f_->pos += n;
+  return n;
+}
+
+// ===================== Network =====================
+
+static shim::HttpHandler httpHandler = [](const shim::HttpRequest &) { return shim::HttpResponse(); };
+static bool networkUp = true;
+static bool wifiAvailable = true;
+static uint32_t connects = 0;
+static auto &loopbackRoutes = *new std::map<std::string, uint16_t>;
+static uint64_t radioOnSinceUs = 0;
+RTC_DATA_ATTR static uint64_t radioOnUs = 0;
+
+namespace shim {
+void setHttpHandler(HttpHandler handler) { httpHandler = handler; }
+void setNetworkUp(bool up) { networkUp = up; }
+void setWiFiAvailable(bool available) { wifiAvailable = available; }
+uint32_t connectCount() { return connects; }
+void routeToLoopback(const std::string &host, uint16_t port) { loopbackRoutes[host] = port; }
+uint64_t radioOnMs() { return (radioOnUs + (radioOnSinceUs ? wallUs - radioOnSinceUs : 0)) / 1000; }
+} // namespace shim
+
+// A server answers one round trip after configTime() if the network is up;
+// the clock steps to true time then, and COMPLETED is reported once
+sntp_sync_status_t sntp_get_sync_status() {
+  if (!sntpPending || !networkUp || WiFi.status() != WL_CONNECTED ||
+      wallUs - sntpStartUs < SNTP_ROUND_TRIP_US) {
+    return SNTP_SYNC_STATUS_RESET;
+  }
+  sntpPending = false;
+  wallUs += trueAheadUs.exchange(0);
+  return SNTP_SYNC_STATUS_COMPLETED;
+}
+
+String IPAddress::toString() const {
+  char buf[16];
+  snprintf(buf, sizeof(buf), "%u.%u.%u.%u", a_[0], a_[1], a_[2], a_[3]);
+  return String(buf);
+}
+
+bool WiFiClass::mode(wifi_mode_t m) {
+  if (m != WIFI_OFF && !radioOnSinceUs) {
+    radioOnSinceUs = wallUs;
+  } else if (m == WIFI_OFF && radioOnSinceUs) {
+    radioOnUs += wallUs - radioOnSinceUs;
+    radioOnSinceUs = 0;
+  }
+  mode_ = m;
+  return true;
+}
+
+wl_status_t WiFiClass::begin(const char *, const char *) {
+  joined_ = wifiAvailable;
+  if (joined_) shim::advanceMs(1500);
+  return status();
+}
+
+wl_status_t WiFiClass::status() {
+  return joined_ && mode_ != WIFI_OFF ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+bool WiFiClass::disconnect(bool) {
+  joined_ = false;
+  return true;
+}
+
+int WiFiClient::connect(const char *host, uint16_t, int32_t timeoutMs) {
+  WiFiClient::stop();
+  connects++;
+  if (!networkUp || WiFi.status() != WL_CONNECTED) {
+    shim::advanceMs(timeoutMs);
+    return 0;
+  }
+
+  auto route = loopbackRoutes.find(host);
+  if (route != loopbackRoutes.end()) {
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(route->second);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    timeval tv = { timeoutMs / 1000, (timeoutMs % 1000) * 1000 };
+    setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    if (::connect(fd_, (sockaddr *)&addr, sizeof(addr)) != 0) {
+      WiFiClient::stop();
+      shim::advanceMs(timeoutMs);
+      return 0;
+    }
+  }
+  shim::advanceMs(40);
+  connected_ = true;
+  return 1;
+}
+
+void WiFiClient::stop() {
+  if (fd_ >= 0) close(fd_);
+  fd_ = -1;
+  connected_ = false;
+  rx_.clear();
+  rxPos_ = 0;
+}
+
+uint8_t WiFiClient::connected() {
+  if (connected_ && fd_ >= 0) {
+    // The peer closed: nothing left to read and recv() sees the end
+    char c;
+    if (recv(fd_, &c, 1, MSG_PEEK | MSG_DONTWAIT) == 0) connected_ = false;
+  }
+  return connected_;
+}
+
+size_t WiFiClient::write(const uint8_t *buf, size_t n) {
+  if (!connected_) return 0;
+  if (fd_ < 0) return n;
+  size_t done = 0;
+  while (done < n) {
+    ssize_t sent = send(fd_, buf + done, n - done, MSG_NOSIGNAL);
+    if (sent <= 0) {
+      connected_ = false;
+      break;
+    }
+    done += sent;
+  }
+  return done;
+}
+
+int WiFiClient::available() {
+  if (fd_ < 0) return rx_.size() - rxPos_;
+  if (!connected_) return 0;
+  int n = 0;
+  ioctl(fd_, FIONREAD, &n);
+  if (n == 0) {
+    pollfd p = { fd_, POLLIN, 0 };
+    if (poll(&p, 1, 1) > 0) ioctl(fd_, FIONREAD, &n);
+  }
+  return n;
+}
+
+int WiFiClient::read(uint8_t *buf, size_t n) {
+  if (fd_ >= 0) {
+    ssize_t got = connected_ ? recv(fd_, buf, n, MSG_DONTWAIT) : -1;
+    return got > 0 ? (int)got : -1;
+  }
+  size_t got = std::min(n, rx_.size() - rxPos_);
+  memcpy(buf, rx_.data() + rxPos_, got);
+  rxPos_ += got;
+  return got;
+}
+
+int WiFiClient::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int WiFiClient::peek() {
+  if (fd_ < 0) return rxPos_ < rx_.size() ? (uint8_t)rx_[rxPos_] : -1;
+  uint8_t c;
+  return connected_ && recv(fd_, &c, 1, MSG_PEEK | MSG_DONTWAIT) == 1 ? c : -1;
+}
+
+void WiFiClient::flush() {
+  uint8_t buf[256];
+  while (available() > 0 && read(buf, sizeof(buf)) > 0) {}
+}
+
+static bool splitHost(const std::string &url, std::string &host, uint16_t &port) {
+  size_t start = url.find("://");
+  if (start == std::string::npos) return false;
+  port = url.compare(0, 5, "https") == 0 ? 443 : 80;
+  start += 3;
+  size_t end = url.find_first_of(":/", start);
+  host = url.substr(start, end - start);
+  if (end != std::string::npos && url[end] == ':') port = atoi(url.c_str() + end + 1);
+  return !host.empty();
+}
+
+bool HTTPClient::begin(WiFiClient &client, const String &url) {
+  client_ = &client;
+  url_ = url.c_str();
+  return true;
+}
+
+// As HTTPClient::disconnect(): drop what has already arrived, and keep the
+// connection only if both the caller and the response allow it
+void HTTPClient::end() {
+  if (client_ && client_->connected()) {
+    if (client_->available() > 0) client_->flush();
+    if (!reuse_ || !canReuse_) client_->stop();
+  }
+  size_ = -1;
+  chunked_ = false;
+}
+
+int HTTPClient::GET() { return request("GET", std::string()); }
+
+int HTTPClient::POST(uint8_t *payload, size_t size) {
+  return request("POST", std::string((const char *)payload, size));
+}
+
+int HTTPClient::sendRequest(const char *method, uint8_t *payload, size_t size) {
+  return request(method, payload ? std::string((const char *)payload, size) : std::string());
+}
+
+int HTTPClient::sendRequest(const char *method, Stream *stream, size_t size) {
+  std::string body;
+  body.resize(size);
+  body.resize(stream->readBytes(&body[0], size));
+  return request(method, body);
+}
+
+// A response as a server puts it on the wire
+static std::string rawResponse(const shim::HttpResponse &resp) {
+  std::string raw = "HTTP/1.1 " + std::to_string(resp.status) + " \r\n";
+  if (!resp.chunked) {
+    return raw + "Content-Length: " + std::to_string(resp.body.size()) + "\r\n\r\n" + resp.body;
+  }
+  raw += "Transfer-Encoding: chunked\r\n\r\n";
+  if (!resp.body.empty()) {
+    char head[24];
+    snprintf(head, sizeof(head), "%zx\r\n", resp.body.size());
+    raw += head + resp.body + "\r\n";
+  }
+  return raw + "0\r\n\r\n";
+}
+
+// Errors close the connection, as HTTPClient::returnError() does
+int HTTPClient::fail(int error) {
+  client_->stop();
+  return error;
+}
+
+// Waits up to the timeout for the next bytes of the response
+bool HTTPClient::waitForData() {
+  unsigned long start = millis();
+  while (client_->available() <= 0) {
+    if (!client_->connected() || millis() - start >= timeoutMs_) return false;
+    delay(1);
+  }
+  return true;
+}
+
+// One line of the response, without its CRLF
+bool HTTPClient::readLine(std::string &line) {
+  line.clear();
+  for (;;) {
+    if (!waitForData()) return false;
+    int c = client_->read();
+    if (c == '\n') break;
+    if (c >= 0) line += (char)c;
+  }
+  if (!line.empty() && line.back() == '\r') line.pop_back();
+  return true;
+}
+
+int HTTPClient::request(const char *method, std::string body) {
+  if (!client_) return HTTPC_ERROR_NOT_CONNECTED;
+  std::string host;
+  uint16_t port;
+  if (!splitHost(url_, host, port)) return HTTPC_ERROR_CONNECTION_REFUSED;
+  if (!client_->connected() && !client_->connect(host.c_str(), port, timeoutMs_)) {
+    return HTTPC_ERROR_CONNECTION_REFUSED;
+  }
+  size_ = -1;
+  chunked_ = false;
+  canReuse_ = true;
+
+  if (client_->shimFd() >= 0) {
+    // A real server at the other end
+    size_t path = url_.find('/', url_.find("://") + 3);
+    std::string out = std::string(method) + " " +
+                      (path == std::string::npos ? "/" : url_.substr(path)) + " HTTP/1.1\r\n" +
+                      "Host: " + host + "\r\nConnection: keep-alive\r\n" +
+                      "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+    if (client_->write((const uint8_t *)out.data(), out.size()) != out.size()) {
+      return fail(HTTPC_ERROR_SEND_HEADER_FAILED);
+    }
+  } else {
+    shim::HttpRequest req{ method, url_, std::move(body), timeoutMs_ };
+    shim::HttpResponse resp = httpHandler(req);
+    if (resp.status <= 0 || resp.latencyMs > timeoutMs_) {
+      shim::advanceMs(std::min<uint32_t>(resp.latencyMs, timeoutMs_));
+      return fail(resp.status <= 0 ? resp.status : HTTPC_ERROR_READ_TIMEOUT);
+    }
+    shim::advanceMs(resp.latencyMs);
+    client_->shimReceive(rawResponse(resp));
+  }
+
+  // Status line and headers, as HTTPClient::handleHeaderResponse() reads
+  // them: whatever an earlier caller left unread comes first
+  int code = 0;
+  std::string line;
+  for (;;) {
+    if (!readLine(line)) {
+      return fail(client_->connected() ? HTTPC_ERROR_READ_TIMEOUT : HTTPC_ERROR_CONNECTION_LOST);
+    }
+    if (line.empty()) break;
+    if (line.compare(0, 7, "HTTP/1.") == 0) {
+      code = atoi(line.c_str() + 9);
+      if (line[7] == '0') canReuse_ = false;
+      continue;
+    }
+    size_t colon = line.find(':');
+    if (colon == std::string::npos) continue;
+    std::string name = line.substr(0, colon), value = line.substr(colon + 1);
+    for (char &c : name) c = tolower(c);
+    value.erase(0, value.find_first_not_of(' '));
+    if (name == "content-length") size_ = atoi(value.c_str());
+    else if (name == "transfer-encoding") chunked_ = strcasecmp(value.c_str(), "chunked") == 0;
+    else if (name == "connection") canReuse_ = strcasecmp(value.c_str(), "close") != 0;
+  }
+  if (code == 0) return fail(HTTPC_ERROR_NO_HTTP_SERVER);
+  return code;
+}
+
+// len bytes of the body into stream (-1: until the server closes)
+int HTTPClient::copyBody(Stream *stream, int len) {
+  int total = 0;
+  uint8_t buf[512];
+  while (len != 0) {
+    if (!waitForData()) {
+      if (len < 0 && !client_->connected()) break;
+      return client_->connected() ? HTTPC_ERROR_READ_TIMEOUT : HTTPC_ERROR_CONNECTION_LOST;
+    }
+    size_t want = len < 0 ? sizeof(buf) : std::min<size_t>(len, sizeof(buf));
+    int got = client_->read(buf, want);
+    if (got <= 0) continue;
+    stream->write(buf, got);
+    total += got;
+    if (len > 0) len -= got;
+  }
+  return total;
+}
+
+int HTTPClient::writeToStream(Stream *stream) {
+  if (!client_) return HTTPC_ERROR_NOT_CONNECTED;
+  int total = 0;
+  if (!chunked_) {
+    total = copyBody(stream, size_);
+  } else {
+    std::string line;
+    for (;;) {
+      if (!readLine(line)) {
+        total = HTTPC_ERROR_READ_TIMEOUT;
+        break;
+      }
+      int len = strtol(line.c_str(), nullptr, 16);
+      if (len == 0) {
+        while (readLine(line) && !line.empty()) {}  // trailers
+        break;
+      }
+      int got = copyBody(stream, len);
+      if (got < 0 || !readLine(line)) {
+        total = got < 0 ? got : HTTPC_ERROR_READ_TIMEOUT;
+        break;
+      }
+      total += got;
+    }
+  }
+  if (total < 0) return fail(total);
+  end();
+  return total;
+}
+
+namespace {
+class StringSink : public Stream {
+public:
+  size_t write(uint8_t c) override { data += (char)c; return 1; }
+  size_t write(const uint8_t *buf, size_t n) override { data.append((const char *)buf, n); return n; }
+  using Print::write;
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  std::string data;
+};
+} // namespace
+
+String HTTPClient::getString() {
+  StringSink sink;
+  writeToStream(&sink);
+  return String(sink.data);
+}
+
+String HTTPClient::errorToString(int error) {
+  switch (error) {
+    case HTTPC_ERROR_CONNECTION_REFUSED: return "connection refused";
+    case HTTPC_ERROR_SEND_HEADER_FAILED: return "send header failed";
+    case HTTPC_ERROR_NOT_CONNECTED:      return "not connected";
+    case HTTPC_ERROR_CONNECTION_LOST:    return "connection lost";
+    case HTTPC_ERROR_NO_HTTP_SERVER:     return "no HTTP server";
+    case HTTPC_ERROR_READ_TIMEOUT:       return "read Timeout";
+    default:                             return String();
+  }
+}
+
+t_httpUpdate_return HTTPUpdate::update(WiFiClient &client, const String &url) {
+  HTTPClient http;
+  http.begin(client, url);
+  int status = http.GET();
+  int size = http.getSize();
+  http.end();
+  if (status == 200) {
+    if (progress_) progress_(size, size);
+    return HTTP_UPDATE_OK;
+  }
+  if (status == 304) return HTTP_UPDATE_NO_UPDATES;
+  lastError_ = String("HTTP error: ") + String(status);
+  return HTTP_UPDATE_FAILED;
+}
+
+// ===================== Wakes =====================
+
+extern "C" {
+extern char __start_ufar_rtc_data[] __attribute__((weak));
+extern char __stop_ufar_rtc_data[] __attribute__((weak));
+extern char __start_ufar_rtc_noinit[] __attribute__((weak));
+extern char __stop_ufar_rtc_noinit[] __attribute__((weak));
+}
+
+static const uint32_t WAKE_STATE_MAGIC = 0x55464152;  // "UFAR"
+
+// State file: magic, how the wake ended, sleep time, wall clock, both RTC
+// sections, the SCD30 and SPS30, then every SD file
+struct WakeState {
+  shim::WakeEnd end = shim::WakeEnd::Crashed;
+  uint64_t      sleepUs = 0;
+  uint64_t      wallUs = 0;
+  int64_t       trueAheadUs = 0;
+  std::string   rtcData, rtcNoinit;
+  Scd30State    scd30;
+  Sps30State    sps30;
+  std::map<std::string, std::string> files;
+};
+
+static void putBytes(std::string &out, const void *p, size_t n) { out.append((const char *)p, n); }
+template <typename T> static void putValue(std::string &out, T v) { putBytes(out, &v, sizeof(v)); }
+static void putBlob(std::string &out, const std::string &b) {
+  putValue<uint64_t>(out, b.size());
+  out += b;
+}
+
+template <typename T> static bool getValue(const std::string &in, size_t &pos, T &v) {
+  if (in.size() - pos < sizeof(v)) return false;
+  memcpy(&v, in.data() + pos, sizeof(v));
+  pos += sizeof(v);
+  return true;
+}
+static bool getBlob(const std::string &in, size_t &pos, std::string &b) {
+  uint64_t n;
+  if (!getValue(in, pos, n) || in.size() - pos < n) return false;
+  b.assign(in, pos, n);
+  pos += n;
+  return true;
+}
+
+static std::string sectionBytes(char *start, char *stop) {
+  return start && stop ? std::string(start, stop - start) : std::string();
+}
+
+static void restoreSection(char *start, char *stop, const std::string &saved) {
+  if (start && stop && saved.size() == (size_t)(stop - start)) memcpy(start, saved.data(), saved.size());
+}
+
+static bool writeWakeState(const char *path, shim::WakeEnd end, uint64_t sleepUs) {
+  std::string out;
+  putValue(out, WAKE_STATE_MAGIC);
+  putValue(out, (uint32_t)end);
+  putValue(out, sleepUs);
+  putValue<uint64_t>(out, wallUs);
+  putValue<int64_t>(out, trueAheadUs);
+  putBlob(out, sectionBytes(__start_ufar_rtc_data, __stop_ufar_rtc_data));
+  putBlob(out, sectionBytes(__start_ufar_rtc_noinit, __stop_ufar_rtc_noinit));
+  putValue(out, scd30);
+  putValue(out, sps30);
+  {
+    std::lock_guard<std::mutex> lock(sdLock);
+    putValue<uint64_t>(out, sdFiles.size());
+    for (const auto &f : sdFiles) {
+      putBlob(out, f.first);
+      putBlob(out, *f.second);
+    }
+  }
+  FILE *fp = fopen(path, "wb");
+  if (!fp) return false;
+  bool ok = fwrite(out.data(), 1, out.size(), fp) == out.size();
+  return fclose(fp) == 0 && ok;
+}
+
+static bool readWakeState(const char *path, WakeState &st) {
+  FILE *fp = fopen(path, "rb");
+  if (!fp) return false;
+  std::string in;
+  char buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) in.append(buf, n);
+  fclose(fp);
+
+  size_t pos = 0;
+  uint32_t magic, end;
+  uint64_t files;
+  if (!getValue(in, pos, magic) || magic != WAKE_STATE_MAGIC || !getValue(in, pos, end) ||
+      !getValue(in, pos, st.sleepUs) || !getValue(in, pos, st.wallUs) || !getValue(in, pos, st.trueAheadUs) ||
+      !getBlob(in, pos, st.rtcData) || !getBlob(in, pos, st.rtcNoinit) ||
+      !getValue(in, pos, st.scd30) || !getValue(in, pos, st.sps30) || !getValue(in, pos, files)) {
+    return false;
+  }
+  st.end = (shim::WakeEnd)end;
+  for (uint64_t i = 0; i < files; i++) {
+    std::string name, data;
+    if (!getBlob(in, pos, name) || !getBlob(in, pos, data)) return false;
+    st.files[name] = std::move(data);
+  }
+  return true;
+}
+
+static void applyWakeState(const WakeState &st) {
+  wallUs = st.wallUs;
+  trueAheadUs = st.trueAheadUs;
+  scd30 = st.scd30;
+  sps30 = st.sps30;
+  std::lock_guard<std::mutex> lock(sdLock);
+  sdFiles.clear();
+  for (const auto &f : st.files) sdFiles[f.first] = std::make_shared<std::string>(f.second);
+}
+
+static std::map<std::string, shim::WakeFn> &wakeRegistry() {
+  static auto *wakes = new std::map<std::string, shim::WakeFn>;
+  return *wakes;
+}
+
+// Set in the child before static constructors run; applied in wakeMain()
+static WakeState *childState = nullptr;
+
+__attribute__((constructor(101))) static void restoreRtcForWake() {
+  const char *path = getenv("UFAR_SHIM_STATE");
+  const char *boot = getenv("UFAR_SHIM_BOOT");
+  if (!path || !boot) return;
+
+  childState = new WakeState;
+  if (!readWakeState(path, *childState)) {
+    fprintf(stderr, "shim: cannot read wake state %s\n", path);
+    _exit(2);
+  }
+  if (strcmp(boot, "sleep") == 0) {
+    restoreSection(__start_ufar_rtc_data, __stop_ufar_rtc_data, childState->rtcData);
+  }
+  if (strcmp(boot, "poweron") != 0) {
+    restoreSection(__start_ufar_rtc_noinit, __stop_ufar_rtc_noinit, childState->rtcNoinit);
+  }
+}
+
+namespace shim {
+
+WakeRegister::WakeRegister(const char *name, WakeFn fn) { wakeRegistry()[name] = fn; }
+
+[[noreturn]] static void endWake(WakeEnd end, uint64_t sleepUs) {
+  fflush(stdout);
+  if (radioOnSinceUs) {
+    radioOnUs += wallUs - radioOnSinceUs;
+    radioOnSinceUs = 0;
+  }
+  const char *path = getenv("UFAR_SHIM_STATE");
+  _exit(path && writeWakeState(path, end, sleepUs) ? 0 : 3);
+}
+
+void brownout() {
+  if (!childState) {
+    fprintf(stderr, "shim: brownout() outside a wake\n");
+    abort();
+  }
+  endWake(WakeEnd::Brownout, 0);
+}
+
+int wakeMain(const char *name) {
+  auto it = wakeRegistry().find(name);
+  if (!childState || it == wakeRegistry().end()) {
+    fprintf(stderr, "shim: no wake named %s\n", name);
+    return 2;
+  }
+  applyWakeState(*childState);
+  bootUs = 0;
+  if (strcmp(getenv("UFAR_SHIM_BOOT"), "poweron") == 0) {  // their rail was off too
+    scd30Stop();
+    sps30.measuring = false;
+  }
+
+  try {
+    it->second();
+  } catch (const DeepSleep &s) {
+    endWake(WakeEnd::Slept, s.us);
+  } catch (const Restart &) {
+    endWake(WakeEnd::Restarted, 0);
+  }
+  endWake(WakeEnd::Returned, 0);
+}
+
+WakeResult runWake(const char *name, Boot boot) {
+  char path[64];
+  snprintf(path, sizeof(path), "/tmp/ufar_shim_%d.state", (int)getpid());
+  if (!writeWakeState(path, WakeEnd::Crashed, 0)) {
+    fprintf(stderr, "shim: cannot write %s\n", path);
+    abort();
+  }
+
+  fflush(stdout);
+  fflush(stderr);
+  pid_t pid = fork();
+  if (pid == 0) {
+    setenv("UFAR_SHIM_STATE", path, 1);
+    setenv("UFAR_SHIM_BOOT", boot == Boot::DeepSleep ? "sleep" : boot == Boot::Reset ? "reset" : "poweron", 1);
+    execl("/proc/self/exe", "/proc/self/exe", "--shim-wake", name, (char *)nullptr);
+    _exit(127);
+  }
+  int status = 0;
+  waitpid(pid, &status, 0);
+
+  WakeState st;
+  bool saved = WIFEXITED(status) && WEXITSTATUS(status) == 0 && readWakeState(path, st);
+  unlink(path);
+  if (!saved || st.end == WakeEnd::Crashed) return { WakeEnd::Crashed, 0 };
+
+  restoreSection(__start_ufar_rtc_data, __stop_ufar_rtc_data, st.rtcData);
+  restoreSection(__start_ufar_rtc_noinit, __stop_ufar_rtc_noinit, st.rtcNoinit);
+  applyWakeState(st);
+  if (st.end == WakeEnd::Slept) {
+    wallUs += st.sleepUs;
+    trueAheadUs += (int64_t)st.sleepUs * rtcDriftPpm / 1000000;
+  }
+  return { st.end, st.sleepUs };
+}
+
+} // namespace shim
@@ -0,0 +1,180 @@
+#pragma once
+// Control surface of the host shim: simulated clock, in-memory SD card and
+// scripted network. Tests drive the firmware through these.
+#include <Arduino.h>
+#include <functional>
+#include <map>
+#include <string>
+
+namespace shim {
+
+// ===================== Clock =====================
+// millis()/micros() count from the last boot; time()/gettimeofday() follow a
+// simulated wall clock. delay() and simulated network latency advance both.
+void     setEpoch(time_t t);
+void     advanceMs(uint64_t ms);
+void     sleepSeconds(uint64_t s);  // deep sleep: wall clock moves, millis() restarts
+void     reboot();                  // millis() back to 0, wall clock unchanged
+uint64_t epochUs();
+// The RTC slow clock runs off by ppm through deep sleep: true time gets ahead
+// of the wall clock, which only an SNTP sync (configTime(), then
+// sntp_get_sync_status() once the server answered) brings back
+void     setRtcDriftPpm(int32_t ppm);
+int64_t  clockErrorUs();            // true time - wall clock
+
+// ===================== SD card =====================
+// Flat path -> contents map; safe to use from the log writer thread
+std::string sdRead(const std::string &path);
+void        sdWrite(const std::string &path, const std::string &contents);
+bool        sdExists(const std::string &path);
+void        sdRemove(const std::string &path);
+void        sdReset();
+void        sdFailNextOpens(int n);          // next n SD.open() calls fail
+void        sdSetWriteDelayUs(uint32_t us);  // real time spent per File::write()
+
+// ===================== Network =====================
+struct HttpRequest {
+  std::string method;
+  std::string url;
+  std::string body;
+  uint32_t    timeoutMs;
+};
+
+struct HttpResponse {
+  int         status    = 200;  // <= 0: transport error (HTTPC_ERROR_*)
+  std::string body;
+  uint32_t    latencyMs = 50;   // time until the response (capped by the timeout)
+  bool        chunked   = false;
+};
+
+using HttpHandler = std::function<HttpResponse(const HttpRequest &)>;
+
+void setHttpHandler(HttpHandler handler);    // default: 200 with an empty body
+void setNetworkUp(bool up);                  // down: connects fail after their timeout
+void setWiFiAvailable(bool available);
+uint32_t connectCount();                     // TCP connects since start
+uint64_t radioOnMs();                        // WiFi mode not WIFI_OFF; kept across wakes
+// Connections to host also open a real TCP socket to 127.0.0.1:port (e.g. a
+// TLS stand-in server); requests and responses stay simulated
+void routeToLoopback(const std::string &host, uint16_t port);
+
+// ===================== Resets =====================
+// Thrown by ESP.restart() and esp_deep_sleep_start() so a test can catch the
+// end of a wake
+struct Restart {};
+struct DeepSleep { uint64_t us; };
+
+// ===================== Wakes =====================
+// runWake() runs a SHIM_WAKE function in a fresh process (this test binary
+// re-executed), the way each boot runs on the target: ordinary globals start
+// from their initializers, while RTC memory, the SD card and the clock carry
+// over. The parent's RTC variables, card and clock are what the wake starts
+// from, and are updated with what it left behind.
+//
+// RTC_DATA_ATTR memory survives only a deep-sleep wake; a reset reloads it
+// from the image like the ESP-IDF bootloader does. RTC_NOINIT_ATTR memory
+// survives resets too. The restore happens before any static constructor runs,
+// so a constructor that touches RTC memory clobbers it here as on the target.
+// The clock is kept over every boot (as if SNTP always restored it).
+enum class Boot { DeepSleep, Reset, PowerOn };
+
+enum class WakeEnd {
+  Crashed,    // the process died without saving (nothing carried over)
+  Returned,   // the wake function returned
+  Slept,      // esp_deep_sleep_start(); the clock has moved past the sleep
+  Restarted,  // ESP.restart()
+  Brownout    // brownout() below
+};
+
+struct WakeResult {
+  WakeEnd  end;
+  uint64_t sleepUs;
+};
+
+typedef void (*WakeFn)();
+struct WakeRegister { WakeRegister(const char *name, WakeFn fn); };
+
+#define SHIM_WAKE(name)                                             \
+  static void wake_##name();                                        \
+  static shim::WakeRegister wakeRegister_##name(#name, wake_##name); \
+  static void wake_##name()
+
+WakeResult runWake(const char *name, Boot boot = Boot::DeepSleep);
+
+// From inside a wake: the chip loses power here. RTC memory and what already
+// reached the card are kept, as for a brownout reset.
+[[noreturn]] void brownout();
+
+// test_main.cpp: run as a wake process when started with --shim-wake <name>
+int wakeMain(const char *name);
+
+// ===================== Sensors =====================
+// Absent by default (begin() fails, Wire NACKs). With a source installed the
+// SGP40 is present and measureRaw() returns the source's SRAW ticks for the
+// current wall-clock second.
+void setSgp40Raw(std::function<uint16_t(time_t)> source);
+
+// Likewise the SCD30 with a CO2 source (ppm for the current second). It
+// measures every interval from its last start until stopped, whether the
+// ESP32 is awake or not; its state carries between wakes like the card, and
+// a power-on boot stops it.
+void setScd30Co2(std::function<float(time_t)> source);
+
+struct Scd30Stats {
+  uint32_t resets;        // soft resets (begin())
+  uint32_t starts;        // continuous measurement (re)starts
+  uint32_t nvmWrites;     // interval and ASC writes, each one to the sensor's NVM
+  uint32_t measurements;  // completed
+  uint32_t readings;      // measurements read out
+  uint32_t missed;        // measurements replaced by the next before being read
+  uint64_t measuringMs;   // time spent measuring
+  bool     measuring;
+};
+
+Scd30Stats scd30Stats();
+void       scd30Reset();  // a new sensor, factory settings
+
+// And the SPS30 with a mass concentration source (ug/m3 for the current
+// second), framed as the sensor does: big-endian floats with a CRC after
+// every two bytes. Once started it has a new measurement every second until
+// stopped or put to sleep. Number concentrations read as zero. Like the
+// SCD30 its state carries between wakes and a power-on boot stops it.
+struct Sps30Mass {
+  float pm1, pm25, pm4, pm10;
+};
+
+void setSps30Mass(std::function<Sps30Mass(time_t)> source);
+
+struct Sps30Stats {
+  uint32_t wakeUps;  // wake-up commands
+  uint32_t starts;   // start measurement commands
+  bool     measuring;
+};
+
+Sps30Stats sps30Stats();
+
+// ===================== Heap =====================
+// A simulated heap backs String buffers (see Arduino.h): all of it free at
+// boot, first-fit, with the allocator's per-block header. ESP.getFreeHeap(),
+// getMinFreeHeap() and heap_caps_get_largest_free_block() report on it, so
+// String churn and the fragmentation it leaves show up there.
+const size_t HEAP_FREE_AT_BOOT = 200 * 1024;
+
+struct HeapStats {
+  size_t   freeBytes;
+  size_t   minFreeBytes;    // lowest since boot
+  size_t   largestFree;
+  size_t   minLargestFree;  // smallest largest-free-block since boot
+  uint32_t allocations;     // since boot
+  uint32_t failures;        // allocations that found no block
+};
+
+HeapStats heapStats();
+
+// ===================== Tasks =====================
+uint32_t tasksCreated();  // xTaskCreatePinnedToCore() calls since start
+
+// ===================== Serial =====================
+void setSerialEcho(bool echo);  // copy Serial output to stdout (off by default)
+
+} // namespace shim
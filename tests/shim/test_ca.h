@@ -0,0 +1,15 @@
+#pragma once
+// Root the host tests' API endpoint (POST_URL in the Makefile) chains to.
+// test_tls_resume.cpp's stand-in server holds an api.test certificate from
+// it; both are valid 2020-2050 so the simulated clock can move freely.
+#define API_ROOT_CA \
+  "-----BEGIN CERTIFICATE-----\n" \
+  "MIIBazCCARGgAwIBAgIBATAKBggqhkjOPQQDAjAcMRowGAYDVQQDDBF1ZmFyIGhv\n" \
+  "c3QgdGVzdCBDQTAgFw0yMDAxMDEwMDAwMDBaGA8yMDUwMDEwMTAwMDAwMFowHDEa\n" \
+  "MBgGA1UEAwwRdWZhciBob3N0IHRlc3QgQ0EwWTATBgcqhkjOPQIBBggqhkjOPQMB\n" \
+  "BwNCAAQNAh3CqC4wqwOhZlhV/WhYX0wtnGar0kL6kYKoYqYc1lDUcKyhhof+exVD\n" \
+  "itIQeEguz3JSP57pvh6U85vM1x/qo0IwQDAPBgNVHRMBAf8EBTADAQH/MA4GA1Ud\n" \
+  "DwEB/wQEAwIBBjAdBgNVHQ4EFgQUiqTGUr0dMaBrD5sKLTUSpyaBVFMwCgYIKoZI\n" \
+  "zj0EAwIDSAAwRQIhAPC3DiBuE5t7WdAO4V/reTuWSrv3exqBH2JoyUtP4FBrAiBL\n" \
+  "BvAngcbU2LCdr+lL9GqpUPbPxKEaQCckKrJUr3axnA==\n" \
+  "-----END CERTIFICATE-----\n"
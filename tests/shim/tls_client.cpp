@@ -0,0 +1,162 @@
+// Host build of tls_client.h on OpenSSL, with the same session handling as
+// the mbedTLS one: offer the session saved in tls_session.h, report whether
+// the server resumed it, save the one it hands out. Limited to TLS 1.2 like
+// mbedTLS 2.x on the target.
+// Only connections routed to a real socket (shim::routeToLoopback) do a real
+// handshake, and then carry their data over TLS; simulated connections stay
+// plain WiFiClients.
+#include "tls_client.h"
+#include "tls_session.h"
+#include "sd_logger.h"
+#include "config.h"
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+#include <poll.h>
+
+struct TlsClient::State {
+  SSL_CTX *ctx = nullptr;
+  SSL     *ssl = nullptr;
+};
+
+static void logTlsError(const char *what, const char *host) {
+  char err[160];
+  ERR_error_string_n(ERR_get_error(), err, sizeof(err));
+  ERR_clear_error();
+  logToSDf("[TLS] %s %s failed: %s", what, host, err);
+}
+
+TlsClient::~TlsClient() {
+  stop();
+}
+
+int TlsClient::connect(const char *host, uint16_t port, int32_t timeoutMs) {
+  stop();
+  resumed_ = false;
+  if (!rootCA_ || !*rootCA_) {
+    logToSDf("[TLS] No root CA for %s, refusing to connect", host);
+    return 0;
+  }
+  if (!WiFiClient::connect(host, port, timeoutMs)) return 0;
+  if (shimFd() < 0) return 1;  // simulated connection, nothing to shake hands with
+
+  tls_ = new State;
+  tls_->ctx = SSL_CTX_new(TLS_client_method());
+  SSL_CTX_set_min_proto_version(tls_->ctx, TLS1_2_VERSION);
+  SSL_CTX_set_max_proto_version(tls_->ctx, TLS1_2_VERSION);
+  SSL_CTX_set_verify(tls_->ctx, SSL_VERIFY_PEER, nullptr);
+
+  BIO *pem = BIO_new_mem_buf(rootCA_, -1);
+  X509_STORE *store = SSL_CTX_get_cert_store(tls_->ctx);
+  while (X509 *cert = PEM_read_bio_X509(pem, nullptr, nullptr, nullptr)) {
+    X509_STORE_add_cert(store, cert);
+    X509_free(cert);
+  }
+  BIO_free(pem);
+  ERR_clear_error();  // end of the PEM bundle
+
+  tls_->ssl = SSL_new(tls_->ctx);
+  SSL_set_fd(tls_->ssl, shimFd());
+  SSL_set_tlsext_host_name(tls_->ssl, host);
+  SSL_set1_host(tls_->ssl, host);
+
+  uint8_t session[TLS_SESSION_MAX_BYTES];
+  size_t sessionLen = tlsSessionLoad(host, port, session, sizeof(session));
+  bool offered = false;
+  if (sessionLen > 0) {
+    const unsigned char *p = session;
+    if (SSL_SESSION *saved = d2i_SSL_SESSION(nullptr, &p, sessionLen)) {
+      offered = SSL_set_session(tls_->ssl, saved) == 1;
+      SSL_SESSION_free(saved);
+    }
+  }
+
+  if (SSL_connect(tls_->ssl) != 1) {
+    logTlsError("Handshake with", host);
+    if (offered) tlsSessionForget(host, port);
+    stop();
+    return 0;
+  }
+  resumed_ = offered && SSL_session_reused(tls_->ssl);
+
+  if (SSL_SESSION *current = SSL_get1_session(tls_->ssl)) {
+    int len = i2d_SSL_SESSION(current, nullptr);
+    unsigned char *p = session;
+    if (len > 0 && (size_t)len <= sizeof(session)) i2d_SSL_SESSION(current, &p);
+    tlsSessionStore(host, port, session, len);
+    SSL_SESSION_free(current);
+  }
+  return 1;
+}
+
+void TlsClient::stop() {
+  if (tls_) {
+    if (tls_->ssl) {
+      SSL_shutdown(tls_->ssl);
+      SSL_free(tls_->ssl);
+    }
+    SSL_CTX_free(tls_->ctx);
+    delete tls_;
+    tls_ = nullptr;
+  }
+  WiFiClient::stop();
+}
+
+uint8_t TlsClient::connected() {
+  if (!tls_) return WiFiClient::connected();
+  return WiFiClient::connected() || SSL_pending(tls_->ssl) > 0;
+}
+
+// ===================== Data =====================
+
+size_t TlsClient::write(const uint8_t *buf, size_t size) {
+  if (!tls_) return WiFiClient::write(buf, size);
+  int n = SSL_write(tls_->ssl, buf, size);
+  if (n <= 0) {
+    logTlsError("Write to", "server");
+    stop();
+    return 0;
+  }
+  return n;
+}
+
+// Like WiFiClient::available(): a millisecond for a record to arrive, then
+// its plaintext
+int TlsClient::available() {
+  if (!tls_) return WiFiClient::available();
+  if (SSL_pending(tls_->ssl) == 0) {
+    pollfd p = { shimFd(), POLLIN, 0 };
+    uint8_t c;
+    if (!WiFiClient::connected() || poll(&p, 1, 1) <= 0) return 0;
+    if (SSL_peek(tls_->ssl, &c, 1) <= 0) {
+      stop();  // close_notify, reset or a fatal alert
+      return 0;
+    }
+  }
+  return SSL_pending(tls_->ssl);
+}
+
+int TlsClient::read(uint8_t *buf, size_t size) {
+  if (!tls_) return WiFiClient::read(buf, size);
+  if (available() <= 0) return -1;
+  int n = SSL_read(tls_->ssl, buf, size);
+  return n > 0 ? n : -1;
+}
+
+int TlsClient::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int TlsClient::peek() {
+  if (!tls_) return WiFiClient::peek();
+  uint8_t c;
+  return available() > 0 && SSL_peek(tls_->ssl, &c, 1) == 1 ? c : -1;
+}
+
+void TlsClient::flush() {
+  if (!tls_) return WiFiClient::flush();
+  uint8_t buf[256];
+  while (available() > 0 && read(buf, sizeof(buf)) > 0) {}
+}
@@ -0,0 +1,60 @@
+#pragma once
+// Minimal host test harness: TEST(name) { CHECK(...); } blocks register
+// themselves and run in declaration order from main() (test_main.cpp).
+// A failed CHECK reports and continues; the binary exits non-zero if any did.
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+
+namespace test {
+
+typedef void (*TestFn)();
+
+void add(const char *name, TestFn fn);
+void fail(const char *file, int line, const std::string &message);
+
+inline std::string show(const std::string &v) { return "\"" + v + "\""; }
+inline std::string show(const char *v) { return v ? show(std::string(v)) : "(null)"; }
+inline std::string show(char *v) { return show((const char *)v); }
+inline std::string show(bool v) { return v ? "true" : "false"; }
+inline std::string show(double v) { char b[40]; snprintf(b, sizeof(b), "%.9g", v); return b; }
+inline std::string show(float v) { return show((double)v); }
+template <typename T> std::string show(const T &v) { return std::to_string(v); }
+
+template <typename A, typename B> bool equal(const A &a, const B &b) { return a == b; }
+inline bool equal(const char *a, const char *b) { return strcmp(a, b) == 0; }
+inline bool equal(char *a, const char *b) { return strcmp(a, b) == 0; }
+
+struct Register {
+  Register(const char *name, TestFn fn) { add(name, fn); }
+};
+
+// Wall-clock nanoseconds, for the benchmarks the tests print
+inline uint64_t nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace test
+
+#define TEST(name)                                             \
+  static void test_##name();                                   \
+  static test::Register register_##name(#name, test_##name);   \
+  static void test_##name()
+
+#define CHECK(cond)                                            \
+  do {                                                         \
+    if (!(cond)) test::fail(__FILE__, __LINE__, #cond);        \
+  } while (0)
+
+#define CHECK_EQ(actual, expected)                                                   \
+  do {                                                                               \
+    const auto &a_ = (actual);                                                       \
+    const auto &e_ = (expected);                                                     \
+    if (!test::equal(a_, e_)) {                                                      \
+      test::fail(__FILE__, __LINE__, std::string(#actual " == " #expected "\n    actual:   ") + \
+                 test::show(a_) + "\n    expected: " + test::show(e_));              \
+    }                                                                                \
+  } while (0)
@@ -0,0 +1,228 @@
+// On-device air quality analytics (air_quality.h): AQI against the EPA
+// reference tables, NowCast against worked examples, events and what a cycle
+// without a sensor's samples does to them, the SPS30 values reaching the
+// payload, and the CPU cost per cycle.
+#include "test.h"
+#include "shim.h"
+#include "air_quality.h"
+#include "config.h"
+#include "sd_logger.h"
+#include <math.h>
+#include <initializer_list>
+
+void setup();
+
+static const time_t   T0 = 1768464000;  // on an hour boundary
+static const uint32_t ALL = CHANNEL_BIT(co2) | CHANNEL_BIT(pm25) | CHANNEL_BIT(pm10);
+
+// ===================== AQI =====================
+
+struct AqiCase {
+  float   ugm3;
+  int16_t aqi;
+};
+
+TEST(aqi_matches_reference_tables) {
+  // Every breakpoint of the EPA PM2.5 table (2024 revision), values that
+  // truncate onto them, a few interior points and beyond the index
+  const AqiCase pm25[] = {
+    {   0.0f,   0 }, {   4.5f,  25 }, {   9.0f,  50 }, {   9.09f, 50 },
+    {   9.1f,  51 }, {  12.0f,  56 }, {  35.4f, 100 }, {  35.49f, 100 },
+    {  35.5f, 101 }, {  45.0f, 124 }, {  55.4f, 150 }, {  55.5f, 151 },
+    { 125.4f, 200 }, { 125.5f, 201 }, { 225.4f, 300 }, { 225.5f, 301 },
+    { 325.4f, 500 }, { 500.0f, 500 }, {  -1.0f,   0 },
+  };
+  for (const AqiCase &c : pm25) {
+    if (aqiFromPm25(c.ugm3) != c.aqi) CHECK_EQ(c.ugm3, (float)c.aqi);
+  }
+
+  // ...and of the PM10 table, truncated to whole ug/m3
+  const AqiCase pm10[] = {
+    {   0,   0 }, {  54,  50 }, {  54.9f, 50 }, {  55,  51 }, { 100,  73 },
+    { 154, 100 }, { 155, 101 }, { 254, 150 }, { 255, 151 }, { 354, 200 },
+    { 355, 201 }, { 424, 300 }, { 425, 301 }, { 604, 500 }, { 700, 500 },
+  };
+  for (const AqiCase &c : pm10) {
+    if (aqiFromPm10(c.ugm3) != c.aqi) CHECK_EQ(c.ugm3, (float)c.aqi);
+  }
+}
+
+// ===================== NowCast =====================
+
+static time_t caseStart = T0;
+
+// One cycle per hour with these hourly PM2.5 and PM10 averages, oldest
+// first (NAN: no PM samples that hour), starting a day after the previous
+// case so the window is empty. Returns the last cycle's result.
+static AirQualityResult hourly(std::initializer_list<float> values) {
+  caseStart += 86400;
+  time_t t = caseStart;
+  AirQualityResult aq = {};
+  for (float v : values) {
+    MeasurementData d = {};
+    d.co2 = 600;
+    d.pm25 = isnan(v) ? 0 : v;
+    d.pm10 = isnan(v) ? 0 : v;
+    analyzeAirQuality(t, d, isnan(v) ? CHANNEL_BIT(co2) : ALL, aq);
+    t += 3600;
+  }
+  return aq;
+}
+
+static bool near(float a, float b) { return fabsf(a - b) < 0.01f; }
+
+TEST(nowcast_matches_worked_examples) {
+  // Steady air: NowCast is the concentration
+  AirQualityResult aq = hourly({ 20, 20, 20, 20 });
+  CHECK(near(aq.nowcastPm25, 20));
+
+  // Fast rise: weight floored at 0.5,
+  // (40 + 0.5*20 + 0.25*10) / (1 + 0.5 + 0.25) = 30
+  aq = hourly({ 10, 20, 40 });
+  CHECK(near(aq.nowcastPm25, 30));
+  CHECK(near(aq.nowcastPm10, 30));
+  CHECK_EQ(aq.aqi, aqiFromPm25(30));
+
+  // Weight 12/20 = 0.6: (20 + 0.6*15 + 0.36*12) / 1.96 = 17
+  aq = hourly({ 12, 15, 20 });
+  CHECK(near(aq.nowcastPm25, 17));
+
+  // A missing hour keeps its weight slot: (30 + 0.25*10) / 1.25 = 26
+  aq = hourly({ 10, NAN, 30 });
+  CHECK(near(aq.nowcastPm25, 26));
+
+  // Only 1 of the last 3 hours has data: this cycle's average stands in
+  aq = hourly({ 50, NAN, NAN, 8 });
+  CHECK(near(aq.nowcastPm25, 8));
+  CHECK_EQ(aq.aqi, aqiFromPm25(8));
+
+  // No PM at all: no AQI
+  aq = hourly({ NAN });
+  CHECK_EQ(aq.aqi, (int16_t)-1);
+}
+
+// ===================== Events =====================
+
+static time_t cycleTime = T0 + 365 * 86400;
+
+static uint8_t cycle(float co2, float pm25, uint32_t channels = ALL) {
+  MeasurementData d = {};
+  d.co2 = co2;
+  d.pm25 = pm25;
+  d.pm10 = pm25;
+  AirQualityResult aq = {};
+  analyzeAirQuality(cycleTime, d, channels, aq);
+  cycleTime += MEASURE_INTERVAL_MIN * 60;
+  CHECK_EQ(aq.priority, aq.events != 0);
+  return aq.events;
+}
+
+TEST(thresholds_have_hysteresis) {
+  cycle(1000, 10);
+  CHECK_EQ(cycle(1250, 12), 0);
+  CHECK_EQ(cycle(1500, 36), AQ_EVT_CO2_HIGH | AQ_EVT_PM25_HIGH | AQ_EVT_PM25_RISE);
+  CHECK_EQ(cycle(1400, 32), 0);  // between clear and alert: still raised
+  CHECK_EQ(cycle(1600, 40), 0);
+  CHECK_EQ(cycle(1200, 20), AQ_EVT_CO2_NORMAL | AQ_EVT_PM25_NORMAL);
+  CHECK_EQ(cycle(1000, 10), 0);
+  CHECK_EQ(cycle(1300, 30), AQ_EVT_CO2_RISE | AQ_EVT_PM25_RISE);
+}
+
+TEST(missing_channels_are_skipped) {
+  // Raised alerts stay raised through cycles without the sensor (the zeros
+  // it leaves in MeasurementData are not readings)...
+  cycle(600, 5);
+  CHECK_EQ(cycle(1600, 40), AQ_EVT_CO2_HIGH | AQ_EVT_CO2_RISE | AQ_EVT_PM25_HIGH | AQ_EVT_PM25_RISE);
+  CHECK_EQ(cycle(0, 0, 0), 0);
+  CHECK_EQ(cycle(0, 40, CHANNEL_BIT(pm25) | CHANNEL_BIT(pm10)), 0);
+  CHECK_EQ(cycle(1600, 0, CHANNEL_BIT(co2)), 0);
+  CHECK_EQ(cycle(1000, 10), AQ_EVT_CO2_NORMAL | AQ_EVT_PM25_NORMAL);
+
+  // ...and a rise is only measured between two cycles that have the channel
+  CHECK_EQ(cycle(0, 0, 0), 0);
+  CHECK_EQ(cycle(1400, 35), 0);
+  CHECK_EQ(cycle(1450, 36), AQ_EVT_PM25_HIGH);
+
+  // PM missing for hours on end leaves nothing to compute an AQI from
+  MeasurementData d = {};
+  d.co2 = 600;
+  AirQualityResult aq = {};
+  cycleTime += 86400;
+  analyzeAirQuality(cycleTime, d, CHANNEL_BIT(co2), aq);
+  CHECK_EQ(aq.aqi, (int16_t)-1);
+}
+
+// ===================== Whole cycle =====================
+
+// Backend stand-in: every POST body, one per line, on the card
+static const char RECEIVED[] = "/backend/received";
+
+static shim::HttpResponse backend(const shim::HttpRequest &req) {
+  shim::HttpResponse resp;
+  if (req.method == "POST") shim::sdWrite(RECEIVED, shim::sdRead(RECEIVED) + req.body + "\n");
+  else resp.status = 304;
+  return resp;
+}
+
+static shim::Sps30Mass sps30(time_t t) { return { 4, 12, 30, 80 }; }
+
+SHIM_WAKE(withPm) {
+  shim::setHttpHandler(backend);
+  shim::setSps30Mass(sps30);
+  setup();
+}
+
+SHIM_WAKE(withoutPm) {
+  shim::setHttpHandler(backend);
+  setup();
+}
+
+TEST(sps30_values_reach_the_payload) {
+  shim::sdReset();
+  shim::setEpoch(T0);
+  CHECK(shim::runWake("withPm", shim::Boot::PowerOn).end == shim::WakeEnd::Slept);
+
+  // PM10 is the fourth mass value, after PM4.0. AQI: PM2.5 12.0 -> 56,
+  // PM10 80 -> 63.
+  std::string log = shim::sdRead(SD_LOG_FILE);
+  CHECK(log.find("pm1=4.00 pm2.5=12.00 pm10=80.00") != std::string::npos);
+  CHECK(log.find("[AQ] AQI=63 ") != std::string::npos);
+  std::string sent = shim::sdRead(RECEIVED);
+  CHECK(sent.find("\"pm10\":80") != std::string::npos);
+  CHECK(sent.find("\"aqi\":63") != std::string::npos);
+
+  // Without the SPS30 the zeros are sent as before, but no AQI is made up
+  // from them
+  shim::sdReset();
+  CHECK(shim::runWake("withoutPm", shim::Boot::PowerOn).end == shim::WakeEnd::Slept);
+  log = shim::sdRead(SD_LOG_FILE);
+  CHECK(log.find("[AQ] No PM data for an AQI") != std::string::npos);
+  sent = shim::sdRead(RECEIVED);
+  CHECK(sent.find("\"pm10\":0") != std::string::npos);
+  CHECK(sent.find("\"aqi\"") == std::string::npos);
+}
+
+// ===================== Benchmark =====================
+
+TEST(cost_per_cycle) {
+  CHECK(initSDCard());
+  const int CYCLES = 20000;
+  MeasurementData d = {};
+  AirQualityResult aq = {};
+  time_t t = T0 + 2 * 365 * 86400;
+  uint64_t start = test::nowNs();
+  for (int i = 0; i < CYCLES; i++) {
+    // A daily cycle with some noise, crossing the thresholds now and then
+    float phase = (float)(i % 288) / 288.0f;
+    d.co2 = 600 + 1200 * phase * phase + (i * 37 % 200);
+    d.pm25 = 5 + 40 * phase + (i * 13 % 10);
+    d.pm10 = d.pm25 * 1.6f;
+    analyzeAirQuality(t, d, ALL, aq);
+    t += MEASURE_INTERVAL_MIN * 60;
+  }
+  uint64_t ns = test::nowNs() - start;
+  flushSDLog();
+  printf("        %d cycles: %.2f us per analyzeAirQuality() on this host, its log line included\n",
+         CYCLES, ns / 1e3 / CYCLES);
+  CHECK(ns / CYCLES < 100000);
+}
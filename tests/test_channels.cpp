@@ -0,0 +1,170 @@
+// Channel registry (channels.h): the generated DATA row and JSON payload must
+// match the hand-written formats they replaced, byte for byte, and the layout
+// hash must follow the channel list.
+#include "test.h"
+#include "shim.h"
+#include "checkpoint.h"
+#include "json_utils.h"
+#include "rtc_utils.h"
+#include "sd_logger.h"
+#include <WiFi.h>
+#include <vector>
+
+static uint32_t rngState = 0x2545F491;
+
+static uint32_t rng() {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return rngState;
+}
+
+static float uniform(float lo, float hi) {
+  return lo + (hi - lo) * (rng() / 4294967296.0f);
+}
+
+// Field-level edge cases first (rounding ties, zero, negatives), then random
+static std::vector<MeasurementData> samples() {
+  std::vector<MeasurementData> out;
+  MeasurementData d = {};
+  out.push_back(d);
+
+  d.temperature = -12.345f; d.humidity = 0.125f; d.pressure = 1013.255f;
+  d.pm1 = 2.675f; d.pm25 = 0.005f; d.pm10 = 999.995f; d.co2 = 412.5f; d.voc = -1;
+  out.push_back(d);
+
+  d.temperature = 0.0049f; d.humidity = 100; d.pressure = 650.5f;
+  d.pm1 = 1e-7f; d.pm25 = 35.5f; d.pm10 = 154.9f; d.co2 = 413.5f; d.voc = 500;
+  out.push_back(d);
+
+  for (int i = 0; i < 5000; i++) {
+    d.temperature = uniform(-40, 85);
+    d.humidity    = uniform(0, 100);
+    d.pressure    = uniform(300, 1100);
+    d.pm1         = uniform(0, 1000);
+    d.pm25        = uniform(0, 1000);
+    d.pm10        = uniform(0, 1000);
+    d.co2         = uniform(0, 10000);
+    d.voc         = (int32_t)(rng() % 501);
+    out.push_back(d);
+  }
+  return out;
+}
+
+// ===================== DATA row =====================
+
+// logDataToFile() before the registry
+static std::string referenceDataRow(time_t t, const MeasurementData &d) {
+  char row[160];
+  snprintf(row, sizeof(row),
+    "%s | DATA | temp=%.2f hum=%.2f press=%.2f co2=%.0f voc=%d pm1=%.2f pm2.5=%.2f pm10=%.2f",
+    timeToStr(t).c_str(),
+    d.temperature, d.humidity, d.pressure, d.co2, (int)d.voc, d.pm1, d.pm25, d.pm10);
+  return std::string(row) + "\n";
+}
+
+TEST(data_row_matches_snprintf_format) {
+  configTime(ARMENIA_TZ_OFFSET, ARMENIA_DST_OFFSET, "pool.ntp.org");
+  CHECK(initSDCard());
+
+  std::vector<MeasurementData> rows = samples();
+  std::string expected;
+  time_t t = 1768464000;
+  for (size_t i = 0; i < rows.size(); i++) {
+    logDataToFile(t, rows[i]);
+    expected += referenceDataRow(t, rows[i]);
+    t += 300;
+  }
+  flushSDLog();
+
+  // Keep only the DATA rows; the boot banner shares the file
+  std::string log = shim::sdRead(SD_LOG_FILE), actual;
+  size_t pos = 0;
+  while (pos < log.size()) {
+    size_t end = log.find('\n', pos) + 1;
+    if (log.compare(pos + 19, 9, " | DATA |") == 0) actual += log.substr(pos, end - pos);
+    pos = end;
+  }
+
+  CHECK_EQ(actual.size(), expected.size());
+  size_t mismatch = 0;
+  while (mismatch < actual.size() && actual[mismatch] == expected[mismatch]) mismatch++;
+  if (mismatch < actual.size() || actual.size() != expected.size()) {
+    size_t lineStart = expected.rfind('\n', mismatch) + 1;
+    CHECK_EQ(actual.substr(lineStart, expected.find('\n', mismatch) - lineStart),
+             expected.substr(lineStart, expected.find('\n', mismatch) - lineStart));
+  }
+}
+
+// ===================== JSON payload =====================
+
+// prepareJSON() before the registry
+static std::string referenceJSON(const char *deviceId, time_t t, const MeasurementData &data) {
+  StaticJsonDocument<512> doc;
+  char buffer[20];
+  snprintf(buffer, sizeof(buffer), "device%s", deviceId);
+  doc["device"] = buffer;
+  JsonObject d = doc.createNestedArray("data").createNestedObject();
+  d["time"] = timeToStr(t);
+  d["temperature"] = data.temperature;
+  d["humidity"] = data.humidity;
+  d["pressure"] = data.pressure;
+  d["pm1"] = data.pm1;
+  d["pm2_5"] = data.pm25;
+  d["pm10"] = data.pm10;
+  d["co2"] = data.co2;
+  d["voc"] = data.voc;
+
+  String payload;
+  serializeJson(doc, payload);
+  return payload.c_str();
+}
+
+TEST(json_matches_hand_written_payload) {
+  #if !UFAR_REAL_ARDUINOJSON
+  printf("        (shim ArduinoJson: key order and values only; set ARDUINOJSON_DIR for byte-exact numbers)\n");
+  #endif
+  std::vector<MeasurementData> rows = samples();
+  time_t t = 1768464000;
+  int mismatches = 0;
+  char payload[QUEUE_LINE_MAX];
+  for (const MeasurementData &d : rows) {
+    std::string actual(payload, prepareJSON(payload, sizeof(payload), DEVICE_ID, t, d));
+    std::string expected = referenceJSON(DEVICE_ID, t, d);
+    if (actual != expected && mismatches++ < 3) CHECK_EQ(actual, expected);
+    t += 300;
+  }
+  CHECK_EQ(mismatches, 0);
+}
+
+// ===================== Layout hash =====================
+
+TEST(layout_hash_follows_names_and_types) {
+  // Field names and types in UFAR_CHANNELS order, not JSON keys
+  const char *layout =
+    "temperature:float;humidity:float;pressure:float;pm1:float;pm25:float;pm10:float;"
+    "co2:float;voc:int32_t;"
+    #if SPS30_NUMBER_CONCENTRATION
+    "nc05:float;nc1:float;nc25:float;nc4:float;nc10:float;"
+    #endif
+    ;
+  CHECK_EQ(CHANNEL_LAYOUT_HASH, fnv1a(layout));
+
+  // Reordered or retyped channels hash differently
+  CHECK(CHANNEL_LAYOUT_HASH != fnv1a("humidity:float;temperature:float;pressure:float;pm1:float;"
+                                     "pm25:float;pm10:float;co2:float;voc:int32_t;"));
+  CHECK(CHANNEL_LAYOUT_HASH != fnv1a("temperature:float;humidity:float;pressure:float;pm1:float;"
+                                     "pm25:float;pm10:float;co2:int32_t;voc:int32_t;"));
+}
+
+TEST(checkpoint_carries_layout_hash) {
+  CycleCheckpoint cp = {}, loaded;
+  cp.cycleId = 1768464000;
+  cp.samplesDone = 7;
+  checkpointSave(cp);
+  CHECK_EQ(cp.layout, CHANNEL_LAYOUT_HASH);
+  CHECK(checkpointLoad(loaded));
+  CHECK_EQ(loaded.samplesDone, (uint16_t)7);
+  checkpointClear();
+  CHECK(!checkpointLoad(loaded));
+}
@@ -0,0 +1,125 @@
+// Measurement checkpoint under injected faults: a brownout partway through
+// sampling, then the reset boot that follows it (RTC_NOINIT memory kept,
+// RTC_DATA reloaded), must resume the same slot where it stopped, without
+// resetting or restarting sensors that are still measuring. After a power
+// loss there is nothing to resume.
+#include "test.h"
+#include "shim.h"
+#include "config.h"
+#include "sd_logger.h"
+
+void setup();
+
+static const time_t T0 = 1768464000;
+static const int    SAMPLES = SAMPLE_DURATION_SEC / SAMPLE_INTERVAL_SEC;
+static const int    FAULT_AT_READ = 25;  // SCD30 read the power fails at
+static const char   FAULT[] = "/test/fault";
+
+// The SCD30 is read once per sample; with FAULT on the card, the wake
+// browns out at that read
+static float co2(time_t t) {
+  static int reads = 0;
+  if (++reads == FAULT_AT_READ && shim::sdExists(FAULT)) {
+    shim::sdRemove(FAULT);
+    shim::brownout();
+  }
+  return 600;
+}
+
+SHIM_WAKE(device) {
+  shim::setScd30Co2(co2);
+  setup();
+}
+
+// With the SPS30 fitted too, which keeps measuring through the reset
+static shim::Sps30Mass pm(time_t t) { return { 4, 12, 30, 80 }; }
+
+SHIM_WAKE(device_with_sps30) {
+  shim::setScd30Co2(co2);
+  shim::setSps30Mass(pm);
+  setup();
+}
+
+static bool logHas(const std::string &log, const char *text) {
+  return log.find(text) != std::string::npos;
+}
+
+// The text after `prefix` up to the end of its line
+static std::string lineAfter(const std::string &log, const char *prefix) {
+  size_t pos = log.find(prefix);
+  if (pos == std::string::npos) return std::string();
+  pos += strlen(prefix);
+  return log.substr(pos, log.find('\n', pos) - pos);
+}
+
+// A first cycle, then a wake that loses power FAULT_AT_READ samples in
+static void runToFault(const char *wake = "device") {
+  shim::sdReset();
+  shim::scd30Reset();
+  shim::setEpoch(T0);
+  CHECK(shim::runWake(wake, shim::Boot::PowerOn).end == shim::WakeEnd::Slept);
+
+  shim::sdWrite(FAULT, "1");
+  shim::sdRemove(SD_LOG_FILE);
+  CHECK(shim::runWake(wake, shim::Boot::DeepSleep).end == shim::WakeEnd::Brownout);
+  CHECK(!shim::sdExists(FAULT));
+}
+
+TEST(brownout_mid_cycle_resumes_after_reset) {
+  runToFault();
+  std::string slot = lineAfter(shim::sdRead(SD_LOG_FILE), "[SYSTEM] Next send time: ");
+  CHECK(!slot.empty());
+
+  shim::sdRemove(SD_LOG_FILE);
+  CHECK(shim::runWake("device", shim::Boot::Reset).end == shim::WakeEnd::Slept);
+  std::string log = shim::sdRead(SD_LOG_FILE);
+
+  char resumed[64];
+  snprintf(resumed, sizeof(resumed), "[MEASURE] Resuming interrupted cycle at sample %d", FAULT_AT_READ - 1);
+  char averaged[64];
+  snprintf(averaged, sizeof(averaged), "[MEASURE] Averaged data from %d samples", SAMPLES);
+  CHECK(logHas(log, "[SYSTEM] Found interrupted cycle for "));
+  CHECK(logHas(log, resumed));
+  CHECK(logHas(log, averaged));
+  CHECK_EQ(lineAfter(log, "[SYSTEM] Using scheduled timestamp: "), slot);
+}
+
+TEST(warm_resume_sends_no_reset_or_start) {
+  runToFault("device_with_sps30");
+  shim::Scd30Stats scd30 = shim::scd30Stats();
+  shim::Sps30Stats sps30 = shim::sps30Stats();
+  CHECK(scd30.measuring);
+  CHECK(sps30.measuring);
+
+  shim::sdRemove(SD_LOG_FILE);
+  CHECK(shim::runWake("device_with_sps30", shim::Boot::Reset).end == shim::WakeEnd::Slept);
+  std::string log = shim::sdRead(SD_LOG_FILE);
+
+  char resumed[80];
+  snprintf(resumed, sizeof(resumed), "[MEASURE] Resuming interrupted cycle at sample %d, sensors still warm",
+           FAULT_AT_READ - 1);
+  char averaged[64];
+  snprintf(averaged, sizeof(averaged), "[MEASURE] Averaged data from %d samples", SAMPLES);
+  CHECK(logHas(log, resumed));
+  CHECK(logHas(log, averaged));
+
+  // Both kept measuring and were read for the rest of the cycle
+  shim::Scd30Stats scd30After = shim::scd30Stats();
+  shim::Sps30Stats sps30After = shim::sps30Stats();
+  CHECK_EQ(scd30After.resets, scd30.resets);
+  CHECK_EQ(scd30After.starts, scd30.starts);
+  CHECK_EQ(scd30After.nvmWrites, scd30.nvmWrites);
+  CHECK_EQ(scd30After.readings - scd30.readings, (uint32_t)(SAMPLES - FAULT_AT_READ + 1));
+  CHECK_EQ(sps30After.wakeUps, sps30.wakeUps);
+  CHECK_EQ(sps30After.starts, sps30.starts);
+}
+
+TEST(power_loss_leaves_nothing_to_resume) {
+  runToFault();
+
+  shim::sdRemove(SD_LOG_FILE);
+  CHECK(shim::runWake("device", shim::Boot::PowerOn).end == shim::WakeEnd::Slept);
+  std::string log = shim::sdRead(SD_LOG_FILE);
+  CHECK(!logHas(log, "[SYSTEM] Found interrupted cycle"));
+  CHECK(!logHas(log, "[MEASURE] Resuming"));
+}
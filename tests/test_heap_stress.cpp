@@ -0,0 +1,113 @@
+// Heap under a 10,000-entry offline queue: queueing must not touch the heap
+// at all, and replaying it through real wakes (setup() in its own process,
+// see shim.h) must keep peak heap use and fragmentation flat. String buffers
+// come from the shim's simulated heap, so a String temporary on these paths
+// shows up as allocations and in the [SLEEP] Heap line the firmware logs.
+#include "test.h"
+#include "shim.h"
+#include "config.h"
+#include "air_quality.h"
+#include "sd_logger.h"
+#include <WiFi.h>
+
+void setup();
+
+static const int ENTRIES = 10000;
+
+static size_t countLines(const std::string &s) {
+  return std::count(s.begin(), s.end(), '\n');
+}
+
+SHIM_WAKE(device) {
+  setup();
+}
+
+TEST(queue_and_replay_10k_entries) {
+  shim::sdReset();
+  CHECK(initSDCard());
+  flushSDLog();
+
+  // ---- Queue: every entry through prepareJSON() and the card ----
+  MeasurementData d = {};
+  AirQualityResult aq = {};
+  shim::HeapStats before = shim::heapStats();
+  uint64_t start = test::nowNs();
+  for (int i = 0; i < ENTRIES; i++) {
+    d.temperature = 20 + (i % 100) * 0.1f;
+    d.pm25 = (i % 500) * 0.5f;
+    d.co2 = 400 + (i % 2000);
+    aq.aqi = aqiFromPm25(d.pm25);
+    aq.events = (i % 7 == 0) ? AQ_EVT_PM25_HIGH | AQ_EVT_CO2_RISE : 0;
+    queueFailedData(1768464000 + i * 300, d, &aq);
+    logDataToFile(1768464000 + i * 300, d);
+  }
+  flushSDLog();
+  uint64_t queueNs = test::nowNs() - start;
+  shim::HeapStats after = shim::heapStats();
+
+  printf("        queued %d entries (%.1f us each): %u heap allocation(s), free %zu -> %zu bytes\n",
+         ENTRIES, queueNs / 1e3 / ENTRIES, after.allocations - before.allocations,
+         before.freeBytes, after.freeBytes);
+  CHECK_EQ(countLines(shim::sdRead(SD_QUEUE_FILE)), (size_t)ENTRIES);
+  CHECK_EQ(after.allocations, before.allocations);
+  CHECK_EQ(after.freeBytes, before.freeBytes);
+
+  // ---- Replay: whole wakes until the queue is empty ----
+  shim::sdRemove(SD_LOG_FILE);
+  int wakes = 0;
+  unsigned minFree = ~0u, minLargest = ~0u, reports = 0;
+  shim::Boot boot = shim::Boot::PowerOn;
+  while (shim::sdExists(SD_QUEUE_FILE) && wakes < 2 * ENTRIES) {
+    CHECK(shim::runWake("device", boot).end == shim::WakeEnd::Slept);
+    boot = shim::Boot::DeepSleep;
+    wakes++;
+
+    // The firmware's own report just before deep sleep
+    std::string log = shim::sdRead(SD_LOG_FILE);
+    size_t pos = log.rfind("[SLEEP] Heap: ");
+    unsigned freeNow, minNow, largest;
+    if (pos != std::string::npos &&
+        sscanf(log.c_str() + pos, "[SLEEP] Heap: free=%u min=%u largest=%u",
+               &freeNow, &minNow, &largest) == 3) {
+      minFree = min(minFree, minNow);
+      minLargest = min(minLargest, largest);
+      reports++;
+    }
+    shim::sdRemove(SD_LOG_FILE);
+  }
+
+  printf("        replayed in %d wakes: peak heap use %u bytes, largest free block >= %u of %zu\n",
+         wakes, (unsigned)(shim::HEAP_FREE_AT_BOOT - minFree), minLargest,
+         shim::HEAP_FREE_AT_BOOT);
+  CHECK(!shim::sdExists(SD_QUEUE_FILE));
+  CHECK_EQ(reports, (unsigned)wakes);
+  // What's left is the HTTP/WiFi stack's own String use (URLs, headers)
+  CHECK(shim::HEAP_FREE_AT_BOOT - minFree < 1024);
+  CHECK(minLargest >= shim::HEAP_FREE_AT_BOOT - 1024);
+}
+
+// ===================== Unwritable card =====================
+
+TEST(unwritable_card_drops_log_within_buffer) {
+  shim::sdReset();
+  CHECK(initSDCard());
+  flushSDLog();
+
+  // Well past the 2 KB log buffer while every open fails
+  shim::sdFailNextOpens(1000);
+  char line[120];
+  memset(line, 'x', sizeof(line) - 1);
+  line[sizeof(line) - 1] = '\0';
+  for (int i = 0; i < 100; i++) {
+    logToSD(line);
+    if (i % 8 == 7) flushSDLog();
+  }
+  shim::sdFailNextOpens(0);
+  logToSD("[TEST] card back");
+  flushSDLog();
+
+  std::string log = shim::sdRead(SD_LOG_FILE);
+  CHECK(log.find("[SD] WARNING: log file unwritable") != std::string::npos);
+  CHECK(log.find("[TEST] card back") != std::string::npos);
+  CHECK(log.size() < 4096);
+}
@@ -0,0 +1,155 @@
+// SD log hand-off: SpscRing between two real threads keeps order and loses
+// nothing, logToSD() never waits on a slow card, and DATA rows are never
+// dropped however far the log lines overrun the ring.
+#include "test.h"
+#include "shim.h"
+#include "config.h"
+#include "sd_logger.h"
+#include "spsc_ring.h"
+#include <thread>
+#include <vector>
+
+// ===================== SpscRing =====================
+
+TEST(ring_keeps_order_across_threads) {
+  static SpscRing<uint32_t, 64> ring;
+  const uint32_t ITEMS = 2000000;
+  uint32_t fullPushes = 0;
+
+  std::thread producer([&] {
+    for (uint32_t i = 0; i < ITEMS; i++) {
+      while (!ring.push(i)) {
+        fullPushes++;  // returns at once when full; the caller decides
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  uint32_t next = 0, outOfOrder = 0;
+  uint32_t v;
+  while (next < ITEMS) {
+    if (!ring.pop(v)) {
+      std::this_thread::yield();
+      continue;
+    }
+    if (v != next) outOfOrder++;
+    next = v + 1;
+  }
+  producer.join();
+
+  printf("        %u items through a 64-slot ring, %u push(es) found it full\n", ITEMS, fullPushes);
+  CHECK_EQ(outOfOrder, 0u);
+  CHECK(!ring.pop(v));
+  CHECK(ring.empty());
+}
+
+// ===================== Logger =====================
+
+static size_t count(const std::string &s, const std::string &needle) {
+  size_t n = 0;
+  for (size_t pos = s.find(needle); pos != std::string::npos; pos = s.find(needle, pos + 1)) n++;
+  return n;
+}
+
+TEST(slow_card_never_blocks_log_lines) {
+  shim::sdReset();
+  CHECK(initSDCard());
+  flushSDLog();
+
+  // 20 ms per write: the writer falls far behind the producer
+  shim::sdSetWriteDelayUs(20000);
+  const int LINES = 2000;
+  uint64_t worstNs = 0, totalNs = 0;
+  for (int i = 0; i < LINES; i++) {
+    uint64_t start = test::nowNs();
+    logToSDf("[TEST] line %d", i);
+    uint64_t ns = test::nowNs() - start;
+    totalNs += ns;
+    worstNs = max(worstNs, ns);
+  }
+  shim::sdSetWriteDelayUs(0);
+  flushSDLog();
+
+  std::string log = shim::sdRead(SD_LOG_FILE);
+  size_t written = count(log, "[TEST] line ");
+  printf("        %d lines against a 20 ms/write card: %.2f us each, worst %.2f ms; %zu written, "
+         "the rest counted as dropped\n",
+         LINES, totalNs / 1e3 / LINES, worstNs / 1e6, written);
+  CHECK(worstNs < 5000000);  // no 20 ms write ever lands on the producer
+  CHECK(written < (size_t)LINES);
+  CHECK(log.find("[SD] WARNING: log ring full") != std::string::npos);
+}
+
+TEST(data_rows_survive_a_full_ring) {
+  shim::sdReset();
+  CHECK(initSDCard());
+  flushSDLog();
+
+  // Every row behind a log burst that overruns the ring, then more rows in
+  // a row than the ring holds at all
+  shim::sdSetWriteDelayUs(2000);
+  MeasurementData d = {};
+  const int BURSTS = 100, ROWS = BURSTS + 3 * LOG_RING_RECORDS;
+  for (int i = 0; i < ROWS; i++) {
+    if (i < BURSTS) {
+      for (int j = 0; j < 2 * LOG_RING_RECORDS; j++) logToSDf("[TEST] burst %d", j);
+    }
+    d.co2 = 400 + i;
+    logDataToFile(1768464000 + i * 300, d);
+  }
+  shim::sdSetWriteDelayUs(0);
+  flushSDLog();
+
+  std::string log = shim::sdRead(SD_LOG_FILE);
+  CHECK_EQ(count(log, " | DATA |"), (size_t)ROWS);
+  CHECK(log.find("[SD] WARNING: log ring full") != std::string::npos);
+
+  // In order, one per row
+  size_t pos = 0;
+  for (int i = 0; i < ROWS; i++) {
+    char key[24];
+    snprintf(key, sizeof(key), "co2=%d ", 400 + i);
+    size_t at = log.find(key, pos);
+    if (at == std::string::npos) {
+      CHECK_EQ(std::string(key), std::string("(missing or out of order)"));
+      break;
+    }
+    pos = at;
+  }
+}
+
+// ===================== Writer task =====================
+
+static const char TASKS[] = "/test/tasks";
+static const int  LINES = LOG_RING_RECORDS - LOG_RING_DATA_RESERVE - 20;  // never fills the ring
+
+SHIM_WAKE(init_sd_twice) {
+  uint32_t before = shim::tasksCreated();
+  initSDCard();
+  initSDCard();
+  for (int i = 0; i < LINES; i++) logToSDf("[TEST] line %d", i);
+  flushSDLog();
+  shim::sdWrite(TASKS, std::to_string(shim::tasksCreated() - before));
+}
+
+TEST(second_sd_init_keeps_one_writer) {
+  shim::sdReset();
+  CHECK(shim::runWake("init_sd_twice", shim::Boot::PowerOn).end == shim::WakeEnd::Returned);
+  CHECK_EQ(shim::sdRead(TASKS), std::string("1"));
+
+  // Every line once, in order
+  std::string log = shim::sdRead(SD_LOG_FILE);
+  CHECK_EQ(count(log, "[SYSTEM] ========== BOOT =========="), (size_t)2);
+  CHECK_EQ(count(log, "[TEST] line "), (size_t)LINES);
+  size_t pos = 0;
+  for (int i = 0; i < LINES; i++) {
+    char key[24];
+    snprintf(key, sizeof(key), "line %d\n", i);
+    size_t at = log.find(key, pos);
+    if (at == std::string::npos) {
+      CHECK_EQ(std::string(key), std::string("(missing or out of order)"));
+      break;
+    }
+    pos = at;
+  }
+}
@@ -0,0 +1,47 @@
+#include "test.h"
+#include "shim.h"
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+
+namespace test {
+
+struct Entry {
+  const char *name;
+  TestFn      fn;
+};
+
+static std::vector<Entry> &registry() {
+  static std::vector<Entry> *tests = new std::vector<Entry>;
+  return *tests;
+}
+
+static int failures = 0;
+static const char *current = "";
+
+void add(const char *name, TestFn fn) { registry().push_back({ name, fn }); }
+
+void fail(const char *file, int line, const std::string &message) {
+  failures++;
+  fprintf(stderr, "  FAIL %s (%s:%d): %s\n", current, file, line, message.c_str());
+}
+
+} // namespace test
+
+int main(int argc, char **argv) {
+  if (argc > 2 && strcmp(argv[1], "--shim-wake") == 0) return shim::wakeMain(argv[2]);
+
+  int ran = 0;
+  for (const test::Entry &t : test::registry()) {
+    if (argc > 1 && strcmp(argv[1], t.name) != 0) continue;
+    test::current = t.name;
+    int before = test::failures;
+    t.fn();
+    printf("%s %s\n", test::failures == before ? "  ok  " : "  FAIL", t.name);
+    ran++;
+  }
+  fflush(stdout);
+  fflush(stderr);
+  // Skip static destructors: the firmware's log writer thread is still running
+  _exit(test::failures > 0 || ran == 0 ? 1 : 0);
+}
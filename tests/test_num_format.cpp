@@ -0,0 +1,150 @@
+// num_format.h against the printf formats it replaces: byte-identical output
+// for "%.<n>f" and "%d", and the cost per value of each.
+#include "test.h"
+#include "num_format.h"
+#include <math.h>
+#include <vector>
+
+static std::string reference(float v, int decimals) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", decimals, v);
+  return std::string(buf).substr(0, NUM_FORMAT_MAX - 1);  // formatFixed's limit past 6 decimals
+}
+
+static std::string fixed(float v, int decimals) {
+  char buf[NUM_FORMAT_MAX];
+  size_t n = formatFixed(buf, v, decimals);
+  if (n != strlen(buf)) return "(length mismatch)";
+  return buf;
+}
+
+static float fromBits(uint32_t bits) {
+  float v;
+  memcpy(&v, &bits, sizeof(v));
+  return v;
+}
+
+// Reports the first few mismatches, returns how many there were
+static int compare(float v, int decimals, int &reported) {
+  std::string actual = fixed(v, decimals), expected = reference(v, decimals);
+  if (actual == expected) return 0;
+  if (reported++ < 5) CHECK_EQ(actual, expected);
+  return 1;
+}
+
+// ===================== Equivalence =====================
+
+TEST(fixed_matches_printf_edge_cases) {
+  const float values[] = {
+    0.0f, -0.0f, 0.5f, 1.5f, 2.5f, -2.5f,  // exact ties go to even
+    0.125f, 0.375f, 2.675f, 1.005f, 0.005f, 0.015f, -0.001f, 999.995f,
+    1e-7f, 1.4e-45f, -1.4e-45f, 1.17549435e-38f,  // subnormal / smallest normal
+    8388607.5f, 16777216.0f, 8.796093e12f, 1.7e13f, 3.4e38f, -3.4e38f,
+    INFINITY, -INFINITY, NAN,
+  };
+  int reported = 0, mismatches = 0;
+  for (float v : values) {
+    for (int d = 0; d <= 7; d++) mismatches += compare(v, d, reported);
+  }
+  CHECK_EQ(mismatches, 0);
+}
+
+TEST(fixed_holds_every_float_up_to_6_decimals) {
+  // Around 2^43, where values leave the 64-bit path for snprintf, and up
+  // to the largest floats: the full printf output, nothing cut
+  const float values[] = {
+    8.796093e12f, 8.7960930e12f * 2, 1e19f, 1e20f, 1.8446744e19f, 1e30f,
+    3.4028235e38f, -3.4028235e38f, nextafterf(3.4028235e38f, 0),
+  };
+  int mismatches = 0;
+  size_t longest = 0;
+  for (float v : values) {
+    for (int d = 0; d <= 6; d++) {
+      char expected[64];
+      snprintf(expected, sizeof(expected), "%.*f", d, v);
+      std::string actual = fixed(v, d);
+      longest = std::max(longest, actual.size());
+      if (actual != expected && mismatches++ < 5) CHECK_EQ(actual, std::string(expected));
+    }
+  }
+  CHECK_EQ(mismatches, 0);
+  CHECK_EQ(longest, (size_t)NUM_FORMAT_MAX - 1);  // -FLT_MAX at 6 decimals
+}
+
+TEST(fixed_matches_printf_across_all_floats) {
+  // Every 4099th bit pattern (prime stride: all exponents, scattered mantissas)
+  int reported = 0, mismatches = 0;
+  uint64_t checked = 0;
+  for (uint64_t bits = 0; bits <= 0xFFFFFFFFull; bits += 4099) {
+    float v = fromBits((uint32_t)bits);
+    for (int d = 0; d <= 6; d++) mismatches += compare(v, d, reported);
+    checked++;
+  }
+  printf("        %llu values x 7 precisions\n", (unsigned long long)checked);
+  CHECK_EQ(mismatches, 0);
+}
+
+TEST(fixed_matches_printf_in_sensor_ranges) {
+  // Densely where the channels actually live, at their logged precision
+  int reported = 0, mismatches = 0;
+  for (float v = -40.0f; v <= 85.0f; v += 0.0009f) {
+    mismatches += compare(v, 2, reported);  // temperature
+  }
+  for (float v = 0.0f; v <= 1000.0f; v += 0.0037f) {
+    mismatches += compare(v, 2, reported);  // PM, humidity, pressure
+  }
+  for (float v = 0.0f; v <= 10000.0f; v += 0.0625f) {
+    mismatches += compare(v, 0, reported);  // CO2 (ties every 0.5)
+  }
+  CHECK_EQ(mismatches, 0);
+}
+
+TEST(int_matches_printf) {
+  const int32_t edges[] = { 0, 1, -1, 9, 10, -10, 499, 500, INT32_MAX, INT32_MIN, INT32_MIN + 1 };
+  int mismatches = 0;
+  char actual[NUM_FORMAT_MAX], expected[NUM_FORMAT_MAX];
+  for (int32_t v : edges) {
+    formatInt(actual, v);
+    snprintf(expected, sizeof(expected), "%d", (int)v);
+    if (strcmp(actual, expected) != 0 && mismatches++ < 5) CHECK_EQ(actual, expected);
+  }
+  for (uint64_t bits = 0; bits <= 0xFFFFFFFFull; bits += 65537) {
+    int32_t v = (int32_t)(uint32_t)bits;
+    formatInt(actual, v);
+    snprintf(expected, sizeof(expected), "%d", (int)v);
+    if (strcmp(actual, expected) != 0 && mismatches++ < 5) CHECK_EQ(actual, expected);
+  }
+  CHECK_EQ(mismatches, 0);
+}
+
+// ===================== Cost =====================
+
+TEST(cost_per_value) {
+  // Readings spread over the channels' ranges
+  std::vector<float> values;
+  uint32_t seed = 12345;
+  for (int i = 0; i < 4096; i++) {
+    seed = seed * 1664525u + 1013904223u;
+    values.push_back((seed >> 8) / 16777216.0f * 1100.0f - 40.0f);
+  }
+
+  const int ROUNDS = 50;
+  char buf[64];
+  volatile size_t sink = 0;  // keeps the loops from being optimized out
+
+  uint64_t start = test::nowNs();
+  for (int r = 0; r < ROUNDS; r++) {
+    for (float v : values) sink += formatFixed(buf, v, 2);
+  }
+  double fixedNs = (double)(test::nowNs() - start) / (ROUNDS * values.size());
+
+  start = test::nowNs();
+  for (int r = 0; r < ROUNDS; r++) {
+    for (float v : values) sink += snprintf(buf, sizeof(buf), "%.2f", v);
+  }
+  double printfNs = (double)(test::nowNs() - start) / (ROUNDS * values.size());
+
+  printf("        \"%%.2f\" on this host: formatFixed %.0f ns/value, snprintf %.0f ns/value (%.1fx)\n",
+         fixedNs, printfNs, printfNs / fixedNs);
+  CHECK(fixedNs < printfNs);
+}
@@ -0,0 +1,64 @@
+// OTA manifest fetch: the body is read with or without a Content-Length
+// (chunked, as GitHub raw and most CDNs may send it), and never past
+// HTTP_BODY_MAX.
+#include "test.h"
+#include "shim.h"
+#include "config.h"
+#include "ota_updater.h"
+#include "sd_logger.h"
+#include <WiFi.h>
+
+static std::string manifestBody;
+static bool manifestChunked = false;
+static int binaryFetches = 0;
+
+static shim::HttpResponse server(const shim::HttpRequest &req) {
+  shim::HttpResponse resp;
+  if (req.url == OTA_MANIFEST_URL) {
+    resp.body = manifestBody;
+    resp.chunked = manifestChunked;
+  } else {
+    binaryFetches++;
+  }
+  return resp;
+}
+
+// true if it went as far as flashing (ESP.restart() afterwards)
+static bool runOta(const std::string &body, bool chunked) {
+  manifestBody = body;
+  manifestChunked = chunked;
+  binaryFetches = 0;
+  shim::setHttpHandler(server);
+  WiFi.mode(WIFI_STA);
+  WiFi.begin("test", "test");
+  try {
+    CHECK(!checkAndApplyOTA());
+  } catch (const shim::Restart &) {
+    return true;
+  }
+  return false;
+}
+
+static const char NEWER[] = "{\"version\":\"9.9.9\",\"url\":\"https://ota.test/firmware.bin\"}";
+
+TEST(manifest_with_content_length) {
+  CHECK(runOta(NEWER, false));
+  CHECK_EQ(binaryFetches, 1);
+}
+
+TEST(chunked_manifest_without_content_length) {
+  CHECK(runOta(NEWER, true));
+  CHECK_EQ(binaryFetches, 1);
+}
+
+TEST(same_version_is_not_flashed) {
+  CHECK(!runOta("{\"version\":\"" FIRMWARE_VERSION "\",\"url\":\"https://ota.test/f.bin\"}", true));
+  CHECK_EQ(binaryFetches, 0);
+}
+
+TEST(oversized_manifest_is_rejected) {
+  std::string padded = std::string(NEWER).insert(1, "\"pad\":\"" + std::string(HTTP_BODY_MAX, 'x') + "\",");
+  CHECK(!runOta(padded, true));
+  CHECK(!runOta(padded, false));
+  CHECK_EQ(binaryFetches, 0);
+}
@@ -0,0 +1,248 @@
+// Offline queue through a 48 h backend outage: every wake runs the real
+// setup() in its own process (shim::runWake), so the per-wake replay budget,
+// the circuit breaker and the queue file all behave as across deep sleeps.
+#include "test.h"
+#include "shim.h"
+#include "config.h"
+#include "sd_logger.h"
+#include "json_utils.h"
+#include <set>
+#include <vector>
+
+void setup();
+bool connectWiFi();
+
+// 2026-01-15 08:00:00 UTC, the shim's default clock
+static const time_t T0 = 1768464000;
+static const time_t OUTAGE_START = T0 + 2 * 3600;
+static const time_t OUTAGE_END = OUTAGE_START + 48 * 3600;
+static const time_t SLOW_END = OUTAGE_END + 8 * 3600;  // backend answers slowly at first
+
+// The stand-in backend keeps its state on the simulated card so it outlives
+// each wake process: one line per accepted POST body, and one per POST with
+// the time it held the request
+static const char RECEIVED[] = "/backend/received";
+static const char POSTS[] = "/backend/posts";
+
+static shim::HttpResponse backend(const shim::HttpRequest &req) {
+  shim::HttpResponse resp;
+  if (req.method != "POST") {
+    resp.status = 404;  // no OTA manifest
+    return resp;
+  }
+
+  time_t now = time(nullptr);
+  if (now >= OUTAGE_START && now < OUTAGE_END) {
+    resp.latencyMs = 60000;  // accepts the connection, never answers
+  } else if (now < SLOW_END && now >= OUTAGE_END) {
+    resp.latencyMs = 1500;
+  }
+  uint32_t heldMs = min(resp.latencyMs, req.timeoutMs);
+  shim::sdWrite(POSTS, shim::sdRead(POSTS) + std::to_string(heldMs) + " " +
+                       std::to_string(req.body.size()) + "\n");
+  if (resp.latencyMs <= req.timeoutMs) {
+    shim::sdWrite(RECEIVED, shim::sdRead(RECEIVED) + req.body + "\n");
+  }
+  return resp;
+}
+
+SHIM_WAKE(device) {
+  shim::setHttpHandler(backend);
+  setup();
+}
+
+static size_t countLines(const std::string &s) {
+  return std::count(s.begin(), s.end(), '\n');
+}
+
+// "time" of every delivered reading, as epoch seconds (device clock is UTC+4)
+static std::vector<time_t> deliveredTimes() {
+  std::set<time_t> times;
+  std::string all = shim::sdRead(RECEIVED);
+  size_t pos = 0;
+  while ((pos = all.find("\"time\":\"", pos)) != std::string::npos) {
+    struct tm tm = {};
+    pos += 8;
+    if (strptime(all.c_str() + pos, "%Y-%m-%d %H:%M:%S", &tm)) {
+      times.insert(timegm(&tm) - ARMENIA_TZ_OFFSET);
+    }
+  }
+  return std::vector<time_t>(times.begin(), times.end());
+}
+
+TEST(outage_48h_budget_and_delivery) {
+  shim::sdReset();
+  shim::setEpoch(T0);
+
+  int wakes = 0, outageWakes = 0, drainWakes = 0;
+  uint64_t radioMs = 0, maxRadioMs = 0, naiveMs = 0;
+  uint64_t maxPostMs = 0, maxPostBytes = 0;
+  size_t maxQueued = 0;
+  bool drained = false;
+
+  shim::Boot boot = shim::Boot::PowerOn;
+  while (time(nullptr) < OUTAGE_END + 24 * 3600 && !drained) {
+    time_t wakeAt = time(nullptr);
+    size_t queued = countLines(shim::sdRead(SD_QUEUE_FILE));
+    uint64_t radioBefore = shim::radioOnMs();
+    shim::sdRemove(POSTS);
+
+    shim::WakeResult r = shim::runWake("device", boot);
+    boot = shim::Boot::DeepSleep;
+    wakes++;
+    CHECK(r.end == shim::WakeEnd::Slept);
+    if (r.end != shim::WakeEnd::Slept) break;
+
+    // Every POST this wake, and how long the backend held each
+    uint64_t postMs = 0, postBytes = 0;
+    std::string posts = shim::sdRead(POSTS);
+    for (size_t pos = 0; pos < posts.size(); pos = posts.find('\n', pos) + 1) {
+      unsigned long held, bytes;
+      if (sscanf(posts.c_str() + pos, "%lu %lu", &held, &bytes) == 2) {
+        postMs += held;
+        postBytes += bytes;
+      }
+    }
+    maxPostMs = max(maxPostMs, postMs);
+    maxPostBytes = max(maxPostBytes, postBytes);
+
+    uint64_t wakeRadioMs = shim::radioOnMs() - radioBefore;
+    maxQueued = max(maxQueued, queued);
+    if (wakeAt >= OUTAGE_START && wakeAt < OUTAGE_END) {
+      outageWakes++;
+      radioMs += wakeRadioMs;
+      maxRadioMs = max(maxRadioMs, wakeRadioMs);
+      // Replaying everything with a full timeout per entry, as before the budget
+      naiveMs += (queued + 1) * (uint64_t)HTTP_TIMEOUT_MS;
+    } else if (wakeAt >= OUTAGE_END) {
+      drainWakes++;
+      drained = countLines(shim::sdRead(SD_QUEUE_FILE)) == 0;
+    }
+
+    // The firmware log isn't under test; keep the state file small
+    shim::sdRemove(SD_LOG_FILE);
+  }
+
+  printf("        %d wakes, %d during the outage, queue peaked at %zu entries\n",
+         wakes, outageWakes, maxQueued);
+  printf("        %zu readings delivered\n", deliveredTimes().size());
+  printf("        outage radio time: %.1f s/wake mean, %.1f s max (naive replay: %.1f s/wake)\n",
+         radioMs / 1000.0 / max(outageWakes, 1), maxRadioMs / 1000.0,
+         naiveMs / 1000.0 / max(outageWakes, 1));
+  printf("        drained %d wake(s) after recovery; max %.1f s / %llu bytes of POSTs in one wake\n",
+         drainWakes, maxPostMs / 1000.0, (unsigned long long)maxPostBytes);
+
+  CHECK(outageWakes > 500);
+  CHECK(drained);
+
+  // One budget per wake across both replays, plus sendData()'s own request
+  CHECK(maxPostMs <= QUEUE_FLUSH_BUDGET_SEC * 1000ULL + HTTP_TIMEOUT_MS);
+  CHECK(maxRadioMs < (QUEUE_FLUSH_BUDGET_SEC + 2 * WIFI_TIMEOUT_SEC) * 1000ULL);
+
+  // Nothing lost: one reading per slot from the first to the last
+  std::vector<time_t> times = deliveredTimes();
+  CHECK(!times.empty());
+  if (times.empty()) return;
+  int gaps = 0;
+  for (size_t i = 1; i < times.size(); i++) {
+    if (times[i] - times[i - 1] != MEASURE_INTERVAL_MIN * 60) gaps++;
+  }
+  CHECK_EQ(gaps, 0);
+  CHECK(times.front() < OUTAGE_START);
+  CHECK(times.back() >= OUTAGE_END);
+}
+
+// ===================== Interrupted swap =====================
+
+// A reset between removing the queue and renaming the remainder into place
+SHIM_WAKE(boot_only) {
+  initSDCard();
+  flushSDLog();
+}
+
+TEST(interrupted_swap_recovers_temp_queue) {
+  shim::sdReset();
+  shim::sdWrite(SD_QUEUE_TMP_FILE, "{\"a\":1}\n{\"b\":2}\n");
+
+  CHECK(shim::runWake("boot_only", shim::Boot::Reset).end == shim::WakeEnd::Returned);
+  CHECK_EQ(shim::sdRead(SD_QUEUE_FILE), std::string("{\"a\":1}\n{\"b\":2}\n"));
+  CHECK(!shim::sdExists(SD_QUEUE_TMP_FILE));
+}
+
+TEST(interrupted_copy_keeps_queue) {
+  shim::sdReset();
+  shim::sdWrite(SD_QUEUE_FILE, "{\"a\":1}\n{\"b\":2}\n");
+  shim::sdWrite(SD_QUEUE_TMP_FILE, "{\"b\":2}\n");
+
+  CHECK(shim::runWake("boot_only", shim::Boot::Reset).end == shim::WakeEnd::Returned);
+  CHECK_EQ(shim::sdRead(SD_QUEUE_FILE), std::string("{\"a\":1}\n{\"b\":2}\n"));
+  CHECK(!shim::sdExists(SD_QUEUE_TMP_FILE));
+}
+
+// ===================== Rejected vs failed =====================
+
+// The backend answers every POST with the status on /backend/status, except
+// that the entry {"n":2} gets /backend/reject when that file exists
+static const char STATUS[] = "/backend/status";
+static const char REJECT[] = "/backend/reject";
+
+static shim::HttpResponse scripted(const shim::HttpRequest &req) {
+  shim::HttpResponse resp;
+  std::string reject = shim::sdRead(REJECT);
+  if (!reject.empty() && req.body == "{\"n\":2}") {
+    resp.status = atoi(reject.c_str());
+  } else {
+    resp.status = atoi(shim::sdRead(STATUS).c_str());
+  }
+  shim::sdWrite(POSTS, shim::sdRead(POSTS) + std::to_string(req.timeoutMs) + "\n");
+  if (resp.status == 200) shim::sdWrite(RECEIVED, shim::sdRead(RECEIVED) + req.body + "\n");
+  return resp;
+}
+
+SHIM_WAKE(flush_only) {
+  shim::setHttpHandler(scripted);
+  initSDCard();
+  connectWiFi();
+  flushPendingQueue();
+  flushSDLog();
+}
+
+static const char QUEUED[] = "{\"n\":1}\n{\"n\":2}\n{\"n\":3}\n";
+
+TEST(auth_and_rate_limit_keep_the_queue) {
+  for (int status : { 401, 403, 408, 429, 404, 503 }) {
+    shim::sdReset();
+    shim::sdWrite(SD_QUEUE_FILE, QUEUED);
+    shim::sdWrite(STATUS, std::to_string(status));
+
+    // Nothing dropped, one attempt per wake, and the breaker counts it: the
+    // second wake probes with the short timeout, the third backs off
+    CHECK(shim::runWake("flush_only", shim::Boot::PowerOn).end == shim::WakeEnd::Returned);
+    CHECK_EQ(countLines(shim::sdRead(POSTS)), 1u);
+    CHECK(atoi(shim::sdRead(POSTS).c_str()) > HTTP_PROBE_TIMEOUT_MS);
+    shim::sdRemove(POSTS);
+    CHECK(shim::runWake("flush_only").end == shim::WakeEnd::Returned);
+    CHECK_EQ(countLines(shim::sdRead(POSTS)), 1u);
+    CHECK(atoi(shim::sdRead(POSTS).c_str()) <= HTTP_PROBE_TIMEOUT_MS);
+    shim::sdRemove(POSTS);
+    CHECK(shim::runWake("flush_only").end == shim::WakeEnd::Returned);
+    CHECK(!shim::sdExists(POSTS));
+
+    if (shim::sdRead(SD_QUEUE_FILE) != QUEUED) CHECK_EQ(status, 0);
+  }
+}
+
+TEST(rejected_payloads_are_dropped) {
+  for (int status : { 400, 413, 422 }) {
+    CHECK(payloadRejected(status));
+    shim::sdReset();
+    shim::sdWrite(SD_QUEUE_FILE, QUEUED);
+    shim::sdWrite(STATUS, "200");
+    shim::sdWrite(REJECT, std::to_string(status));
+
+    CHECK(shim::runWake("flush_only", shim::Boot::PowerOn).end == shim::WakeEnd::Returned);
+    CHECK(!shim::sdExists(SD_QUEUE_FILE));
+    CHECK_EQ(shim::sdRead(RECEIVED), std::string("{\"n\":1}\n{\"n\":3}\n"));
+  }
+  for (int status : { 200, 401, 403, 404, 408, 429, 500 }) CHECK(!payloadRejected(status));
+}
@@ -0,0 +1,81 @@
+// SCD30 duty cycling through real wakes against the shim's emulated sensor:
+// it measures only from SCD30_LEAD_SEC before sampling until the cycle ends,
+// every sample reads a fresh measurement exactly once, and boots don't write
+// its NVM beyond what Adafruit_SCD30::begin() itself does.
+#include "test.h"
+#include "shim.h"
+#include "config.h"
+#include "sd_logger.h"
+#include "sensors.h"
+
+void setup();
+
+static const time_t T0 = 1768464000;
+static const int    SAMPLES = SAMPLE_DURATION_SEC / SAMPLE_INTERVAL_SEC;
+
+static float co2(time_t t) { return 420 + (float)(t % 97); }
+
+SHIM_WAKE(device) {
+  shim::setScd30Co2(co2);
+  setup();
+}
+
+SHIM_WAKE(scd30_init) {
+  shim::setScd30Co2(co2);
+  SCD30Sensor scd30;
+  CHECK(scd30.init());
+}
+
+TEST(cycles_read_each_measurement_once) {
+  shim::sdReset();
+  shim::scd30Reset();
+  shim::setEpoch(T0);
+
+  const int WAKES = 12;
+  uint32_t cycles = 0;
+  shim::Boot boot = shim::Boot::PowerOn;
+  for (int i = 0; i < WAKES; i++) {
+    shim::Scd30Stats before = shim::scd30Stats();
+    CHECK(shim::runWake("device", boot).end == shim::WakeEnd::Slept);
+    boot = shim::Boot::DeepSleep;
+
+    // Stopped before deep sleep, with nothing left unread in between
+    shim::Scd30Stats after = shim::scd30Stats();
+    CHECK(!after.measuring);
+    uint32_t read = after.readings - before.readings;
+    CHECK(read == 0 || read == (uint32_t)SAMPLES);
+    if (read) cycles++;
+  }
+
+  shim::Scd30Stats st = shim::scd30Stats();
+  printf("        %d wakes, %u cycles: %u measurements, %u read, %u missed; measuring %.0f s of "
+         "every %d s cycle\n",
+         WAKES, cycles, st.measurements, st.readings, st.missed,
+         cycles ? st.measuringMs / 1000.0 / cycles : 0.0, MEASURE_INTERVAL_MIN * 60);
+  CHECK(cycles >= (uint32_t)WAKES - 2);
+  CHECK_EQ(st.readings, cycles * SAMPLES);
+  CHECK_EQ(st.missed, 0u);
+  // At most one measurement finishes after the last sample, before the stop
+  CHECK(st.measurements <= st.readings + cycles);
+  CHECK(st.measuringMs <= (uint64_t)cycles * (SCD30_LEAD_SEC + SAMPLE_DURATION_SEC + SAMPLE_INTERVAL_SEC) * 1000);
+  CHECK(shim::sdRead(SD_LOG_FILE).find("[SCD30] WARNING: Data not ready") == std::string::npos);
+}
+
+TEST(boots_write_nvm_only_in_begin) {
+  shim::sdReset();
+  shim::scd30Reset();
+  shim::setEpoch(T0);
+
+  const int BOOTS = 20;
+  for (int i = 0; i < BOOTS; i++) {
+    CHECK(shim::runWake("scd30_init", i == 0 ? shim::Boot::PowerOn : shim::Boot::DeepSleep).end ==
+          shim::WakeEnd::Returned);
+    CHECK(!shim::scd30Stats().measuring);
+    shim::setEpoch(T0 + (i + 1) * MEASURE_INTERVAL_MIN * 60);
+  }
+
+  // begin()'s own 2 s interval write every boot, plus enabling ASC once
+  shim::Scd30Stats st = shim::scd30Stats();
+  printf("        %d boots: %u NVM write(s)\n", BOOTS, st.nvmWrites);
+  CHECK_EQ(st.nvmWrites, (uint32_t)BOOTS + 1);
+}
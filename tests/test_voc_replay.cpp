@@ -0,0 +1,200 @@
+// SGP40 VOC state across deep sleep: an SRAW trace replayed through real wakes
+// (SGP40Sensor sampling its window, then the process ends as on deep sleep)
+// against the algorithm run continuously at 1 Hz on the same trace, with and
+// without the state carried in RTC memory.
+//
+// The trace is synthetic, not a recording: a baseline with a daily swing and
+// slow drift, sensor noise, VOC episodes that pull SRAW down, and a step in
+// the baseline during a 2 h gap in the wakes. The VOC algorithm is the shim's
+// behavioural model, so the numbers show the persistence and gap handling,
+// not the exact index the sensor would report.
+#include "test.h"
+#include "shim.h"
+#include "config.h"
+#include "sensors.h"
+#include "sd_logger.h"
+#include <math.h>
+#include <vector>
+
+static const time_t T0 = 1768464000;
+static const int    CYCLE_SEC = MEASURE_INTERVAL_MIN * 60;
+static const int    SAMPLES = SGP40_SAMPLE_WINDOW_SEC / SAMPLE_INTERVAL_SEC;
+static const int    DAYS = 2;
+// No wakes from GAP_START: the longest sleep the full state is restored
+// across (just under 2 h from the last save to the next wake)
+static const time_t GAP_START = T0 + 30 * 3600;
+static const time_t GAP_END = GAP_START + SGP40_STATE_FULL_RESTORE_SEC - CYCLE_SEC;
+static const char   RESULT[] = "/voc/index";
+
+// ===================== Trace =====================
+
+static uint32_t hash(uint32_t x) {
+  x ^= x >> 16; x *= 0x7feb352d;
+  x ^= x >> 15; x *= 0x846ca68b;
+  return x ^ (x >> 16);
+}
+
+static uint16_t sraw(time_t t) {
+  double s = (double)(t - T0);
+  double baseline = 30000 + 800 * sin(2 * M_PI * s / 86400) + 0.005 * s;
+  if (t >= GAP_START + 1800) baseline += 1200;  // moved while the device slept
+  double noise = (int)(hash((uint32_t)s) % 41) - 20;
+
+  // A 40-minute VOC episode every 7 hours
+  double episode = fmod(s, 7 * 3600);
+  double voc = episode < 2400 ? 3000 * sin(M_PI * episode / 2400) : 0;
+  return (uint16_t)lround(baseline + noise - voc);
+}
+
+// ===================== Device =====================
+
+SHIM_WAKE(voc_cycle) {
+  shim::setSgp40Raw(sraw);
+  initSDCard();
+  SGP40Sensor sgp40;
+  int32_t index = -1;
+  if (sgp40.init()) {
+    for (int i = 0; i < SAMPLES; i++) {
+      if (i > 0) delay(SAMPLE_INTERVAL_SEC * 1000);
+      sgp40.read(index);
+    }
+    sgp40.sleep();
+  }
+  flushSDLog();
+  shim::sdWrite(RESULT, std::to_string(index));
+}
+
+// A wake where the SGP40 doesn't answer (loose cable, brownout on the bus)
+SHIM_WAKE(voc_missing) {
+  SGP40Sensor sgp40;
+  CHECK(!sgp40.init());
+  sgp40.sleep();
+}
+
+static std::vector<time_t> cycleStarts() {
+  std::vector<time_t> starts;
+  for (time_t t = T0; t < T0 + DAYS * 86400; t += CYCLE_SEC) {
+    if (t < GAP_START || t >= GAP_END) starts.push_back(t);
+  }
+  return starts;
+}
+
+// The VOC index at the end of each cycle's window, from the wakes. Without
+// keepState every wake is a power-on, so RTC memory starts empty.
+static std::vector<int32_t> runDevice(bool keepState) {
+  std::vector<int32_t> out;
+  shim::sdReset();
+  shim::Boot boot = shim::Boot::PowerOn;
+  for (time_t start : cycleStarts()) {
+    shim::setEpoch(start);
+    shim::sdRemove(RESULT);
+    CHECK(shim::runWake("voc_cycle", boot).end == shim::WakeEnd::Returned);
+    out.push_back(atoi(shim::sdRead(RESULT).c_str()));
+    if (keepState) boot = shim::Boot::DeepSleep;
+  }
+  return out;
+}
+
+// The same duty cycle on the algorithm directly, restoring the full state
+// after every gap
+static std::vector<int32_t> runModel() {
+  std::vector<int32_t> out;
+  VocAlgorithmParams saved;
+  time_t savedAt = 0;
+  bool valid = false;
+  for (time_t start : cycleStarts()) {
+    VocAlgorithmParams p;
+    VocAlgorithm_init(&p);
+    if (valid) {
+      time_t gap = start - savedAt;
+      CHECK(gap <= SGP40_STATE_FULL_RESTORE_SEC);
+      p = saved;
+    }
+    int32_t index = 0;
+    for (int i = 0; i < SAMPLES; i++) {
+      VocAlgorithm_process(&p, sraw(start + i * SAMPLE_INTERVAL_SEC), &index);
+    }
+    saved = p;
+    savedAt = start + (SAMPLES - 1) * SAMPLE_INTERVAL_SEC;
+    valid = true;
+    out.push_back(index);
+  }
+  return out;
+}
+
+// The reference: every second, as if the device never slept
+static std::vector<int32_t> runContinuous() {
+  std::vector<time_t> starts = cycleStarts();
+  std::vector<int32_t> out;
+  VocAlgorithmParams p;
+  VocAlgorithm_init(&p);
+  int32_t index = 0;
+  size_t next = 0;
+  for (time_t t = T0; next < starts.size(); t++) {
+    VocAlgorithm_process(&p, sraw(t), &index);
+    if (t == starts[next] + (SAMPLES - 1) * SAMPLE_INTERVAL_SEC) {
+      out.push_back(index);
+      next++;
+    }
+  }
+  return out;
+}
+
+// Mean |index - reference| over cycles whose start is in [from, to)
+static double meanError(const std::vector<int32_t> &index, const std::vector<int32_t> &ref,
+                        time_t from, time_t to) {
+  std::vector<time_t> starts = cycleStarts();
+  double sum = 0;
+  int n = 0;
+  for (size_t i = 0; i < starts.size(); i++) {
+    if (starts[i] < from || starts[i] >= to) continue;
+    sum += fabs((double)index[i] - ref[i]);
+    n++;
+  }
+  return n ? sum / n : 0;
+}
+
+// ===================== Tests =====================
+
+TEST(persisted_state_tracks_continuous_run) {
+  std::vector<int32_t> ref = runContinuous();
+  std::vector<int32_t> persisted = runDevice(true);
+  std::vector<int32_t> cold = runDevice(false);  // every wake before the state was kept
+
+  time_t settled = T0 + 12 * 3600;
+  time_t end = T0 + DAYS * 86400;
+  printf("        %zu cycles of %d samples; mean |index - continuous| after the first 12 h:\n",
+         ref.size(), SAMPLES);
+  printf("          state kept across sleep: %.1f   cold start every wake: %.1f\n",
+         meanError(persisted, ref, settled, end), meanError(cold, ref, settled, end));
+
+  // The wakes do exactly what the duty-cycled model does
+  CHECK(persisted == runModel());
+  CHECK(meanError(persisted, ref, settled, end) < meanError(cold, ref, settled, end) / 4);
+}
+
+TEST(two_hour_gap_keeps_the_baseline) {
+  std::vector<int32_t> ref = runContinuous();
+  std::vector<int32_t> persisted = runDevice(true);
+  std::vector<int32_t> cold = runDevice(false);
+
+  time_t after = GAP_END + 6 * 3600;
+  double keptErr = meanError(persisted, ref, GAP_END, after);
+  double coldErr = meanError(cold, ref, GAP_END, after);
+  printf("        6 h after the 2 h gap: mean |index - continuous| %.1f state kept, %.1f cold start\n",
+         keptErr, coldErr);
+  CHECK(keptErr < coldErr);
+}
+
+TEST(failed_init_keeps_saved_state) {
+  shim::sdReset();
+  shim::setEpoch(T0);
+  CHECK(shim::runWake("voc_cycle", shim::Boot::PowerOn).end == shim::WakeEnd::Returned);
+  shim::setEpoch(T0 + CYCLE_SEC);
+  CHECK(shim::runWake("voc_missing", shim::Boot::DeepSleep).end == shim::WakeEnd::Returned);
+  shim::setEpoch(T0 + 2 * CYCLE_SEC);
+  shim::sdRemove(SD_LOG_FILE);
+  CHECK(shim::runWake("voc_cycle", shim::Boot::DeepSleep).end == shim::WakeEnd::Returned);
+  std::string log = shim::sdRead(SD_LOG_FILE);
+  CHECK(log.find("[SGP40] VOC state restored") != std::string::npos);
+}
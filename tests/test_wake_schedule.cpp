@@ -0,0 +1,108 @@
+// Wake scheduling over a simulated deployment: three days of real wakes
+// (setup() in its own process each time) with a variable wake-to-ready
+// latency and an RTC slow clock that runs DRIFT_PPM slow. Reports the idle
+// time spent awake before each window and the missed slots, against the
+// fixed "wake 10 s early" policy the scheduler replaced, and checks the drift
+// the scheduler learns from NTP re-syncs.
+#include "test.h"
+#include "shim.h"
+#include "config.h"
+#include "sd_logger.h"
+#include <math.h>
+#include <vector>
+
+void setup();
+
+static const time_t  T0 = 1768464000;
+static const int     DAYS = 3;
+static const int32_t DRIFT_PPM = 1500;
+static const float   OLD_EARLY_SEC = 10;  // the policy before the scheduler
+
+static uint32_t hash(uint32_t x) {
+  x ^= x >> 16; x *= 0x7feb352d;
+  x ^= x >> 15; x *= 0x846ca68b;
+  return x ^ (x >> 16);
+}
+
+// The OTA manifest check is where wakes differ most: usually under a second,
+// now and then a slow AP or DNS holds it for several
+static shim::HttpResponse server(const shim::HttpRequest &req) {
+  shim::HttpResponse resp;
+  if (req.method == "POST") {
+    resp.latencyMs = 300;
+    return resp;
+  }
+  resp.status = 304;
+  uint32_t h = hash((uint32_t)(time(nullptr) / 60));
+  resp.latencyMs = h % 100 < 4 ? 5000 + h % 7000 : 150 + h % 900;
+  return resp;
+}
+
+SHIM_WAKE(device) {
+  shim::setHttpHandler(server);
+  setup();
+}
+
+TEST(three_day_deployment) {
+  shim::sdReset();
+  shim::setEpoch(T0);
+  shim::setRtcDriftPpm(DRIFT_PPM);
+
+  std::vector<float> latencies;
+  unsigned cycles = 0, misses = 0, idleSec = 0;
+  int driftPpm = 0, driftSamples = 0;
+  double worstClockErr = 0;
+  int wakes = 0;
+  shim::Boot boot = shim::Boot::PowerOn;
+  while (shim::epochUs() / 1000000 < (uint64_t)(T0 + DAYS * 86400)) {
+    CHECK(shim::runWake("device", boot).end == shim::WakeEnd::Slept);
+    boot = shim::Boot::DeepSleep;
+    wakes++;
+
+    std::string log = shim::sdRead(SD_LOG_FILE);
+    shim::sdRemove(SD_LOG_FILE);
+    size_t pos = log.find("[SCHED] Ready ");
+    float latency;
+    if (pos != std::string::npos && sscanf(log.c_str() + pos, "[SCHED] Ready %fs", &latency) == 1) {
+      latencies.push_back(latency);
+    }
+    pos = log.rfind("[SCHED] Totals: ");
+    if (pos != std::string::npos) {
+      sscanf(log.c_str() + pos, "[SCHED] Totals: %u cycles, %u missed, %us", &cycles, &misses, &idleSec);
+    }
+    pos = log.find("drift sample ");
+    if (pos != std::string::npos && sscanf(log.c_str() + pos, "drift sample %dppm", &driftPpm) == 1) {
+      driftSamples++;
+    }
+    // Once drift is known the clock is corrected on every wake, not only at
+    // the re-syncs
+    if (driftSamples > 0) worstClockErr = fmax(worstClockErr, fabs(shim::clockErrorUs() / 1e6));
+  }
+
+  // What waking OLD_EARLY_SEC before every window would have done with the
+  // same latencies
+  double oldIdle = 0;
+  unsigned oldMisses = 0;
+  for (float l : latencies) {
+    if (l > OLD_EARLY_SEC) oldMisses++;
+    else oldIdle += OLD_EARLY_SEC - l;
+  }
+
+  printf("        %d wakes, %u cycles, RTC %+d ppm\n", wakes, cycles, (int)DRIFT_PPM);
+  printf("        scheduler: %u missed (%.1f%%), %.1f s idle awake per cycle (%.0f s saved in %d days)\n",
+         misses, 100.0 * misses / cycles, (double)idleSec / cycles, oldIdle - idleSec, DAYS);
+  printf("        wake %.0f s early: %u missed (%.1f%%), %.1f s idle awake per cycle\n",
+         OLD_EARLY_SEC, oldMisses, 100.0 * oldMisses / latencies.size(), oldIdle / latencies.size());
+  printf("        drift learned from %d NTP re-sync(s): %d ppm; clock then at most %.2f s off true time\n",
+         driftSamples, driftPpm, worstClockErr);
+
+  CHECK(cycles >= (unsigned)(DAYS * 86400 / (MEASURE_INTERVAL_MIN * 60)) - 2);
+  // The lead is about the 95th latency percentile
+  CHECK(misses * 100 <= cycles * 5);
+  CHECK(misses < oldMisses);
+  CHECK(idleSec < oldIdle);
+  // WAKE_RESYNC_SEC counts sleep only, about half of each cycle
+  CHECK(driftSamples >= 3);
+  CHECK(abs(driftPpm - DRIFT_PPM) < DRIFT_PPM / 10);
+  CHECK(worstClockErr < 1.0);
+}
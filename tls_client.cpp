@@ -0,0 +1,234 @@
+#include "tls_client.h"
+#include "tls_session.h"
+#include "sd_logger.h"
+#include "arena.h"
+#include "config.h"
+#include <mbedtls/ssl.h>
+#include <mbedtls/net_sockets.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/x509_crt.h>
+#include <mbedtls/error.h>
+
+struct TlsClient::State {
+  mbedtls_ssl_context      ssl;
+  mbedtls_ssl_config       conf;
+  mbedtls_x509_crt         ca;
+  mbedtls_entropy_context  entropy;
+  mbedtls_ctr_drbg_context drbg;
+  bool                     chainVerified = false;  // set by the verify callback
+  int                      peeked = -1;            // byte read ahead by peek()
+};
+
+// ===================== Socket I/O =====================
+// mbedTLS moves records over the TCP connection through WiFiClient's methods
+
+static int tlsSend(void *ctx, const unsigned char *buf, size_t len) {
+  TlsClient *c = static_cast<TlsClient *>(ctx);
+  size_t n = c->WiFiClient::write(buf, len);
+  return n > 0 ? (int)n : MBEDTLS_ERR_NET_SEND_FAILED;
+}
+
+static int tlsRecv(void *ctx, unsigned char *buf, size_t len) {
+  TlsClient *c = static_cast<TlsClient *>(ctx);
+  if (c->WiFiClient::available() <= 0) {
+    return c->WiFiClient::connected() ? MBEDTLS_ERR_SSL_WANT_READ : MBEDTLS_ERR_NET_CONN_RESET;
+  }
+  int n = c->WiFiClient::read(buf, len);
+  return n > 0 ? n : MBEDTLS_ERR_SSL_WANT_READ;
+}
+
+// Only called while a certificate chain is checked, i.e. on a full handshake
+static int onVerify(void *ctx, mbedtls_x509_crt *, int, uint32_t *) {
+  *static_cast<bool *>(ctx) = true;
+  return 0;
+}
+
+static void logTlsError(const char *what, const char *host, int ret) {
+  char err[80];
+  mbedtls_strerror(ret, err, sizeof(err));
+  logToSDf("[TLS] %s %s failed: %s (-0x%04x)", what, host, err, (unsigned)-ret);
+}
+
+// ===================== Connect =====================
+
+TlsClient::~TlsClient() {
+  stop();
+}
+
+int TlsClient::connect(const char *host, uint16_t port, int32_t timeoutMs) {
+  stop();
+  resumed_ = false;
+  if (!rootCA_ || !*rootCA_) {
+    logToSDf("[TLS] No root CA for %s, refusing to connect", host);
+    return 0;
+  }
+
+  unsigned long start = millis();
+  if (!WiFiClient::connect(host, port, timeoutMs)) return 0;
+
+  tls_ = new State();
+  mbedtls_ssl_init(&tls_->ssl);
+  mbedtls_ssl_config_init(&tls_->conf);
+  mbedtls_x509_crt_init(&tls_->ca);
+  mbedtls_entropy_init(&tls_->entropy);
+  mbedtls_ctr_drbg_init(&tls_->drbg);
+
+  int ret = mbedtls_ctr_drbg_seed(&tls_->drbg, mbedtls_entropy_func, &tls_->entropy, nullptr, 0);
+  if (ret == 0) {
+    ret = mbedtls_x509_crt_parse(&tls_->ca, (const unsigned char *)rootCA_, strlen(rootCA_) + 1);
+  }
+  if (ret == 0) {
+    ret = mbedtls_ssl_config_defaults(&tls_->conf, MBEDTLS_SSL_IS_CLIENT,
+                                      MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
+  }
+  if (ret == 0) {
+    mbedtls_ssl_conf_authmode(&tls_->conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+    mbedtls_ssl_conf_ca_chain(&tls_->conf, &tls_->ca, nullptr);
+    mbedtls_ssl_conf_rng(&tls_->conf, mbedtls_ctr_drbg_random, &tls_->drbg);
+    mbedtls_ssl_conf_verify(&tls_->conf, onVerify, &tls_->chainVerified);
+    ret = mbedtls_ssl_setup(&tls_->ssl, &tls_->conf);
+  }
+  if (ret == 0) ret = mbedtls_ssl_set_hostname(&tls_->ssl, host);
+  if (ret != 0) {
+    logTlsError("Setup for", host, ret);
+    stop();
+    return 0;
+  }
+  mbedtls_ssl_set_bio(&tls_->ssl, this, tlsSend, tlsRecv, nullptr);
+
+  // Offer the session saved by an earlier connect (maybe an earlier wake)
+  ArenaScope scope;
+  uint8_t *session = (uint8_t *)arenaAlloc(TLS_SESSION_MAX_BYTES);
+  size_t sessionLen = session ? tlsSessionLoad(host, port, session, TLS_SESSION_MAX_BYTES) : 0;
+  bool offered = false;
+  if (sessionLen > 0) {
+    mbedtls_ssl_session saved;
+    mbedtls_ssl_session_init(&saved);
+    offered = mbedtls_ssl_session_load(&saved, session, sessionLen) == 0 &&
+              mbedtls_ssl_set_session(&tls_->ssl, &saved) == 0;
+    mbedtls_ssl_session_free(&saved);
+  }
+
+  while ((ret = mbedtls_ssl_handshake(&tls_->ssl)) != 0) {
+    if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) break;
+    if ((int32_t)(millis() - start) > timeoutMs) {
+      ret = MBEDTLS_ERR_SSL_TIMEOUT;
+      break;
+    }
+    delay(2);
+  }
+  if (ret != 0) {
+    logTlsError("Handshake with", host, ret);
+    if (offered) tlsSessionForget(host, port);
+    stop();
+    return 0;
+  }
+
+  // The server accepted the offered session if it never sent a chain to verify
+  resumed_ = offered && !tls_->chainVerified;
+
+  // Save what the server handed out (a fresh session or a renewed ticket)
+  if (session) {
+    mbedtls_ssl_session current;
+    mbedtls_ssl_session_init(&current);
+    size_t len = 0;
+    if (mbedtls_ssl_get_session(&tls_->ssl, &current) == 0) {
+      ret = mbedtls_ssl_session_save(&current, session, TLS_SESSION_MAX_BYTES, &len);
+      if (ret == 0 || ret == MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL) {
+        tlsSessionStore(host, port, session, len);
+      }
+    }
+    mbedtls_ssl_session_free(&current);
+  }
+  return 1;
+}
+
+void TlsClient::stop() {
+  if (tls_) {
+    mbedtls_ssl_close_notify(&tls_->ssl);
+    mbedtls_ssl_free(&tls_->ssl);
+    mbedtls_ssl_config_free(&tls_->conf);
+    mbedtls_x509_crt_free(&tls_->ca);
+    mbedtls_ctr_drbg_free(&tls_->drbg);
+    mbedtls_entropy_free(&tls_->entropy);
+    delete tls_;
+    tls_ = nullptr;
+  }
+  WiFiClient::stop();
+}
+
+uint8_t TlsClient::connected() {
+  if (!tls_) return 0;
+  return WiFiClient::connected() || available() > 0;
+}
+
+// ===================== Data =====================
+
+size_t TlsClient::write(const uint8_t *buf, size_t size) {
+  if (!tls_) return 0;
+  size_t done = 0;
+  while (done < size) {
+    int ret = mbedtls_ssl_write(&tls_->ssl, buf + done, size - done);
+    if (ret > 0) {
+      done += ret;
+    } else if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+      logTlsError("Write to", "server", ret);
+      stop();
+      break;
+    }
+  }
+  return done;
+}
+
+int TlsClient::available() {
+  if (!tls_) return 0;
+  int n = mbedtls_ssl_get_bytes_avail(&tls_->ssl);
+  if (n == 0) {
+    // Process a pending record, if any, so its plaintext becomes available
+    int ret = mbedtls_ssl_read(&tls_->ssl, nullptr, 0);
+    if (ret < 0 && ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+      stop();
+      return 0;
+    }
+    n = mbedtls_ssl_get_bytes_avail(&tls_->ssl);
+  }
+  return n + (tls_->peeked >= 0 ? 1 : 0);
+}
+
+int TlsClient::read(uint8_t *buf, size_t size) {
+  if (!tls_ || size == 0) return -1;
+  int got = 0;
+  if (tls_->peeked >= 0) {
+    buf[got++] = (uint8_t)tls_->peeked;
+    tls_->peeked = -1;
+    if (size == 1) return got;
+  }
+  int ret = mbedtls_ssl_read(&tls_->ssl, buf + got, size - got);
+  if (ret > 0) return got + ret;
+  if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+    stop();  // close_notify, reset or a fatal alert
+  }
+  return got > 0 ? got : -1;
+}
+
+int TlsClient::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int TlsClient::peek() {
+  if (!tls_) return -1;
+  if (tls_->peeked < 0) {
+    uint8_t c;
+    if (mbedtls_ssl_read(&tls_->ssl, &c, 1) == 1) tls_->peeked = c;
+  }
+  return tls_->peeked;
+}
+
+// HTTPClient::end() calls this before keeping a connection for reuse: a
+// response body left here would be read as the next response
+void TlsClient::flush() {
+  uint8_t buf[64];
+  while (available() > 0 && read(buf, sizeof(buf)) > 0) {}
+}
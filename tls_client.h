@@ -0,0 +1,43 @@
+#pragma once
+#include <Arduino.h>
+#include <WiFi.h>
+
+// TLS client on top of a plain WiFiClient socket that resumes sessions across
+// deep sleep: after each handshake the session is saved in RTC memory
+// (tls_session.h) and offered on the next connect to the same host, so most
+// wakes skip the certificate chain and key exchange. WiFiClientSecure can't
+// do this, as it builds a fresh TLS context inside connect().
+// The server certificate is always verified; with no CA set, connect() fails.
+class TlsClient : public WiFiClient {
+public:
+  TlsClient() {}
+  ~TlsClient() override;
+
+  void setCACert(const char *rootCA) { rootCA_ = rootCA; }  // PEM, kept by pointer
+
+  // Not virtual in WiFiClient: call it through a TlsClient*
+  int connect(const char *host, uint16_t port, int32_t timeoutMs);
+  int connect(const char *host, uint16_t port) override { return connect(host, port, 30000); }
+  // Whether the last connect() resumed a saved session
+  bool resumed() const { return resumed_; }
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *buf, size_t size) override;
+  int available() override;
+  int read() override;
+  int read(uint8_t *buf, size_t size) override;
+  int peek() override;
+  void flush() override;  // discards the plaintext that has arrived
+  void stop() override;
+  uint8_t connected() override;
+  operator bool() override { return connected(); }
+
+private:
+  TlsClient(const TlsClient &) = delete;
+  TlsClient &operator=(const TlsClient &) = delete;
+
+  struct State;
+  State      *tls_ = nullptr;
+  const char *rootCA_ = nullptr;
+  bool        resumed_ = false;
+};
@@ -0,0 +1,67 @@
+#include "tls_session.h"
+#include "sd_logger.h"
+#include "config.h"
+
+struct TlsSessionSlot {
+  char     host[48];
+  uint16_t port;
+  uint16_t length;   // 0 = empty slot
+  time_t   savedAt;
+  uint8_t  data[TLS_SESSION_MAX_BYTES];
+};
+
+// ===================== RTC state =====================
+RTC_DATA_ATTR static TlsSessionSlot sessionSlots[TLS_SESSION_SLOTS];
+
+static TlsSessionSlot *findSlot(const char *host, uint16_t port) {
+  for (int i = 0; i < TLS_SESSION_SLOTS; i++) {
+    TlsSessionSlot &s = sessionSlots[i];
+    if (s.length > 0 && s.port == port && strcmp(s.host, host) == 0) return &s;
+  }
+  return nullptr;
+}
+
+// ===================== Cache =====================
+
+size_t tlsSessionLoad(const char *host, uint16_t port, uint8_t *buf, size_t cap) {
+  TlsSessionSlot *s = findSlot(host, port);
+  if (!s) return 0;
+
+  time_t age = time(nullptr) - s->savedAt;
+  if (age < 0 || age > TLS_SESSION_MAX_AGE_SEC || s->length > cap) {
+    s->length = 0;
+    return 0;
+  }
+  memcpy(buf, s->data, s->length);
+  return s->length;
+}
+
+void tlsSessionStore(const char *host, uint16_t port, const uint8_t *data, size_t len) {
+  if (strlen(host) >= sizeof(sessionSlots[0].host)) return;
+  if (len == 0 || len > TLS_SESSION_MAX_BYTES) {
+    logToSDf("[TLS] Session for %s is %u bytes, not cached", host, (unsigned)len);
+    return;
+  }
+
+  TlsSessionSlot *s = findSlot(host, port);
+  for (int i = 0; i < TLS_SESSION_SLOTS && !s; i++) {
+    if (sessionSlots[i].length == 0) s = &sessionSlots[i];
+  }
+  if (!s) {
+    s = &sessionSlots[0];
+    for (int i = 1; i < TLS_SESSION_SLOTS; i++) {
+      if (sessionSlots[i].savedAt < s->savedAt) s = &sessionSlots[i];
+    }
+  }
+
+  strlcpy(s->host, host, sizeof(s->host));
+  s->port = port;
+  s->length = len;
+  s->savedAt = time(nullptr);
+  memcpy(s->data, data, len);
+}
+
+void tlsSessionForget(const char *host, uint16_t port) {
+  TlsSessionSlot *s = findSlot(host, port);
+  if (s) s->length = 0;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <Arduino.h>
+
+// TLS sessions saved per host in RTC memory, so the first connection of a
+// wake can resume the previous wake's session (abbreviated handshake, no
+// certificate chain or key exchange) instead of a full handshake.
+// The bytes are whatever the TLS client serializes; this cache doesn't look
+// inside. Slots are reused least-recently-saved first.
+
+// Copies the saved session for host:port into buf. Returns its length, or 0
+// if there is none, it is older than TLS_SESSION_MAX_AGE_SEC or doesn't fit.
+size_t tlsSessionLoad(const char *host, uint16_t port, uint8_t *buf, size_t cap);
+void   tlsSessionStore(const char *host, uint16_t port, const uint8_t *data, size_t len);
+// E.g. after a resumption attempt the server turned down
+void   tlsSessionForget(const char *host, uint16_t port);
@@ -0,0 +1,1166 @@
+// fleet_load - fleet load generator and local ingest stand-in
+//
+// Simulates many ufar_project devices against the API (POST_URL) and the S3
+// log mirror from one event-loop process, to see how the ingest side copes
+// with slot-aligned sends, post-outage queue replay and full-log uploads.
+//
+// Each simulated device follows the firmware's per-wake request pattern:
+//   - wake SPS30_WARMUP_SEC + SAMPLE_DURATION_SEC + the scheduler's lead
+//     before its MEASURE_INTERVAL_MIN slot boundary (+ optional per-device
+//     jitter) and connect WiFi (random delay);
+//   - setup()'s flushPendingQueue() if anything is queued (and no routine
+//     batch is being held): replay queued readings oldest first on one
+//     keep-alive connection, dropping entries the backend rejects (400, 413,
+//     422) and stopping at the first other failure. After an outage this is
+//     the replay herd: every device wakes with a full queue in the same few
+//     seconds before its slot;
+//   - measure until the slot (later if the replay made the device late),
+//     then sendData(): POST the reading, with the circuit breaker from
+//     circuit_breaker.cpp deciding whether to try at all;
+//   - after a successful send, flushPendingQueue() again, within what is
+//     left of the wake's QUEUE_FLUSH_BUDGET_SEC/BYTES;
+//   - then uploadLogToS3(): PUT the whole (growing) log file on a separate
+//     connection;
+//   - UPLINK_ROUTINE_BATCH deferral and timeouts (HTTP_TIMEOUT_MS, probe
+//     HTTP_PROBE_TIMEOUT_MS) as in config.h.
+//
+// Payloads come from the firmware's own prepareJSON() (see payload.h), with
+// the device's local time in "time".
+//
+// Host tool, not part of the sketch build. Build with tools/Makefile:
+//
+//   make -C tools fleet_load [ARDUINOJSON_DIR=/path/to/ArduinoJson/src]
+//
+// Usage:
+//   fleet_load serve [--port P] [--latency-ms L] [--capacity RPS] [--fail-rate F]
+//       Stand-in for both endpoints: POST -> 200 JSON, PUT -> 200. --capacity
+//       serves at most RPS requests/s (FIFO), --fail-rate answers 503.
+//   fleet_load run [--local] [--api HOST:PORT[/PATH]] [--s3 HOST:PORT]
+//                  [--devices N] [--cycles C] [--jitter-sec J] [--wifi-ms A-B]
+//                  [--lead-sec L] [--outage-min M] [--log-kb K] [--log-growth B] [--no-s3]
+//                  [--batch N] [--realtime] [--timeline FILE] [--seed S]
+//                  [--latency-ms L] [--capacity RPS] [--fail-rate F]
+//       --local starts the stand-in in-process (server options apply to it).
+//       --lead-sec is how early a wake comes before the measurement window
+//       (default: the scheduler's initial lead from WAKE_LATENCY_INIT_SEC).
+//       --outage-min makes the API unreachable for the first M simulated
+//       minutes, so devices queue, back off, then replay together.
+//       Idle time between slots is skipped unless --realtime is given;
+//       everything from a slot boundary until the last device sleeps runs in
+//       real time, so arrival spread and latencies are real.
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "channels.h"
+#include "payload.h"
+
+// ===================== Common =====================
+
+static int64_t monoNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void setNonBlocking(int fd) {
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+static void raiseFdLimit() {
+  struct rlimit rl;
+  if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+  }
+}
+
+struct Endpoint {
+  std::string host = "127.0.0.1";
+  uint16_t    port = 8080;
+  std::string path = "/api";
+  sockaddr_in addr = {};
+};
+
+// "host:port[/path]"
+static bool parseEndpoint(const char *s, Endpoint &ep) {
+  std::string str = s;
+  size_t slash = str.find('/');
+  if (slash != std::string::npos) {
+    ep.path = str.substr(slash);
+    str.resize(slash);
+  }
+  size_t colon = str.rfind(':');
+  if (colon != std::string::npos) {
+    ep.port = atoi(str.c_str() + colon + 1);
+    str.resize(colon);
+  }
+  if (!str.empty()) ep.host = str;
+
+  addrinfo hints = {}, *res = nullptr;
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  if (getaddrinfo(ep.host.c_str(), nullptr, &hints, &res) != 0 || !res) return false;
+  ep.addr = *(sockaddr_in *)res->ai_addr;
+  ep.addr.sin_port = htons(ep.port);
+  freeaddrinfo(res);
+  return true;
+}
+
+// Minimal HTTP/1.1 response/request head parsing (what HTTPClient and the
+// stand-in exchange: Content-Length bodies, optional Connection: close)
+struct HttpHead {
+  int    status = 0;
+  size_t headerLen = 0;
+  size_t contentLength = 0;
+  bool   close = false;
+};
+
+static bool headerValue(const char *head, size_t len, const char *name, std::string &value) {
+  size_t nameLen = strlen(name);
+  for (const char *p = head; p < head + len;) {
+    const char *eol = (const char *)memchr(p, '\n', head + len - p);
+    if (!eol) break;
+    if ((size_t)(eol - p) > nameLen && strncasecmp(p, name, nameLen) == 0 && p[nameLen] == ':') {
+      const char *v = p + nameLen + 1;
+      while (v < eol && *v == ' ') v++;
+      const char *e = eol;
+      while (e > v && (e[-1] == '\r' || e[-1] == ' ')) e--;
+      value.assign(v, e - v);
+      return true;
+    }
+    p = eol + 1;
+  }
+  return false;
+}
+
+static bool parseHead(const std::string &in, HttpHead &h) {
+  size_t end = in.find("\r\n\r\n");
+  if (end == std::string::npos) return false;
+  h.headerLen = end + 4;
+  size_t lines = end + 2;  // through the last header's CRLF
+  std::string v;
+  h.contentLength = headerValue(in.data(), lines, "Content-Length", v) ? strtoull(v.c_str(), nullptr, 10) : 0;
+  h.close = headerValue(in.data(), lines, "Connection", v) && strcasecmp(v.c_str(), "close") == 0;
+  if (in.compare(0, 5, "HTTP/") == 0) {
+    size_t sp = in.find(' ');
+    h.status = (sp != std::string::npos) ? atoi(in.c_str() + sp + 1) : 0;
+  }
+  return true;
+}
+
+struct Timer {
+  int64_t  at;
+  uint32_t id;
+  uint32_t seq;
+  uint8_t  kind;
+  bool operator>(const Timer &o) const { return at > o.at; }
+};
+
+typedef std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> TimerHeap;
+
+// ===================== Stand-in server =====================
+
+struct ServerOptions {
+  uint16_t port = 8080;
+  double   latencyMs = 0;
+  double   capacity = 0;   // requests/s, 0 = unlimited
+  double   failRate = 0;
+};
+
+struct ServerConn {
+  int         fd = -1;
+  std::string in;
+  std::string out;
+  HttpHead    head;
+  bool        inBody = false;
+  size_t      bodyLeft = 0;
+  bool        isPut = false;
+  uint32_t    seq = 0;
+};
+
+struct ServerStats {
+  std::atomic<uint64_t> posts{0}, puts{0}, failed{0}, bodyBytes{0}, connections{0};
+};
+
+class StandInServer {
+public:
+  explicit StandInServer(const ServerOptions &opt) : opt_(opt) {}
+
+  // Binds the listener; port 0 picks a free one (see port())
+  bool listenOn() {
+    listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(opt_.port);
+    if (bind(listenFd_, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(listenFd_, 65535) != 0) {
+      perror("fleet_load: listen");
+      return false;
+    }
+    socklen_t len = sizeof(addr);
+    getsockname(listenFd_, (sockaddr *)&addr, &len);
+    port_ = ntohs(addr.sin_port);
+    setNonBlocking(listenFd_);
+
+    epollFd_ = epoll_create1(0);
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.u32 = UINT32_MAX;
+    epoll_ctl(epollFd_, EPOLL_CTL_ADD, listenFd_, &ev);
+    return true;
+  }
+
+  uint16_t port() const { return port_; }
+  const ServerStats &stats() const { return stats_; }
+  void stop() { running_ = false; }
+
+  void run() {
+    epoll_event events[256];
+    int64_t nextReport = monoNs() + 10000000000LL;
+    while (running_) {
+      int timeoutMs = 100;
+      if (!delayed_.empty()) {
+        int64_t wait = (delayed_.top().at - monoNs()) / 1000000;
+        timeoutMs = (int)std::max<int64_t>(0, std::min<int64_t>(timeoutMs, wait));
+      }
+      int n = epoll_wait(epollFd_, events, 256, timeoutMs);
+      for (int i = 0; i < n; i++) {
+        if (events[i].data.u32 == UINT32_MAX) {
+          acceptAll();
+        } else {
+          onEvent(events[i].data.u32, events[i].events);
+        }
+      }
+
+      int64_t now = monoNs();
+      while (!delayed_.empty() && delayed_.top().at <= now) {
+        Timer t = delayed_.top();
+        delayed_.pop();
+        if (t.id < conns_.size() && conns_[t.id].fd >= 0 && conns_[t.id].seq == t.seq) {
+          respond(conns_[t.id], t.kind);
+        }
+      }
+
+      if (reportEvery_ && now >= nextReport) {
+        fprintf(stderr, "[serve] %llu POST, %llu PUT, %llu failed, %.1f MB received\n",
+                (unsigned long long)stats_.posts, (unsigned long long)stats_.puts,
+                (unsigned long long)stats_.failed, stats_.bodyBytes / 1e6);
+        nextReport = now + 10000000000LL;
+      }
+    }
+  }
+
+  void reportPeriodically() { reportEvery_ = true; }
+
+private:
+  enum Reply : uint8_t { REPLY_POST, REPLY_PUT, REPLY_FAIL, REPLY_NOT_FOUND };
+
+  void acceptAll() {
+    for (;;) {
+      int fd = accept4(listenFd_, nullptr, nullptr, SOCK_NONBLOCK);
+      if (fd < 0) return;
+      if ((size_t)fd >= conns_.size()) conns_.resize(fd + 1024);
+      ServerConn &c = conns_[fd];
+      c = ServerConn();
+      c.fd = fd;
+      c.seq = ++seq_;
+      stats_.connections++;
+      epoll_event ev = {};
+      ev.events = EPOLLIN;
+      ev.data.u32 = fd;
+      epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev);
+    }
+  }
+
+  void closeConn(ServerConn &c) {
+    close(c.fd);
+    c.fd = -1;
+    c.in.clear();
+    c.out.clear();
+  }
+
+  void onEvent(uint32_t fd, uint32_t events) {
+    ServerConn &c = conns_[fd];
+    if (c.fd < 0) return;
+    if (events & EPOLLOUT) flushOut(c);
+    if (c.fd < 0 || !(events & (EPOLLIN | EPOLLHUP | EPOLLERR))) return;
+
+    char buf[65536];
+    for (;;) {
+      ssize_t n = read(c.fd, buf, sizeof(buf));
+      if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+        closeConn(c);
+        return;
+      }
+      if (n < 0) break;
+      consume(c, buf, n);
+      if (c.fd < 0) return;
+    }
+  }
+
+  // Heads are buffered, bodies only counted
+  void consume(ServerConn &c, const char *data, size_t len) {
+    while (len > 0) {
+      if (c.inBody) {
+        size_t take = std::min(len, c.bodyLeft);
+        c.bodyLeft -= take;
+        stats_.bodyBytes += take;
+        data += take;
+        len -= take;
+        if (c.bodyLeft == 0) requestDone(c);
+        continue;
+      }
+      size_t before = c.in.size();
+      c.in.append(data, len);
+      if (!parseHead(c.in, c.head)) {
+        if (c.in.size() > 16384) closeConn(c);
+        return;
+      }
+      c.isPut = c.in.compare(0, 4, "PUT ") == 0;
+      size_t used = c.head.headerLen - before;
+      data += used;
+      len -= used;
+      c.in.clear();
+      c.inBody = true;
+      c.bodyLeft = c.head.contentLength;
+      if (c.bodyLeft == 0) requestDone(c);
+    }
+  }
+
+  void requestDone(ServerConn &c) {
+    c.inBody = false;
+    uint8_t reply = c.isPut ? REPLY_PUT : REPLY_POST;
+    if (opt_.failRate > 0 && drand48() < opt_.failRate) reply = REPLY_FAIL;
+
+    int64_t now = monoNs();
+    int64_t at = now;
+    if (opt_.capacity > 0) {
+      nextFree_ = std::max(nextFree_, now) + (int64_t)(1e9 / opt_.capacity);
+      at = nextFree_;
+    }
+    at += (int64_t)(opt_.latencyMs * 1e6);
+    if (at <= now) {
+      respond(c, reply);
+    } else {
+      delayed_.push({ at, (uint32_t)c.fd, c.seq, reply });
+    }
+  }
+
+  void respond(ServerConn &c, uint8_t reply) {
+    static const char okJson[] =
+        "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: 15\r\n"
+        "Connection: keep-alive\r\n\r\n{\"status\":\"ok\"}";
+    static const char okEmpty[] = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\nConnection: keep-alive\r\n\r\n";
+    static const char unavailable[] =
+        "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: keep-alive\r\n\r\n";
+    static const char notFound[] = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+
+    switch (reply) {
+      case REPLY_POST: c.out.append(okJson, sizeof(okJson) - 1); stats_.posts++; break;
+      case REPLY_PUT:  c.out.append(okEmpty, sizeof(okEmpty) - 1); stats_.puts++; break;
+      case REPLY_FAIL: c.out.append(unavailable, sizeof(unavailable) - 1); stats_.failed++; break;
+      default:         c.out.append(notFound, sizeof(notFound) - 1); break;
+    }
+    flushOut(c);
+  }
+
+  void flushOut(ServerConn &c) {
+    while (!c.out.empty()) {
+      ssize_t n = write(c.fd, c.out.data(), c.out.size());
+      if (n < 0) {
+        if (errno == EAGAIN) break;
+        closeConn(c);
+        return;
+      }
+      c.out.erase(0, n);
+    }
+    epoll_event ev = {};
+    ev.events = EPOLLIN | (c.out.empty() ? 0u : (uint32_t)EPOLLOUT);
+    ev.data.u32 = c.fd;
+    epoll_ctl(epollFd_, EPOLL_CTL_MOD, c.fd, &ev);
+  }
+
+  ServerOptions           opt_;
+  int                     listenFd_ = -1, epollFd_ = -1;
+  uint16_t                port_ = 0;
+  uint32_t                seq_ = 0;
+  int64_t                 nextFree_ = 0;
+  bool                    reportEvery_ = false;
+  std::atomic<bool>       running_{true};
+  std::vector<ServerConn> conns_;
+  TimerHeap               delayed_;
+  ServerStats             stats_;
+};
+
+// ===================== Payload =====================
+
+static std::string payloadFor(const std::string &deviceId, int64_t t) {
+  char buf[QUEUE_LINE_MAX];
+  size_t len = buildPayload(buf, sizeof(buf), deviceId.c_str(), (time_t)t);
+  return std::string(buf, len);
+}
+
+// ===================== Fleet simulation =====================
+
+struct RunOptions {
+  Endpoint api, s3;
+  bool     local = false;
+  uint32_t devices = 1000;
+  uint32_t cycles = 12;
+  double   jitterSec = 0;
+  uint32_t wifiMinMs = 800, wifiMaxMs = 3000;
+  // schedulerLeadSec() before it has learned anything
+  uint32_t leadSec = (uint32_t)ceil(WAKE_LATENCY_INIT_SEC + WAKE_LATENCY_Z * sqrt(WAKE_LATENCY_INIT_SEC));
+  double   outageMin = 0;
+  uint64_t logBytes = 64 * 1024;
+  uint64_t logGrowth = 2400;      // bytes a wake adds to the log file
+  bool     uploadLogs = true;
+  uint32_t batch = UPLINK_ROUTINE_BATCH;
+  bool     realtime = false;
+  const char *timeline = nullptr;
+  uint64_t seed = 1;
+};
+
+enum Phase : uint8_t {
+  SLEEPING, BOOT_WIFI, BOOT_REPLAY, MEASURING, WIFI, POST_CURRENT, REPLAY, S3_PUT, DONE
+};
+enum TimerKind : uint8_t { TIMER_WAKE, TIMER_WIFI, TIMER_SEND, TIMER_DEADLINE };
+enum RequestType : uint8_t { REQ_API, REQ_BOOT_REPLAY, REQ_REPLAY, REQ_S3, REQ_TYPES };
+
+static const char *REQUEST_NAMES[REQ_TYPES] = { "api", "boot-replay", "replay", "s3" };
+
+// setup() waits this long between becoming ready and sending (warm-up + sampling)
+static const int64_t MEASURE_SEC = SPS30_WARMUP_SEC + SAMPLE_DURATION_SEC;
+
+struct Device {
+  std::string id;
+  int64_t     offsetNs = 0;          // per-device send offset (jitter)
+  Phase       phase = SLEEPING;
+  uint32_t    cycle = 0;
+  int64_t     slotTime = 0;          // simulated epoch of this cycle's slot
+  uint32_t    timerSeq = 0;
+
+  // Firmware state that survives deep sleep
+  std::deque<int64_t> queue;         // reading times in the SD queue
+  uint16_t    failures = 0;          // circuit breaker
+  int64_t     retryAfter = 0;
+  uint32_t    routineDeferred = 0;
+  uint64_t    logBytes = 0;
+
+  // Current request
+  int         fd = -1;
+  int         connectedTo = -1;      // REQ_S3 or REQ_API endpoint of fd
+  RequestType type = REQ_API;
+  std::string out;
+  size_t      outPos = 0;
+  uint64_t    bodyLeft = 0;          // streamed S3 body bytes still to send
+  std::string in;
+  int64_t     startNs = 0;
+  uint32_t    reqSeq = 0;
+  std::string payload;
+
+  // flushPendingQueue() budget, shared by every flush of a wake
+  int64_t     flushSpentNs = 0;
+  int64_t     flushStartNs = 0;
+  size_t      flushBytes = 0;
+};
+
+struct TypeStats {
+  uint64_t ok = 0, failed = 0, timeouts = 0, rejected = 0;
+  std::vector<uint32_t> latencyUs;
+};
+
+struct SecondStats {
+  uint32_t started = 0, completed = 0, errors = 0, maxOpen = 0;
+};
+
+class Fleet {
+public:
+  explicit Fleet(const RunOptions &opt) : opt_(opt) {}
+
+  int run() {
+    epollFd_ = epoll_create1(0);
+    filler_.reserve(FILLER_SIZE);
+    while (filler_.size() < FILLER_SIZE) {
+      filler_ += "2025-01-01 00:00:00 | LOG  | [MEASURE] Sample 1/10 collected\n";
+    }
+
+    // Start on a slot boundary, like calculateNextSend(); the first slot is
+    // the next one, so its wakes come after the start
+    const int64_t interval = MEASURE_INTERVAL_MIN * 60;
+    simStart_ = (1735689600 / interval + 1) * interval;  // 2025-01-01
+    loopStart_ = monoNs();
+
+    srand48(opt_.seed);
+    devices_.resize(opt_.devices);
+    for (uint32_t i = 0; i < opt_.devices; i++) {
+      Device &d = devices_[i];
+      d.id = std::to_string(10000 + i);
+      d.offsetNs = (int64_t)(drand48() * opt_.jitterSec * 1e9);
+      d.logBytes = opt_.logBytes;
+      d.slotTime = simStart_ + interval;
+      scheduleWake(i);
+    }
+
+    epoll_event events[1024];
+    while (done_ < opt_.devices) {
+      int64_t now = loopNow();
+      if (!timers_.empty() && open_ == 0 && busy_ == 0 && !opt_.realtime && timers_.top().at > now) {
+        skipNs_ += timers_.top().at - now;  // nothing in flight: jump to the next wake
+        now = loopNow();
+      }
+
+      int timeoutMs = 1000;
+      if (!timers_.empty()) {
+        timeoutMs = (int)std::max<int64_t>(0, std::min<int64_t>(1000, (timers_.top().at - now + 999999) / 1000000));
+      }
+      int n = epoll_wait(epollFd_, events, 1024, timeoutMs);
+      for (int i = 0; i < n; i++) onSocket(events[i].data.u32, events[i].events);
+
+      now = loopNow();
+      while (!timers_.empty() && timers_.top().at <= now) {
+        Timer t = timers_.top();
+        timers_.pop();
+        onTimer(t);
+      }
+    }
+
+    report();
+    return 0;
+  }
+
+private:
+  static constexpr size_t FILLER_SIZE = 65536;
+
+  // ----- clocks -----
+  // Loop time is monotonic time plus the idle time skipped so far; simulated
+  // epoch time advances with loop time from simStart_.
+  int64_t loopNow() const { return monoNs() + skipNs_; }
+  int64_t simToLoop(int64_t sim) const { return loopStart_ + (sim - simStart_) * 1000000000LL; }
+  int64_t simNow() const { return simStart_ + (loopNow() - loopStart_) / 1000000000LL; }
+
+  void schedule(uint32_t dev, TimerKind kind, int64_t at) {
+    uint32_t seq = (kind == TIMER_DEADLINE) ? devices_[dev].reqSeq : ++devices_[dev].timerSeq;
+    timers_.push({ at, dev, seq, kind });
+  }
+
+  // Loop time of the device's slot, jitter included
+  int64_t slotAt(const Device &d) const { return simToLoop(d.slotTime) + d.offsetNs; }
+
+  void scheduleWake(uint32_t i) {
+    schedule(i, TIMER_WAKE, slotAt(devices_[i]) - (MEASURE_SEC + opt_.leadSec) * 1000000000LL);
+  }
+
+  bool outage() const { return simNow() < simStart_ + (int64_t)(opt_.outageMin * 60); }
+
+  SecondStats &second() {
+    size_t s = (size_t)((loopNow() - loopStart_) / 1000000000LL);
+    if (s >= seconds_.size()) seconds_.resize(s + 1);
+    return seconds_[s];
+  }
+
+  // ----- circuit breaker (circuit_breaker.cpp, per device, simulated clock) -----
+  bool uplinkAllowed(const Device &d) const {
+    return d.failures < UPLINK_BREAKER_THRESHOLD || simNow() >= d.retryAfter;
+  }
+
+  void uplinkResult(Device &d, int status) {
+    if ((status >= 200 && status < 400) || payloadRejected(status)) {
+      d.failures = 0;
+      d.retryAfter = 0;
+      return;
+    }
+    if (d.failures < 0xFFFF) d.failures++;
+    if (d.failures < UPLINK_BREAKER_THRESHOLD) return;
+    uint32_t shift = d.failures - UPLINK_BREAKER_THRESHOLD;
+    uint32_t backoff = UPLINK_BACKOFF_MAX_SEC;
+    if (shift < 16 && ((uint32_t)UPLINK_BACKOFF_BASE_SEC << shift) < UPLINK_BACKOFF_MAX_SEC) {
+      backoff = (uint32_t)UPLINK_BACKOFF_BASE_SEC << shift;
+    }
+    d.retryAfter = simNow() + backoff;
+  }
+
+  // ----- wake cycle -----
+
+  void onTimer(const Timer &t) {
+    Device &d = devices_[t.id];
+    if (t.kind == TIMER_DEADLINE) {
+      bool inRequest = d.phase == BOOT_REPLAY || (d.phase >= POST_CURRENT && d.phase <= S3_PUT);
+      if (t.seq == d.reqSeq && d.fd >= 0 && inRequest) {
+        stats_[d.type].timeouts++;
+        requestDone(t.id, -11);  // HTTPC_ERROR_READ_TIMEOUT
+      }
+      return;
+    }
+    if (t.seq != d.timerSeq) return;
+    if (t.kind == TIMER_WAKE) wake(t.id);
+    else if (t.kind == TIMER_WIFI) wifiUp(t.id);
+    else if (t.kind == TIMER_SEND) send(t.id);
+  }
+
+  void connectWiFi(uint32_t i) {
+    busy_++;
+    uint32_t wifiMs = opt_.wifiMinMs + (uint32_t)(drand48() * (opt_.wifiMaxMs - opt_.wifiMinMs));
+    schedule(i, TIMER_WIFI, loopNow() + wifiMs * 1000000LL);
+  }
+
+  // setup(): WiFi first, for NTP, the queue and the OTA check
+  void wake(uint32_t i) {
+    Device &d = devices_[i];
+    d.flushSpentNs = 0;
+    d.flushBytes = 0;
+    d.phase = BOOT_WIFI;
+    connectWiFi(i);
+  }
+
+  // Then flushPendingQueue() unless routine readings are being held back
+  void bootFlush(uint32_t i) {
+    Device &d = devices_[i];
+    if (d.queue.empty() || d.routineDeferred > 0) {
+      measure(i);
+      return;
+    }
+    if (outage()) {
+      if (uplinkAllowed(d)) uplinkResult(d, -1);  // the first entry fails
+      measure(i);
+      return;
+    }
+    d.phase = BOOT_REPLAY;
+    startFlush(i);
+  }
+
+  // WiFi off, sensors up, then the measurement window; a wake the replay
+  // kept past the window start sends that much late
+  void measure(uint32_t i) {
+    Device &d = devices_[i];
+    closeSocket(d);
+    d.phase = MEASURING;
+    schedule(i, TIMER_SEND, std::max<int64_t>(slotAt(d), loopNow() + MEASURE_SEC * 1000000000LL));
+  }
+
+  // sendData(): the reading is logged, then deferred, queued or sent
+  void send(uint32_t i) {
+    Device &d = devices_[i];
+    if (opt_.batch > 1 && d.routineDeferred + 1 < opt_.batch) {
+      d.routineDeferred++;
+      d.queue.push_back(d.slotTime);
+      sleep(i);
+      return;
+    }
+    if (!uplinkAllowed(d)) {
+      d.queue.push_back(d.slotTime);
+      backedOff_++;
+      sleep(i);
+      return;
+    }
+    d.phase = WIFI;
+    connectWiFi(i);
+  }
+
+  void wifiUp(uint32_t i) {
+    Device &d = devices_[i];
+    busy_--;
+    if (d.phase == BOOT_WIFI) {
+      bootFlush(i);
+      return;
+    }
+    if (outage()) {
+      // API unreachable: fails like a refused connection, without traffic
+      uplinkResult(d, -1);
+      d.queue.push_back(d.slotTime);
+      outageFailures_++;
+      sleep(i);
+      return;
+    }
+    d.phase = POST_CURRENT;
+    d.payload = payloadFor(d.id, d.slotTime);
+    startRequest(i, REQ_API);
+  }
+
+  void requestDone(uint32_t i, int status) {
+    Device &d = devices_[i];
+    int64_t now = loopNow();
+    TypeStats &ts = stats_[d.type];
+    if (status == 200 || status == 201) {
+      ts.ok++;
+      ts.latencyUs.push_back((uint32_t)std::min<int64_t>(UINT32_MAX, (now - d.startNs) / 1000));
+      second().completed++;
+    } else {
+      if (payloadRejected(status)) ts.rejected++;
+      ts.failed++;
+      second().errors++;
+    }
+    d.reqSeq++;
+
+    HttpHead h;
+    bool keepAlive = status > 0 && parseHead(d.in, h) && !h.close;
+    d.in.clear();
+    if (!keepAlive) closeSocket(d);
+
+    if (d.type != REQ_S3) uplinkResult(d, status);
+
+    switch (d.phase) {
+      case POST_CURRENT:
+        if (status == 200 || status == 201) {
+          d.routineDeferred = 0;
+          d.phase = REPLAY;
+          startFlush(i);
+        } else {
+          d.queue.push_back(d.slotTime);
+          sleep(i);
+        }
+        break;
+
+      case BOOT_REPLAY:
+      case REPLAY:
+        if (status == 200 || status == 201) {
+          d.flushBytes += d.payload.size();
+          d.queue.pop_front();
+          nextReplay(i);
+        } else if (payloadRejected(status)) {
+          d.queue.pop_front();  // rejected, dropped
+          nextReplay(i);
+        } else {
+          endFlush(i);  // stop flushing until the next wake
+        }
+        break;
+
+      case S3_PUT:
+        sleep(i);
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  // flushPendingQueue(): sequential, same connection, within the wake's
+  // time and byte budget
+  void startFlush(uint32_t i) {
+    devices_[i].flushStartNs = loopNow();
+    nextReplay(i);
+  }
+
+  int64_t flushBudgetLeftNs(const Device &d) const {
+    return QUEUE_FLUSH_BUDGET_SEC * 1000000000LL - d.flushSpentNs - (loopNow() - d.flushStartNs);
+  }
+
+  void nextReplay(uint32_t i) {
+    Device &d = devices_[i];
+    if (d.queue.empty() || !uplinkAllowed(d)) {
+      endFlush(i);
+      return;
+    }
+    std::string payload = payloadFor(d.id, d.queue.front());
+    bool overBudget = flushBudgetLeftNs(d) <= 0 ||
+                      (d.flushBytes > 0 && d.flushBytes + payload.size() > QUEUE_FLUSH_BUDGET_BYTES);
+    if (overBudget) {
+      endFlush(i);
+      return;
+    }
+    d.payload.swap(payload);
+    startRequest(i, d.phase == BOOT_REPLAY ? REQ_BOOT_REPLAY : REQ_REPLAY);
+  }
+
+  void endFlush(uint32_t i) {
+    Device &d = devices_[i];
+    d.flushSpentNs += loopNow() - d.flushStartNs;
+    if (d.phase == BOOT_REPLAY) measure(i);
+    else uploadLog(i);
+  }
+
+  // uploadLogToS3(): the whole log file, separate host
+  void uploadLog(uint32_t i) {
+    Device &d = devices_[i];
+    if (!opt_.uploadLogs) {
+      sleep(i);
+      return;
+    }
+    d.phase = S3_PUT;
+    startRequest(i, REQ_S3);
+  }
+
+  void sleep(uint32_t i) {
+    Device &d = devices_[i];
+    closeSocket(d);
+    d.logBytes += opt_.logGrowth;
+
+    int64_t drainNs = loopNow() - simToLoop(d.slotTime);
+    if (d.cycle >= slotDrainNs_.size()) slotDrainNs_.resize(d.cycle + 1);
+    slotDrainNs_[d.cycle] = std::max(slotDrainNs_[d.cycle], drainNs);
+    queueDepthMax_ = std::max(queueDepthMax_, d.queue.size());
+
+    if (++d.cycle >= opt_.cycles) {
+      d.phase = DONE;
+      done_++;
+      return;
+    }
+    d.phase = SLEEPING;
+    d.slotTime += MEASURE_INTERVAL_MIN * 60;
+    scheduleWake(i);
+  }
+
+  // ----- sockets -----
+
+  void startRequest(uint32_t i, RequestType type) {
+    Device &d = devices_[i];
+    const Endpoint &ep = (type == REQ_S3) ? opt_.s3 : opt_.api;
+    int target = (type == REQ_S3) ? REQ_S3 : REQ_API;
+    if (d.fd >= 0 && d.connectedTo != target) closeSocket(d);
+
+    d.type = type;
+    d.startNs = loopNow();
+    d.in.clear();
+    d.outPos = 0;
+    second().started++;
+
+    char head[512];
+    int n;
+    if (type == REQ_S3) {
+      n = snprintf(head, sizeof(head),
+                   "PUT /logs/device_%s_log.txt HTTP/1.1\r\nHost: %s\r\nUser-Agent: ESP32HTTPClient\r\n"
+                   "Connection: keep-alive\r\nAccept-Encoding: identity;q=1,chunked;q=0.1,*;q=0\r\n"
+                   "Content-Type: text/plain\r\nContent-Length: %llu\r\n\r\n",
+                   d.id.c_str(), ep.host.c_str(), (unsigned long long)d.logBytes);
+      d.out.assign(head, n);
+      d.bodyLeft = d.logBytes;
+    } else {
+      n = snprintf(head, sizeof(head),
+                   "POST %s HTTP/1.1\r\nHost: %s\r\nUser-Agent: ESP32HTTPClient\r\n"
+                   "Connection: keep-alive\r\nAccept-Encoding: identity;q=1,chunked;q=0.1,*;q=0\r\n"
+                   "Content-Type: application/json\r\nContent-Length: %zu\r\n\r\n",
+                   ep.path.c_str(), ep.host.c_str(), d.payload.size());
+      d.out.assign(head, n);
+      d.out += d.payload;
+      d.bodyLeft = 0;
+    }
+
+    int64_t timeoutMs = (type == REQ_S3) ? 60000
+                        : (d.failures > 0 ? HTTP_PROBE_TIMEOUT_MS : HTTP_TIMEOUT_MS);
+    // The flush budget is hard: no replay may run past what is left of it
+    if (type == REQ_BOOT_REPLAY || type == REQ_REPLAY) {
+      timeoutMs = std::min<int64_t>(timeoutMs, flushBudgetLeftNs(d) / 1000000);
+    }
+    schedule(i, TIMER_DEADLINE, d.startNs + timeoutMs * 1000000LL);
+
+    if (d.fd < 0) {
+      d.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+      if (d.fd < 0) {
+        requestDone(i, -1);
+        return;
+      }
+      // Abortive close: thousands of short-lived client sockets per slot
+      // would otherwise exhaust local ports in TIME_WAIT
+      linger lg = { 1, 0 };
+      setsockopt(d.fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+      int one = 1;
+      setsockopt(d.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      d.connectedTo = target;
+      open_++;
+      openMax_ = std::max(openMax_, open_);
+      SecondStats &s = second();
+      s.maxOpen = std::max(s.maxOpen, open_);
+
+      int rc = connect(d.fd, (const sockaddr *)&ep.addr, sizeof(ep.addr));
+      if (rc != 0 && errno != EINPROGRESS) {
+        requestDone(i, -1);  // HTTPC_ERROR_CONNECTION_REFUSED
+        return;
+      }
+      epoll_event ev = {};
+      ev.events = EPOLLOUT | EPOLLIN;
+      ev.data.u32 = i;
+      epoll_ctl(epollFd_, EPOLL_CTL_ADD, d.fd, &ev);
+    } else {
+      epoll_event ev = {};
+      ev.events = EPOLLOUT | EPOLLIN;
+      ev.data.u32 = i;
+      epoll_ctl(epollFd_, EPOLL_CTL_MOD, d.fd, &ev);
+    }
+  }
+
+  void closeSocket(Device &d) {
+    if (d.fd < 0) return;
+    close(d.fd);
+    d.fd = -1;
+    d.connectedTo = -1;
+    open_--;
+  }
+
+  void onSocket(uint32_t i, uint32_t events) {
+    Device &d = devices_[i];
+    if (d.fd < 0) return;
+    if (events & EPOLLERR) {
+      requestDone(i, -1);
+      return;
+    }
+    if (events & EPOLLOUT) {
+      if (!writeRequest(d)) {
+        requestDone(i, -1);
+        return;
+      }
+    }
+    if (events & (EPOLLIN | EPOLLHUP)) readResponse(i);
+  }
+
+  bool writeRequest(Device &d) {
+    while (d.outPos < d.out.size()) {
+      ssize_t n = write(d.fd, d.out.data() + d.outPos, d.out.size() - d.outPos);
+      if (n < 0) return errno == EAGAIN;
+      d.outPos += n;
+    }
+    while (d.bodyLeft > 0) {
+      size_t off = (d.logBytes - d.bodyLeft) % FILLER_SIZE;
+      size_t len = std::min<uint64_t>(d.bodyLeft, FILLER_SIZE - off);
+      ssize_t n = write(d.fd, filler_.data() + off, len);
+      if (n < 0) return errno == EAGAIN;
+      d.bodyLeft -= n;
+    }
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.u32 = &d - devices_.data();
+    epoll_ctl(epollFd_, EPOLL_CTL_MOD, d.fd, &ev);
+    return true;
+  }
+
+  void readResponse(uint32_t i) {
+    Device &d = devices_[i];
+    char buf[4096];
+    for (;;) {
+      ssize_t n = read(d.fd, buf, sizeof(buf));
+      if (n > 0) {
+        d.in.append(buf, n);
+        HttpHead h;
+        if (parseHead(d.in, h) && d.in.size() >= h.headerLen + h.contentLength) {
+          requestDone(i, h.status);
+          return;
+        }
+        continue;
+      }
+      if (n == 0 || errno != EAGAIN) requestDone(i, -1);  // closed before a full response
+      return;
+    }
+  }
+
+  // ----- report -----
+
+  static double percentile(std::vector<uint32_t> &v, double p) {
+    if (v.empty()) return 0;
+    size_t k = std::min(v.size() - 1, (size_t)(p / 100.0 * v.size()));
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k] / 1000.0;
+  }
+
+  void report() {
+    double activeSec = 0;
+    size_t peakSecond = 0;
+    for (size_t s = 0; s < seconds_.size(); s++) {
+      if (seconds_[s].started || seconds_[s].maxOpen) activeSec++;
+      if (seconds_[s].started > seconds_[peakSecond].started) peakSecond = s;
+    }
+
+    printf("Fleet: %u devices, %u cycles of %d min, jitter %.0f s, WiFi %u-%u ms, outage %.0f min%s\n",
+           opt_.devices, opt_.cycles, MEASURE_INTERVAL_MIN, opt_.jitterSec, opt_.wifiMinMs,
+           opt_.wifiMaxMs, opt_.outageMin, opt_.realtime ? "" : " (idle time skipped)");
+    printf("%-12s %9s %9s %8s %8s %10s %9s %9s %9s %9s %9s\n", "request", "count", "ok", "failed",
+           "timeout", "rate/s", "p50 ms", "p90 ms", "p99 ms", "p99.9 ms", "max ms");
+    for (int t = 0; t < REQ_TYPES; t++) {
+      TypeStats &s = stats_[t];
+      uint64_t count = s.ok + s.failed;
+      printf("%-12s %9llu %9llu %8llu %8llu %10.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n", REQUEST_NAMES[t],
+             (unsigned long long)count, (unsigned long long)s.ok, (unsigned long long)s.failed,
+             (unsigned long long)s.timeouts, activeSec > 0 ? count / activeSec : 0,
+             percentile(s.latencyUs, 50), percentile(s.latencyUs, 90), percentile(s.latencyUs, 99),
+             percentile(s.latencyUs, 99.9), percentile(s.latencyUs, 100));
+    }
+
+    if (!seconds_.empty()) {
+      char when[32];
+      time_t sim = simStart_ + peakSecond;
+      struct tm tm;
+      localtime_r(&sim, &tm);
+      strftime(when, sizeof(when), "%H:%M:%S", &tm);
+      printf("Thundering herd: peak %u requests started in one second (sim %s), "
+             "%u connections open at peak\n", seconds_[peakSecond].started, when, openMax_);
+    }
+    int64_t drainMax = 0;
+    for (int64_t ns : slotDrainNs_) drainMax = std::max(drainMax, ns);
+    printf("Slot drain: last device asleep %.1f s after its slot boundary (worst cycle); "
+           "deepest queue %zu entries\n", drainMax / 1e9, queueDepthMax_);
+    printf("Not sent: %llu wakes backed off by the breaker, %llu failed during the outage\n",
+           (unsigned long long)backedOff_, (unsigned long long)outageFailures_);
+
+    if (opt_.timeline) {
+      FILE *f = fopen(opt_.timeline, "w");
+      if (!f) {
+        perror("fleet_load: timeline");
+        return;
+      }
+      fprintf(f, "second,sim_time,started,completed,errors,open_connections\n");
+      for (size_t s = 0; s < seconds_.size(); s++) {
+        const SecondStats &st = seconds_[s];
+        if (!st.started && !st.completed && !st.errors && !st.maxOpen) continue;
+        fprintf(f, "%zu,%lld,%u,%u,%u,%u\n", s, (long long)(simStart_ + s), st.started, st.completed,
+                st.errors, st.maxOpen);
+      }
+      fclose(f);
+    }
+  }
+
+  RunOptions               opt_;
+  int                      epollFd_ = -1;
+  std::vector<Device>      devices_;
+  TimerHeap                timers_;
+  std::string              filler_;
+  int64_t                  simStart_ = 0, loopStart_ = 0, skipNs_ = 0;
+  uint32_t                 open_ = 0, openMax_ = 0, busy_ = 0, done_ = 0;
+  TypeStats                stats_[REQ_TYPES];
+  std::vector<SecondStats> seconds_;
+  std::vector<int64_t>     slotDrainNs_;
+  size_t                   queueDepthMax_ = 0;
+  uint64_t                 backedOff_ = 0, outageFailures_ = 0;
+};
+
+// ===================== Main =====================
+
+static StandInServer *signalServer = nullptr;
+
+static void usage() {
+  fprintf(stderr,
+          "usage: fleet_load serve [--port P] [--latency-ms L] [--capacity RPS] [--fail-rate F]\n"
+          "       fleet_load run [--local] [--api HOST:PORT[/PATH]] [--s3 HOST:PORT] [--devices N]\n"
+          "                      [--cycles C] [--jitter-sec J] [--wifi-ms A-B] [--lead-sec L] [--outage-min M]\n"
+          "                      [--log-kb K] [--log-growth B] [--no-s3] [--batch N] [--realtime]\n"
+          "                      [--timeline FILE] [--seed S] [server options with --local]\n");
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    usage();
+    return 2;
+  }
+  signal(SIGPIPE, SIG_IGN);
+  raiseFdLimit();
+  payloadInit();
+
+  std::string mode = argv[1];
+  ServerOptions so;
+  RunOptions ro;
+  bool s3Given = false;
+
+  for (int i = 2; i < argc; i++) {
+    std::string a = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (a == "--port" && hasValue) so.port = atoi(argv[++i]);
+    else if (a == "--latency-ms" && hasValue) so.latencyMs = atof(argv[++i]);
+    else if (a == "--capacity" && hasValue) so.capacity = atof(argv[++i]);
+    else if (a == "--fail-rate" && hasValue) so.failRate = atof(argv[++i]);
+    else if (a == "--local") ro.local = true;
+    else if (a == "--api" && hasValue) {
+      if (!parseEndpoint(argv[++i], ro.api)) {
+        fprintf(stderr, "fleet_load: cannot resolve %s\n", argv[i]);
+        return 2;
+      }
+    } else if (a == "--s3" && hasValue) {
+      if (!parseEndpoint(argv[++i], ro.s3)) {
+        fprintf(stderr, "fleet_load: cannot resolve %s\n", argv[i]);
+        return 2;
+      }
+      s3Given = true;
+    } else if (a == "--devices" && hasValue) ro.devices = std::max(1, atoi(argv[++i]));
+    else if (a == "--cycles" && hasValue) ro.cycles = std::max(1, atoi(argv[++i]));
+    else if (a == "--jitter-sec" && hasValue) ro.jitterSec = atof(argv[++i]);
+    else if (a == "--wifi-ms" && hasValue) {
+      const char *v = argv[++i];
+      ro.wifiMinMs = atoi(v);
+      const char *dash = strchr(v, '-');
+      ro.wifiMaxMs = dash ? atoi(dash + 1) : ro.wifiMinMs;
+      if (ro.wifiMaxMs < ro.wifiMinMs) std::swap(ro.wifiMinMs, ro.wifiMaxMs);
+    } else if (a == "--lead-sec" && hasValue) ro.leadSec = atoi(argv[++i]);
+    else if (a == "--outage-min" && hasValue) ro.outageMin = atof(argv[++i]);
+    else if (a == "--log-kb" && hasValue) ro.logBytes = strtoull(argv[++i], nullptr, 10) * 1024;
+    else if (a == "--log-growth" && hasValue) ro.logGrowth = strtoull(argv[++i], nullptr, 10);
+    else if (a == "--no-s3") ro.uploadLogs = false;
+    else if (a == "--batch" && hasValue) ro.batch = std::max(1, atoi(argv[++i]));
+    else if (a == "--realtime") ro.realtime = true;
+    else if (a == "--timeline" && hasValue) ro.timeline = argv[++i];
+    else if (a == "--seed" && hasValue) ro.seed = strtoull(argv[++i], nullptr, 10);
+    else {
+      usage();
+      return 2;
+    }
+  }
+
+  if (mode == "serve") {
+    StandInServer server(so);
+    if (!server.listenOn()) return 1;
+    signalServer = &server;
+    signal(SIGINT, [](int) { signalServer->stop(); });
+    signal(SIGTERM, [](int) { signalServer->stop(); });
+    fprintf(stderr, "[serve] listening on 127.0.0.1:%u\n", server.port());
+    server.reportPeriodically();
+    server.run();
+    return 0;
+  }
+
+  if (mode != "run") {
+    usage();
+    return 2;
+  }
+
+  StandInServer *local = nullptr;
+  std::thread serverThread;
+  if (ro.local) {
+    so.port = 0;
+    local = new StandInServer(so);
+    if (!local->listenOn()) return 1;
+    char ep[64];
+    snprintf(ep, sizeof(ep), "127.0.0.1:%u/api", local->port());
+    parseEndpoint(ep, ro.api);
+    serverThread = std::thread([local]() { local->run(); });
+  } else if (ro.api.addr.sin_family == 0) {
+    parseEndpoint("127.0.0.1:8080/api", ro.api);
+  }
+  // The log mirror is a separate host in the field; by default it is the
+  // same address here, but still a separate connection per device
+  if (!s3Given) ro.s3 = ro.api;
+
+  Fleet fleet(ro);
+  int rc = fleet.run();
+
+  if (local) {
+    local->stop();
+    serverThread.join();
+    const ServerStats &st = local->stats();
+    printf("Stand-in: %llu POST, %llu PUT, %llu answered 503, %llu connections, %.1f MB received\n",
+           (unsigned long long)st.posts, (unsigned long long)st.puts, (unsigned long long)st.failed,
+           (unsigned long long)st.connections, st.bodyBytes / 1e6);
+    delete local;
+  }
+  return rc;
+}
@@ -0,0 +1,34 @@
+#include "payload.h"
+#include "json_utils.h"
+#include "air_quality.h"
+#include "rtc_utils.h"
+#include <functional>
+#include <string>
+
+static uint64_t mix(uint64_t x) {
+  x ^= x >> 33; x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33; x *= 0xc4ceb9fe1a85ec53ULL;
+  return x ^ (x >> 33);
+}
+
+void payloadInit() { applyTimezone(); }
+
+size_t buildPayload(char *out, size_t size, const char *deviceId, time_t t) {
+  uint64_t h = mix((uint64_t)t * 0x9E3779B97F4A7C15ULL ^ std::hash<std::string>()(deviceId));
+  auto value = [&h](float lo, float hi) {
+    h = mix(h);
+    return lo + (hi - lo) * (h >> 40) / 16777216.0f;
+  };
+
+  MeasurementData data;
+#define FLEET_FIELD(field, jsonKey, logKey, units, source, type, precision) \
+  data.field = (type)value(1, CHANNEL_##field == CHANNEL_pressure ? 1050 : 900);
+  UFAR_CHANNELS(FLEET_FIELD)
+#undef FLEET_FIELD
+
+  // analyzeAirQuality() keeps per-device history; the AQI of the reading
+  // alone is the same size on the wire
+  AirQualityResult aq = {};
+  aq.aqi = max(aqiFromPm25(data.pm25), aqiFromPm10(data.pm10));
+  return prepareJSON(out, size, deviceId, t, data, &aq);
+}
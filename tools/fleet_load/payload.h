@@ -0,0 +1,18 @@
+#pragma once
+// The payloads fleet_load sends, built by the firmware itself: payload.cpp
+// calls prepareJSON() from json_utils.cpp, linked from the host test library
+// (tests/Makefile). Kept apart from fleet_load.cpp, which doesn't see the
+// Arduino shim's headers.
+#include <stddef.h>
+#include <time.h>
+
+// Sets the device timezone (applyTimezone()), so "time" reads as on the device
+void payloadInit();
+
+// The reading of deviceId for slot t, as sendData() and queueFailedData()
+// serialize it. Deterministic per (device, time), so a queued reading is
+// rebuilt identically on replay. Returns the length, or 0 if it didn't fit.
+size_t buildPayload(char *out, size_t size, const char *deviceId, time_t t);
+
+// json_utils.h: the backend refused the payload itself, so it is dropped
+bool payloadRejected(int status);
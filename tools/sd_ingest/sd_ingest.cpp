@@ -0,0 +1,896 @@
+// sd_ingest - bulk ingester for SD cards recovered from ufar_project devices
+//
+// Reads the combined log files (device_<id>_log.txt, written by logToSD() and
+// logDataToFile()) and the offline queue (pending_queue.txt, JSON lines from
+// queueFailedData()), keeps the DATA rows and queue entries, merges entries
+// that describe the same (device, timestamp) and writes one row per reading
+// as CSV or as a columnar binary file for bulk import.
+//
+// Host tool, not part of the sketch build. Column names, log keys and JSON
+// keys come from channels.h and numbers are printed with the firmware's own
+// formatFixed(), so the tool follows the registry. Build with tools/Makefile:
+//
+//   make -C tools sd_ingest
+//
+// Usage:
+//   sd_ingest [-j N] [--csv FILE | --columnar FILE] PATH...
+//       PATH is a log/queue file or a directory (e.g. a mounted card), which
+//       is searched for *_log.txt and pending_queue*.txt. Default: CSV to
+//       stdout, as is FILE "-".
+//   sd_ingest [-j N] --bench PATH...
+//       Parse and merge only, report throughput in GB/s.
+//   sd_ingest --generate DIR [--devices N] [--years Y] [--seed S]
+//       Write a synthetic archive in the firmware's formats: one card_<id>/
+//       directory per device holding its log file and pending queue.
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "channels.h"
+
+namespace fs = std::filesystem;
+
+// ===================== Columns =====================
+// Every channel the firmware can log (including the optional SPS30 number
+// concentrations), in DATA row order so the parser's expected-key cursor hits
+// on the first compare, followed by the fields only present in the queue.
+
+#define INGEST_LOG_CHANNELS(X) \
+  CH_TEMPERATURE(X) CH_HUMIDITY(X) CH_PRESSURE(X) \
+  CH_CO2(X) CH_VOC(X) \
+  CH_PM1(X) CH_PM25(X) CH_PM10(X) \
+  CH_NC05(X) CH_NC1(X) CH_NC25(X) CH_NC4(X) CH_NC10(X)
+
+struct Column {
+  const char *name;
+  const char *logKey;   // nullptr: not in DATA rows
+  const char *jsonKey;
+  uint8_t     precision;
+};
+
+static const Column COLUMNS[] = {
+#define INGEST_COLUMN(field, jsonKey, logKey, units, source, type, precision) \
+  { #field, logKey, jsonKey, precision },
+  INGEST_LOG_CHANNELS(INGEST_COLUMN)
+#undef INGEST_COLUMN
+  { "aqi", nullptr, "aqi", 0 },
+};
+
+#define NUM_COLUMNS (sizeof(COLUMNS) / sizeof(COLUMNS[0]))
+
+// Event names as written by prepareJSON() (airQualityEventName()); bit i = entry i
+static const char *EVENT_NAMES[] = {
+  "co2_high", "co2_normal", "pm2_5_high", "pm2_5_normal", "co2_rise", "pm2_5_rise"
+};
+
+enum RowSource : uint8_t { FROM_LOG = 0, FROM_QUEUE = 1 };
+
+struct Row {
+  int64_t  time;      // device-local time as seconds since 1970-01-01 00:00:00
+  uint32_t device;
+  uint8_t  source;
+  uint8_t  events;
+  float    value[NUM_COLUMNS];
+};
+
+struct Stats {
+  uint64_t bytes = 0;
+  uint64_t dataRows = 0;
+  uint64_t queueRows = 0;
+  uint64_t logLines = 0;
+  uint64_t badLines = 0;
+  uint64_t merged = 0;
+};
+
+// ===================== Devices =====================
+
+static std::mutex deviceMutex;
+static std::unordered_map<std::string, uint32_t> deviceIndex;
+static std::vector<std::string> deviceNames;
+
+static uint32_t internDevice(const char *name, size_t len) {
+  std::lock_guard<std::mutex> lock(deviceMutex);
+  std::string key(name, len);
+  auto it = deviceIndex.find(key);
+  if (it != deviceIndex.end()) return it->second;
+  uint32_t id = deviceNames.size();
+  deviceNames.push_back(key);
+  deviceIndex.emplace(key, id);
+  return id;
+}
+
+// "device_<id>_log.txt" -> "<id>". Queue files carry the device per line, so
+// only files that may hold DATA rows need a device from their name.
+static uint32_t deviceFromFilename(const fs::path &path) {
+  std::string name = path.filename().string();
+  if (name.compare(0, 13, "pending_queue") == 0) return UINT32_MAX;
+  const char prefix[] = "device_", suffix[] = "_log.txt";
+  size_t pl = sizeof(prefix) - 1, sl = sizeof(suffix) - 1;
+  if (name.size() > pl + sl && name.compare(0, pl, prefix) == 0 &&
+      name.compare(name.size() - sl, sl, suffix) == 0) {
+    return internDevice(name.data() + pl, name.size() - pl - sl);
+  }
+  std::string stem = path.stem().string();
+  return internDevice(stem.data(), stem.size());
+}
+
+// ===================== Time =====================
+// Timestamps are timeToStr() output in the device's local time zone; they are
+// kept as naive civil time (no zone conversion) so they round-trip exactly.
+
+static int64_t daysFromCivil(int y, unsigned m, unsigned d) {
+  y -= m <= 2;
+  const int64_t era = (y >= 0 ? y : y - 399) / 400;
+  const unsigned yoe = (unsigned)(y - era * 400);
+  const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + (int64_t)doe - 719468;
+}
+
+static void civilFromDays(int64_t z, int &y, unsigned &m, unsigned &d) {
+  z += 719468;
+  const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+  const unsigned doe = (unsigned)(z - era * 146097);
+  const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  const unsigned mp = (5 * doy + 2) / 153;
+  d = doy - (153 * mp + 2) / 5 + 1;
+  m = mp < 10 ? mp + 3 : mp - 9;
+  y = (int)(yoe + era * 400) + (m <= 2);
+}
+
+#define TIME_LEN 19  // "YYYY-MM-DD HH:MM:SS"
+
+static inline int digits2(const char *s) { return (s[0] - '0') * 10 + (s[1] - '0'); }
+
+// Per-thread cache: consecutive rows almost always share the date
+struct TimeParser {
+  char    lastDate[10] = {};
+  int64_t lastDays = 0;
+
+  bool parse(const char *s, int64_t &t) {
+    static const char shape[] = "dddd-dd-dd dd:dd:dd";
+    for (int i = 0; i < TIME_LEN; i++) {
+      bool digit = (unsigned)(s[i] - '0') <= 9;
+      if (shape[i] == 'd' ? !digit : s[i] != shape[i]) return false;
+    }
+    if (memcmp(s, lastDate, 10) != 0) {
+      int y = digits2(s) * 100 + digits2(s + 2);
+      lastDays = daysFromCivil(y, digits2(s + 5), digits2(s + 8));
+      memcpy(lastDate, s, 10);
+    }
+    t = lastDays * 86400 + digits2(s + 11) * 3600 + digits2(s + 14) * 60 + digits2(s + 17);
+    return true;
+  }
+};
+
+static void formatTime(int64_t t, char *out) {
+  int64_t days = t / 86400, sec = t % 86400;
+  if (sec < 0) { sec += 86400; days--; }
+  int y; unsigned m, d;
+  civilFromDays(days, y, m, d);
+  char buf[48];
+  snprintf(buf, sizeof(buf), "%04d-%02u-%02u %02d:%02d:%02d", y, m, d,
+           (int)(sec / 3600), (int)(sec / 60 % 60), (int)(sec % 60));
+  memcpy(out, buf, TIME_LEN);
+  out[TIME_LEN] = '\0';
+}
+
+// ===================== Field parsing =====================
+
+// Exact in double, so mantissa / POW10[n] is correctly rounded
+static const double POW10[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+  1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18
+};
+
+static inline bool isDelimiter(char c) {
+  return c == ' ' || c == ',' || c == '}' || c == ']' || c == '\n' || c == '\r';
+}
+
+// Parses the number at p (plain decimal fast path; nan/inf/null and exponent
+// forms via strtod) and returns a pointer to the delimiter that ends it
+static const char *parseNumber(const char *p, const char *end, float &value) {
+  const char *start = p;
+  bool negative = (p < end && *p == '-');
+  if (negative) p++;
+
+  uint64_t mantissa = 0;
+  int digits = 0, fraction = 0;
+  while (p < end && (unsigned)(*p - '0') <= 9) {
+    mantissa = mantissa * 10 + (*p++ - '0');
+    digits++;
+  }
+  if (p < end && *p == '.') {
+    p++;
+    while (p < end && (unsigned)(*p - '0') <= 9) {
+      mantissa = mantissa * 10 + (*p++ - '0');
+      digits++;
+      fraction++;
+    }
+  }
+
+  if (digits > 0 && digits <= 18 && (p == end || isDelimiter(*p))) {
+    double v = (double)mantissa / POW10[fraction];
+    value = (float)(negative ? -v : v);
+    return p;
+  }
+
+  // Slow path: "nan", "inf", "null" (ArduinoJson's NaN), exponents, long mantissas
+  p = start;
+  while (p < end && !isDelimiter(*p)) p++;
+  char buf[48];
+  size_t len = std::min((size_t)(p - start), sizeof(buf) - 1);
+  memcpy(buf, start, len);
+  buf[len] = '\0';
+  if (len == 0 || strcmp(buf, "null") == 0) {
+    value = NAN;
+  } else {
+    char *parsedEnd;
+    value = strtof(buf, &parsedEnd);
+    if (parsedEnd == buf) value = NAN;
+  }
+  return p;
+}
+
+static int findLogColumn(const char *key, size_t len, int expected) {
+  if (expected < (int)NUM_COLUMNS) {
+    const char *k = COLUMNS[expected].logKey;
+    if (k && strncmp(k, key, len) == 0 && k[len] == '\0') return expected;
+  }
+  for (size_t i = 0; i < NUM_COLUMNS; i++) {
+    const char *k = COLUMNS[i].logKey;
+    if (k && strncmp(k, key, len) == 0 && k[len] == '\0') return i;
+  }
+  return -1;
+}
+
+static int findJsonColumn(const char *key, size_t len, int expected) {
+  if (expected < (int)NUM_COLUMNS) {
+    const char *k = COLUMNS[expected].jsonKey;
+    if (strncmp(k, key, len) == 0 && k[len] == '\0') return expected;
+  }
+  for (size_t i = 0; i < NUM_COLUMNS; i++) {
+    const char *k = COLUMNS[i].jsonKey;
+    if (strncmp(k, key, len) == 0 && k[len] == '\0') return i;
+  }
+  return -1;
+}
+
+static void clearRow(Row &row) {
+  for (size_t i = 0; i < NUM_COLUMNS; i++) row.value[i] = NAN;
+  row.events = 0;
+}
+
+// ===================== Line parsers =====================
+
+static const char DATA_TAG[] = " | DATA |";
+static const char LOG_TAG[]  = " | LOG  |";
+#define TAG_LEN (sizeof(DATA_TAG) - 1)
+
+// "<time> | DATA | temp=23.45 hum=40.10 ... pm10=12.00"
+static bool parseDataRow(const char *line, const char *end, TimeParser &tp, Row &row) {
+  if (!tp.parse(line, row.time)) return false;
+  clearRow(row);
+
+  const char *p = line + TIME_LEN + TAG_LEN;
+  int expected = 0;
+  while (p < end) {
+    if (*p == ' ') { p++; continue; }
+    const char *eq = (const char *)memchr(p, '=', end - p);
+    if (!eq) break;
+    int col = findLogColumn(p, eq - p, expected);
+    float v;
+    p = parseNumber(eq + 1, end, v);
+    if (col >= 0) {
+      row.value[col] = v;
+      expected = col + 1;
+    }
+    while (p < end && *p != ' ') p++;
+  }
+  return true;
+}
+
+// Reads a JSON string starting at the opening quote; returns past the closing quote
+static const char *readString(const char *p, const char *end, const char *&s, size_t &len) {
+  if (p >= end || *p != '"') return nullptr;
+  s = ++p;
+  while (p < end && *p != '"') p += (*p == '\\') ? 2 : 1;
+  if (p >= end) return nullptr;
+  len = p - s;
+  return p + 1;
+}
+
+static inline const char *skipSpace(const char *p, const char *end) {
+  while (p < end && (*p == ' ' || *p == '\t' || *p == ',')) p++;
+  return p;
+}
+
+// {"device":"device<id>","data":[{"time":"...","temperature":23.45,...,"aqi":53,"events":[...]}]}
+// Only the flat shape prepareJSON() produces is supported.
+static bool parseQueueLine(const char *line, const char *end, TimeParser &tp,
+                           uint32_t &lastDevice, std::string &lastDeviceName, Row &row) {
+  static const char deviceKey[] = "\"device\":\"";
+  static const char dataKey[] = "\"data\":[{";
+
+  const char *p = (const char *)memmem(line, end - line, deviceKey, sizeof(deviceKey) - 1);
+  if (!p) return false;
+  const char *name;
+  size_t nameLen;
+  p = readString(p + sizeof(deviceKey) - 2, end, name, nameLen);
+  if (!p) return false;
+  // prepareJSON() writes "device" + DEVICE_ID; the log file name has the bare ID
+  if (nameLen > 6 && memcmp(name, "device", 6) == 0) {
+    name += 6;
+    nameLen -= 6;
+  }
+  if (lastDeviceName.size() != nameLen || memcmp(lastDeviceName.data(), name, nameLen) != 0) {
+    lastDevice = internDevice(name, nameLen);
+    lastDeviceName.assign(name, nameLen);
+  }
+  row.device = lastDevice;
+
+  p = (const char *)memmem(p, end - p, dataKey, sizeof(dataKey) - 1);
+  if (!p) return false;
+  p += sizeof(dataKey) - 1;
+
+  clearRow(row);
+  bool haveTime = false;
+  int expected = 0;
+  for (;;) {
+    p = skipSpace(p, end);
+    if (p >= end || *p == '}') break;
+
+    const char *key;
+    size_t keyLen;
+    p = readString(p, end, key, keyLen);
+    if (!p || p >= end || *p != ':') return false;
+    p++;
+
+    if (p < end && *p == '"') {
+      const char *s;
+      size_t len;
+      p = readString(p, end, s, len);
+      if (!p) return false;
+      if (keyLen == 4 && memcmp(key, "time", 4) == 0 && len == TIME_LEN) {
+        haveTime = tp.parse(s, row.time);
+      }
+    } else if (p < end && *p == '[') {
+      bool events = (keyLen == 6 && memcmp(key, "events", 6) == 0);
+      p++;
+      while (p < end && *p != ']') {
+        p = skipSpace(p, end);
+        if (p < end && *p == '"') {
+          const char *s;
+          size_t len;
+          p = readString(p, end, s, len);
+          if (!p) return false;
+          for (size_t b = 0; events && b < sizeof(EVENT_NAMES) / sizeof(EVENT_NAMES[0]); b++) {
+            if (strncmp(EVENT_NAMES[b], s, len) == 0 && EVENT_NAMES[b][len] == '\0') {
+              row.events |= 1 << b;
+            }
+          }
+        } else if (p < end && *p != ']') {
+          p++;
+        }
+      }
+      if (p < end) p++;
+    } else {
+      int col = findJsonColumn(key, keyLen, expected);
+      float v;
+      p = parseNumber(p, end, v);
+      if (col >= 0) {
+        row.value[col] = v;
+        expected = col + 1;
+      }
+    }
+  }
+  return haveTime;
+}
+
+// ===================== Parallel scan =====================
+
+struct MappedFile {
+  fs::path    path;
+  const char *data = nullptr;
+  size_t      size = 0;
+  uint32_t    device = 0;
+};
+
+struct Chunk {
+  const MappedFile *file;
+  size_t begin, end;
+};
+
+#define CHUNK_SIZE (8u << 20)
+
+static bool mapFile(MappedFile &f) {
+  int fd = open(f.path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+  f.size = st.st_size;
+  if (f.size > 0) {
+    void *m = mmap(nullptr, f.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (m == MAP_FAILED) {
+      close(fd);
+      return false;
+    }
+    madvise(m, f.size, MADV_SEQUENTIAL | MADV_WILLNEED);
+    f.data = (const char *)m;
+  }
+  close(fd);
+  return true;
+}
+
+// A line belongs to the chunk holding its first byte. Line splitting uses
+// memchr, which glibc implements with SSE2/AVX2 (NEON on arm64); the line
+// type sits at a fixed offset after the timestamp, so no other scanning is needed.
+static void scanChunk(const Chunk &c, std::vector<Row> &rows, Stats &st) {
+  const char *base = c.file->data;
+  const char *fileEnd = base + c.file->size;
+  const char *p = base + c.begin;
+  const char *limit = base + c.end;
+
+  if (c.begin > 0 && p[-1] != '\n') {
+    p = (const char *)memchr(p, '\n', fileEnd - p);
+    p = p ? p + 1 : fileEnd;
+  }
+
+  TimeParser tp;
+  uint32_t lastDevice = 0;
+  std::string lastDeviceName;
+  Row row;
+
+  while (p < limit) {
+    const char *nl = (const char *)memchr(p, '\n', fileEnd - p);
+    const char *end = nl ? nl : fileEnd;
+    const char *lineEnd = (end > p && end[-1] == '\r') ? end - 1 : end;
+    size_t len = lineEnd - p;
+
+    if (len >= TIME_LEN + TAG_LEN && memcmp(p + TIME_LEN, DATA_TAG, TAG_LEN) == 0) {
+      if (c.file->device != UINT32_MAX && parseDataRow(p, lineEnd, tp, row)) {
+        row.device = c.file->device;
+        row.source = FROM_LOG;
+        rows.push_back(row);
+        st.dataRows++;
+      } else {
+        st.badLines++;
+      }
+    } else if (len > 0 && *p == '{') {
+      if (parseQueueLine(p, lineEnd, tp, lastDevice, lastDeviceName, row)) {
+        row.source = FROM_QUEUE;
+        rows.push_back(row);
+        st.queueRows++;
+      } else {
+        st.badLines++;
+      }
+    } else if (len >= TIME_LEN + TAG_LEN && memcmp(p + TIME_LEN, LOG_TAG, TAG_LEN) == 0) {
+      st.logLines++;
+    } else if (len > 0) {
+      st.badLines++;
+    }
+    p = end + 1;
+  }
+}
+
+static bool rowOrder(const Row &a, const Row &b) {
+  if (a.device != b.device) return a.device < b.device;
+  if (a.time != b.time) return a.time < b.time;
+  return a.source < b.source;
+}
+
+// One row per (device, time). The DATA row wins; a queue entry for the same
+// reading (the send failed, so it is in both files) only fills in what the
+// log does not have (aqi, events). Repeated DATA rows collapse the same way.
+static void mergeDuplicates(std::vector<Row> &rows, Stats &st) {
+  std::sort(rows.begin(), rows.end(), rowOrder);
+  size_t out = 0;
+  for (size_t i = 0; i < rows.size(); i++) {
+    if (out > 0 && rows[out - 1].device == rows[i].device && rows[out - 1].time == rows[i].time) {
+      Row &keep = rows[out - 1];
+      for (size_t c = 0; c < NUM_COLUMNS; c++) {
+        if (std::isnan(keep.value[c])) keep.value[c] = rows[i].value[c];
+      }
+      keep.events |= rows[i].events;
+      st.merged++;
+      continue;
+    }
+    rows[out++] = rows[i];
+  }
+  rows.resize(out);
+}
+
+static std::vector<Row> ingest(std::vector<MappedFile> &files, unsigned threads, Stats &total) {
+  std::vector<Chunk> chunks;
+  for (const MappedFile &f : files) {
+    total.bytes += f.size;
+    for (size_t off = 0; off < f.size; off += CHUNK_SIZE) {
+      chunks.push_back({ &f, off, std::min(f.size, off + CHUNK_SIZE) });
+    }
+  }
+
+  std::atomic<size_t> next(0);
+  std::vector<std::vector<Row>> perThread(threads);
+  std::vector<Stats> stats(threads);
+  std::vector<std::thread> pool;
+  for (unsigned t = 0; t < threads; t++) {
+    pool.emplace_back([&, t]() {
+      for (size_t i; (i = next.fetch_add(1)) < chunks.size();) {
+        scanChunk(chunks[i], perThread[t], stats[t]);
+      }
+    });
+  }
+  for (std::thread &th : pool) th.join();
+
+  size_t count = 0;
+  for (unsigned t = 0; t < threads; t++) {
+    count += perThread[t].size();
+    total.dataRows += stats[t].dataRows;
+    total.queueRows += stats[t].queueRows;
+    total.logLines += stats[t].logLines;
+    total.badLines += stats[t].badLines;
+  }
+
+  std::vector<Row> rows;
+  rows.reserve(count);
+  for (std::vector<Row> &v : perThread) {
+    rows.insert(rows.end(), v.begin(), v.end());
+    std::vector<Row>().swap(v);
+  }
+  mergeDuplicates(rows, total);
+  return rows;
+}
+
+// ===================== Output =====================
+
+static void formatCsvRange(const std::vector<Row> &rows, size_t begin, size_t end, std::string &out) {
+  char num[NUM_FORMAT_MAX], time[TIME_LEN + 1];
+  out.reserve((end - begin) * 128);
+  for (size_t i = begin; i < end; i++) {
+    const Row &r = rows[i];
+    out += deviceNames[r.device];
+    out += ',';
+    formatTime(r.time, time);
+    out.append(time, TIME_LEN);
+    for (size_t c = 0; c < NUM_COLUMNS; c++) {
+      out += ',';
+      if (!std::isnan(r.value[c])) out.append(num, formatFixed(num, r.value[c], COLUMNS[c].precision));
+    }
+    out += ',';
+    out.append(num, formatInt(num, r.events));
+    out += '\n';
+  }
+}
+
+static bool writeCsv(const std::vector<Row> &rows, FILE *f, unsigned threads) {
+  std::string header = "device,time";
+  for (size_t c = 0; c < NUM_COLUMNS; c++) {
+    header += ',';
+    header += COLUMNS[c].name;
+  }
+  header += ",events\n";
+  fwrite(header.data(), 1, header.size(), f);
+
+  // Format slices in parallel, write them in order
+  const size_t slice = 1 << 16;
+  for (size_t base = 0; base < rows.size(); base += slice * threads) {
+    std::vector<std::string> parts(threads);
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < threads; t++) {
+      size_t b = std::min(rows.size(), base + t * slice);
+      size_t e = std::min(rows.size(), b + slice);
+      pool.emplace_back([&, t, b, e]() { formatCsvRange(rows, b, e, parts[t]); });
+    }
+    for (std::thread &th : pool) th.join();
+    for (const std::string &s : parts) {
+      if (fwrite(s.data(), 1, s.size(), f) != s.size()) return false;
+    }
+  }
+  return fflush(f) == 0;
+}
+
+// Columnar file (little-endian, all arrays rows long):
+//   "UFARCOL1", u32 rows, u32 devices, devices x (u16 len, bytes),
+//   u32 columns, columns x (u8 type, u8 len, name)  type: 0=u32 1=i64 2=f32 3=u8
+//   then one array per column in header order: device, time, channels..., events
+static bool writeColumnar(const std::vector<Row> &rows, FILE *f) {
+  auto put = [f](const void *p, size_t n) { return fwrite(p, 1, n, f) == n; };
+  auto putColumn = [&](uint8_t type, const char *name) {
+    uint8_t len = strlen(name);
+    return put(&type, 1) && put(&len, 1) && put(name, len);
+  };
+
+  uint32_t n = rows.size(), devices = deviceNames.size(), columns = NUM_COLUMNS + 3;
+  bool ok = put("UFARCOL1", 8) && put(&n, 4) && put(&devices, 4);
+  for (const std::string &d : deviceNames) {
+    uint16_t len = d.size();
+    ok = ok && put(&len, 2) && put(d.data(), len);
+  }
+  ok = ok && put(&columns, 4) && putColumn(0, "device") && putColumn(1, "time");
+  for (size_t c = 0; c < NUM_COLUMNS; c++) ok = ok && putColumn(2, COLUMNS[c].name);
+  ok = ok && putColumn(3, "events");
+
+  std::vector<char> buf;
+  auto putArray = [&](size_t width, auto get) {
+    buf.resize(rows.size() * width);
+    for (size_t i = 0; i < rows.size(); i++) get(rows[i], &buf[i * width]);
+    return put(buf.data(), buf.size());
+  };
+  ok = ok && putArray(4, [](const Row &r, char *o) { memcpy(o, &r.device, 4); });
+  ok = ok && putArray(8, [](const Row &r, char *o) { memcpy(o, &r.time, 8); });
+  for (size_t c = 0; c < NUM_COLUMNS; c++) {
+    ok = ok && putArray(4, [c](const Row &r, char *o) { memcpy(o, &r.value[c], 4); });
+  }
+  ok = ok && putArray(1, [](const Row &r, char *o) { *o = r.events; });
+  return ok && fflush(f) == 0;
+}
+
+// ===================== Synthetic archive =====================
+// Lines are assembled the way the firmware writes them: timeToStr() stamps,
+// the LOG/DATA tags, DATA keys in UFAR_LOG_CHANNELS order and formatFixed()
+// values. Queue lines follow prepareJSON()'s key order; ArduinoJson prints
+// floats in shortest form, here they use two decimals, which parses the same.
+
+struct Walk {
+  uint64_t state;
+  uint32_t next() {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return state >> 33;
+  }
+  float uniform() { return next() / 2147483648.0f; }
+  float step(float v, float lo, float hi, float size) {
+    v += (uniform() - 0.5f) * size;
+    return std::min(hi, std::max(lo, v));
+  }
+};
+
+// Channel values of one synthetic reading (MeasurementData lives on the Arduino side)
+struct Reading {
+#define GEN_READING_FIELD(field, jsonKey, logKey, units, source, type, precision) type field;
+  UFAR_CHANNELS(GEN_READING_FIELD)
+#undef GEN_READING_FIELD
+};
+
+// Boot/measure/send chatter between DATA rows; %u is the boot count
+static const char *CYCLE_LOG[] = {
+  "[SYSTEM] ========== BOOT ==========",
+  "[SD] SD card initialized",
+  "[SYSTEM] Boot count: %u",
+  "[WIFI] Connecting to WiFi...",
+  "[WIFI] Connected",
+  "[SCHED] Wake latency: mean=9.8s sd=0.6s, drift=+0.0031, lead=12s",
+  "[MEASURE] ========== Starting Measurement Cycle ==========",
+  "[MEASURE] Warming up sensors for 30 seconds...",
+  "[MEASURE] Sample 1/10 collected",
+  "[MEASURE] ========== Measurement Cycle Complete ==========",
+  "[SEND] ========== Starting Data Transmission ==========",
+  "[JSON] Payload prepared (231 bytes)",
+  "[HTTP] Response code: 200",
+  "[SEND] ========== Transmission Complete ==========",
+  "[SLEEP] Entering deep sleep for 254 seconds",
+};
+
+static bool generateCard(const fs::path &dir, const std::string &id, int64_t start,
+                         int64_t cycles, uint64_t seed) {
+  fs::create_directories(dir);
+  FILE *log = fopen((dir / ("device_" + id + "_log.txt")).c_str(), "wb");
+  FILE *queue = fopen((dir / "pending_queue.txt").c_str(), "wb");
+  if (!log || !queue) return false;
+
+  Walk w{ seed };
+  Reading m = {};
+  m.temperature = 18; m.humidity = 45; m.pressure = 1005;
+  m.pm1 = 4; m.pm25 = 8; m.pm10 = 12; m.co2 = 650; m.voc = 100;
+
+  std::string out;
+  char line[160], time[TIME_LEN + 1], num[NUM_FORMAT_MAX];
+  for (int64_t i = 0; i < cycles; i++) {
+    int64_t t = start + i * MEASURE_INTERVAL_MIN * 60;
+    formatTime(t, time);
+
+    m.temperature = w.step(m.temperature, -15, 40, 0.4f);
+    m.humidity = w.step(m.humidity, 5, 100, 1.0f);
+    m.pressure = w.step(m.pressure, 950, 1050, 0.3f);
+    m.pm1 = w.step(m.pm1, 0, 300, 1.0f);
+    m.pm25 = w.step(m.pm25, m.pm1, 400, 1.5f);
+    m.pm10 = w.step(m.pm10, m.pm25, 600, 2.0f);
+    m.co2 = w.step(m.co2, 400, 5000, 25);
+    m.voc = (int32_t)w.step(m.voc, 1, 500, 10);
+
+    // Boot/measure/send chatter, stamped a few seconds before the reading
+    for (size_t l = 0; l < sizeof(CYCLE_LOG) / sizeof(CYCLE_LOG[0]); l++) {
+      char stamp[TIME_LEN + 1];
+      formatTime(t - 40 + (int64_t)l * 2, stamp);
+      int n = snprintf(line, sizeof(line), "%s | LOG  | ", stamp);
+      n += snprintf(line + n, sizeof(line) - n, CYCLE_LOG[l], (unsigned)(i + 1));
+      out.append(line, n);
+      out += '\n';
+    }
+
+    // DATA row exactly as formatDataRow() writes it
+    out.append(time, TIME_LEN);
+    out += DATA_TAG;
+#define GEN_LOG_FIELD(field, jsonKey, logKey, units, source, type, precision) \
+    out += " " logKey "=";                                                   \
+    out.append(num, UFAR_FORMAT_##type(num, m.field, precision));
+    UFAR_LOG_CHANNELS(GEN_LOG_FIELD)
+#undef GEN_LOG_FIELD
+    out += '\n';
+
+    // ~2% of sends fail and stay in the queue
+    if (w.next() % 50 == 0) {
+      std::string q = "{\"device\":\"device" + id + "\",\"data\":[{\"time\":\"";
+      q.append(time, TIME_LEN);
+      q += '"';
+#define GEN_JSON_FIELD(field, jsonKey, logKey, units, source, type, precision) \
+      q += ",\"" jsonKey "\":";                                                \
+      q.append(num, UFAR_FORMAT_##type(num, m.field, 2));
+      UFAR_CHANNELS(GEN_JSON_FIELD)
+#undef GEN_JSON_FIELD
+      q += ",\"aqi\":";
+      q.append(num, formatInt(num, (int32_t)(m.pm25 * 3)));
+      if (m.co2 > 1500) q += ",\"events\":[\"co2_high\"]";
+      q += "}]}\n";
+      fwrite(q.data(), 1, q.size(), queue);
+    }
+
+    if (out.size() > (1u << 20)) {
+      fwrite(out.data(), 1, out.size(), log);
+      out.clear();
+    }
+  }
+  fwrite(out.data(), 1, out.size(), log);
+  bool ok = !ferror(log) && !ferror(queue);
+  fclose(log);
+  fclose(queue);
+  return ok;
+}
+
+static int generate(const fs::path &dir, unsigned devices, double years, uint64_t seed) {
+  int64_t start = daysFromCivil(2022, 1, 1) * 86400;
+  int64_t cycles = (int64_t)(years * 365.25 * 24 * 60 / MEASURE_INTERVAL_MIN);
+
+  std::atomic<unsigned> next(0);
+  std::atomic<bool> ok(true);
+  std::vector<std::thread> pool;
+  for (unsigned t = 0; t < std::max(1u, std::thread::hardware_concurrency()); t++) {
+    pool.emplace_back([&]() {
+      for (unsigned d; (d = next.fetch_add(1)) < devices;) {
+        std::string id = std::to_string(1001 + d);
+        if (!generateCard(dir / ("card_" + id), id, start, cycles, seed + d)) ok = false;
+      }
+    });
+  }
+  for (std::thread &th : pool) th.join();
+
+  fprintf(stderr, "Generated %u device(s) x %lld cycles in %s\n", devices,
+          (long long)cycles, dir.c_str());
+  return ok ? 0 : 1;
+}
+
+// ===================== Main =====================
+
+static bool isArchiveFile(const fs::path &p) {
+  std::string name = p.filename().string();
+  bool log = name.size() > 8 && name.compare(name.size() - 8, 8, "_log.txt") == 0;
+  bool queue = name.compare(0, 13, "pending_queue") == 0 && p.extension() == ".txt";
+  return log || queue;
+}
+
+static void usage() {
+  fprintf(stderr,
+          "usage: sd_ingest [-j N] [--csv FILE | --columnar FILE | --bench] PATH...\n"
+          "       sd_ingest --generate DIR [--devices N] [--years Y] [--seed S]\n");
+}
+
+int main(int argc, char **argv) {
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  const char *csvPath = nullptr, *columnarPath = nullptr, *generateDir = nullptr;
+  bool bench = false;
+  unsigned devices = 1;
+  double years = 1;
+  uint64_t seed = 1;
+  std::vector<fs::path> inputs;
+
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (a == "-j" && hasValue) threads = std::max(1, atoi(argv[++i]));
+    else if (a == "--csv" && hasValue) csvPath = argv[++i];
+    else if (a == "--columnar" && hasValue) columnarPath = argv[++i];
+    else if (a == "--bench") bench = true;
+    else if (a == "--generate" && hasValue) generateDir = argv[++i];
+    else if (a == "--devices" && hasValue) devices = std::max(1, atoi(argv[++i]));
+    else if (a == "--years" && hasValue) years = atof(argv[++i]);
+    else if (a == "--seed" && hasValue) seed = strtoull(argv[++i], nullptr, 10);
+    else if (!a.empty() && a[0] != '-') inputs.push_back(a);
+    else {
+      usage();
+      return 2;
+    }
+  }
+
+  if (generateDir) return generate(generateDir, devices, years, seed);
+  if (inputs.empty()) {
+    usage();
+    return 2;
+  }
+
+  std::vector<MappedFile> files;
+  for (const fs::path &in : inputs) {
+    std::error_code ec;
+    if (fs::is_directory(in, ec)) {
+      for (const auto &e : fs::recursive_directory_iterator(in, ec)) {
+        if (e.is_regular_file() && isArchiveFile(e.path())) files.push_back({ e.path() });
+      }
+    } else {
+      files.push_back({ in });
+    }
+  }
+  std::sort(files.begin(), files.end(),
+            [](const MappedFile &a, const MappedFile &b) { return a.path < b.path; });
+
+  auto t0 = std::chrono::steady_clock::now();
+  for (MappedFile &f : files) {
+    if (!mapFile(f)) {
+      fprintf(stderr, "sd_ingest: cannot read %s: %s\n", f.path.c_str(), strerror(errno));
+      return 1;
+    }
+    f.device = deviceFromFilename(f.path);
+  }
+
+  Stats st;
+  std::vector<Row> rows = ingest(files, threads, st);
+  auto t1 = std::chrono::steady_clock::now();
+  double parseSec = std::chrono::duration<double>(t1 - t0).count();
+
+  fprintf(stderr,
+          "%zu file(s), %.3f GB: %llu DATA rows, %llu queue entries, %llu LOG lines, "
+          "%llu unparsed, %llu merged -> %zu rows, %u device(s)\n",
+          files.size(), st.bytes / 1e9, (unsigned long long)st.dataRows,
+          (unsigned long long)st.queueRows, (unsigned long long)st.logLines,
+          (unsigned long long)st.badLines, (unsigned long long)st.merged, rows.size(),
+          (unsigned)deviceNames.size());
+  fprintf(stderr, "ingest: %.3f s, %.2f GB/s, %.1f M rows/s (%u threads)\n", parseSec,
+          st.bytes / 1e9 / parseSec, (st.dataRows + st.queueRows) / 1e6 / parseSec, threads);
+  if (bench) return 0;
+
+  FILE *out = stdout;
+  const char *outPath = columnarPath ? columnarPath : csvPath;
+  if (outPath && strcmp(outPath, "-") == 0) outPath = nullptr;
+  if (outPath && !(out = fopen(outPath, "wb"))) {
+    fprintf(stderr, "sd_ingest: cannot write %s: %s\n", outPath, strerror(errno));
+    return 1;
+  }
+  bool ok = columnarPath ? writeColumnar(rows, out) : writeCsv(rows, out, threads);
+  ok = (out != stdout ? fclose(out) : fflush(out)) == 0 && ok;
+  double writeSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t1).count();
+  fprintf(stderr, "write: %.3f s\n", writeSec);
+
+  if (!ok) {
+    fprintf(stderr, "sd_ingest: write failed\n");
+    return 1;
+  }
+  return 0;
+}
@@ -1,5 +1,6 @@
 #include <Wire.h>
 #include <esp_sleep.h>
+#include <esp_heap_caps.h>
 #include "config.h"
 #include "sensors.h"
 #include "sd_logger.h"
@@ -7,11 +8,18 @@
 #include "rtc_utils.h"
 #include "json_utils.h"
 #include "ota_updater.h"
+#include "circuit_breaker.h"
+#include "arena.h"
+#include "wake_scheduler.h"
+#include "checkpoint.h"
+#include "air_quality.h"
+#include "num_format.h"
 
 // ===================== RTC Memory (persists through deep sleep) =====================
 RTC_DATA_ATTR time_t lastMeasurementTime = 0;
 RTC_DATA_ATTR uint32_t bootCount = 0;
-RTC_DATA_ATTR bool timeIsSynced = false;  
+RTC_DATA_ATTR bool timeIsSynced = false;
+RTC_DATA_ATTR uint8_t routineDeferred = 0;  // routine readings held for the next batch  
 
 // ===================== Sensor Objects =====================
 BME280Sensor bme280;
@@ -19,27 +27,13 @@ SCD30Sensor  scd30;
 SGP40Sensor  sgp40;
 SPS30Sensor  sps30;
 
-// ===================== Measurement Data =====================
-struct SensorReadings {
-  float temperature = 0.0;
-  float humidity = 0.0;
-  float pressure = 0.0;
-  float co2 = 0.0;
-  int32_t vocIndex = 0;
-  float pm1 = 0.0;
-  float pm25 = 0.0;
-  float pm10 = 0.0;
-  
-  int validSamples = 0;
-};
-
 // ===================== Power Management =====================
 void enableI2CPower() {
   #if I2C_POWER_PIN >= 0
   pinMode(I2C_POWER_PIN, OUTPUT);
   digitalWrite(I2C_POWER_PIN, HIGH);
   delay(300); // Longer delay for voltage to stabilize and sensors to boot
-  logToSD("[POWER] I2C power enabled via pin " + String(I2C_POWER_PIN));
+  logToSDf("[POWER] I2C power enabled via pin %d", I2C_POWER_PIN);
   #else
   logToSD("[POWER] No I2C power control pin configured");
   delay(300); // Still wait for sensors
@@ -72,8 +66,7 @@ void scanI2CBus() {
     byte error = Wire.endTransmission();
     
     if (error == 0) {
-      String msg = "[I2C] Device found at 0x" + String(address, HEX);
-      logToSD(msg);
+      logToSDf("[I2C] Device found at 0x%X", address);
       devicesFound++;
     }
   }
@@ -81,12 +74,14 @@ void scanI2CBus() {
   if (devicesFound == 0) {
     logToSD("[I2C] WARNING: No devices found on bus!");
   } else {
-    logToSD("[I2C] Found " + String(devicesFound) + " device(s)");
+    logToSDf("[I2C] Found %d device(s)", devicesFound);
   }
 }
 
 // ===================== Sensor Initialization =====================
-bool initAllSensors() {
+// warm: resuming a cycle whose SCD30 and SPS30 are still measuring (see
+// sensorsStillWarm()); they are only re-attached, not reset or woken
+bool initAllSensors(bool warm) {
   logToSD("[SENSORS] Initializing all sensors...");
   
   // Initialize I2C with longer timeout and error recovery
@@ -115,7 +110,14 @@ bool initAllSensors() {
   
   // SCD30
   delay(50);
-  if (scd30.init()) {
+  if (warm) {
+    if (scd30.attach()) {
+      logToSD("[SCD30] Re-attached, still measuring");
+    } else {
+      logToSD("[SCD30] ERROR: Not responding");
+      allOk = false;
+    }
+  } else if (scd30.init()) {
     logToSD("[SCD30] Initialized successfully");
   } else {
     logToSD("[SCD30] ERROR: Initialization failed");
@@ -145,7 +147,9 @@ bool initAllSensors() {
   
   // SPS30
   delay(50);
-  if (sps30.init()) {
+  if (warm) {
+    logToSD("[SPS30] Still measuring");
+  } else if (sps30.init()) {
     logToSD("[SPS30] Initialized successfully");
   } else {
     logToSD("[SPS30] ERROR: Initialization failed");
@@ -166,27 +170,39 @@ bool initAllSensors() {
 }
 
 // ===================== Sensor Start/Stop =====================
-void startAllSensors(float pressure_hPa) {
+// SCD30 is started separately (see startSCD30()) so it doesn't run through warm-up
+void startAllSensors(bool warm) {
   logToSD("[SENSORS] Starting all sensors...");
   
   bme280.start();
   logToSD("[BME280] Started");
   
-  scd30.start((uint16_t)pressure_hPa);
-  logToSD("[SCD30] Started with pressure compensation: " + String((int)pressure_hPa) + " hPa");
-  
   sgp40.start();
   logToSD("[SGP40] Started");
+
+  if (warm) return;  // SPS30 still measuring, warm-up done
   
   // SPS30 requires warm-up time
   logToSD("[SPS30] Starting fan...");
   if (sps30.start()) {
-    logToSD("[SPS30] Fan started, warming up for " + String(SPS30_WARMUP_SEC) + " seconds");
+    logToSDf("[SPS30] Fan started, warming up for %d seconds", SPS30_WARMUP_SEC);
   } else {
     logToSD("[SPS30] ERROR: Failed to start");
   }
 }
 
+// Starts SCD30 with the current BME280 pressure, one measurement interval
+// before sampling so its first reading is ready for the first sample
+void startSCD30() {
+  float temp, hum, press;
+  if (!bme280.read(temp, hum, press)) press = 0;
+
+  scd30.start(press);
+  char pressText[NUM_FORMAT_MAX];
+  formatFixed(pressText, press, 1);
+  logToSDf("[SCD30] Started with pressure compensation: %s hPa", pressText);
+}
+
 void stopAllSensors() {
   logToSD("[SENSORS] Stopping all sensors...");
   
@@ -199,98 +215,153 @@ void stopAllSensors() {
 }
 
 // ===================== Single Reading =====================
-bool takeSingleReading(SensorReadings &reading) {
-  float temp, hum, press;
-  
+bool takeSingleReading(SensorReadings &reading, bool sampleVoc) {
+  MeasurementData sample = {};
+  bool ok[SRC_COUNT] = {};
+
   // BME280 - always read first for T/H compensation
-  if (bme280.read(temp, hum, press)) {
-    reading.temperature += temp;
-    reading.humidity += hum;
-    reading.pressure += press;
-  } else {
+  ok[SRC_BME280] = bme280.read(sample.temperature, sample.humidity, sample.pressure);
+  if (!ok[SRC_BME280]) {
     logToSD("[BME280] ERROR: Read failed");
   }
-  
+
   // SCD30
-  float co2;
-  if (scd30.read(co2)) {
-    reading.co2 += co2;
-  } else {
+  ok[SRC_SCD30] = scd30.read(sample.co2);
+  if (!ok[SRC_SCD30]) {
     logToSD("[SCD30] WARNING: Data not ready");
   }
-  
-  // SGP40
-  int32_t voc;
-  if (sgp40.read(voc, temp, hum)) {
-    reading.vocIndex += voc;
-  } else {
-    logToSD("[SGP40] ERROR: Read failed");
+
+  // SGP40 (only inside its sampling window, see SGP40_SAMPLE_WINDOW_SEC)
+  if (sampleVoc) {
+    ok[SRC_SGP40] = sgp40.read(sample.voc, sample.temperature, sample.humidity);
+    if (!ok[SRC_SGP40]) {
+      logToSD("[SGP40] ERROR: Read failed");
+    }
   }
-  
+
   // SPS30
-  float pm1, pm25, pm10;
-  if (sps30.read(pm1, pm25, pm10)) {
-    reading.pm1 += pm1;
-    reading.pm25 += pm25;
-    reading.pm10 += pm10;
-  } else {
+  #if SPS30_NUMBER_CONCENTRATION
+  float nc[SPS30_NC_COUNT];
+  ok[SRC_SPS30] = sps30.read(sample.pm1, sample.pm25, sample.pm10, nc);
+#define UFAR_NC_FIELD(field, ...) sample.field = nc[SPS30_NC_##field];
+  UFAR_SPS30_NC_CHANNELS(UFAR_NC_FIELD)
+#undef UFAR_NC_FIELD
+  #else
+  ok[SRC_SPS30] = sps30.read(sample.pm1, sample.pm25, sample.pm10);
+  #endif
+  if (!ok[SRC_SPS30]) {
     logToSD("[SPS30] WARNING: Data not ready");
   }
-  
+
+  // Accumulate every channel whose source sensor delivered this sample
+#define UFAR_ACCUMULATE(field, jsonKey, logKey, units, source, type, precision) \
+  if (ok[source]) {                                                          \
+    reading.field += sample.field;                                           \
+    reading.stats[CHANNEL_##field].add(sample.field);                        \
+  }
+  UFAR_CHANNELS(UFAR_ACCUMULATE)
+#undef UFAR_ACCUMULATE
+
   reading.validSamples++;
   return true;
 }
 
 // ===================== Measurement Cycle =====================
-void performMeasurementCycle(MeasurementData &finalData) {
+// A reset doesn't cut the I2C rail: the sensors of a cycle cut short by one
+// may still be running, and then warm-up is done
+bool sensorsStillWarm(const CycleCheckpoint &cp) {
+  Wire.begin();
+  return (time(nullptr) - cp.warmupStart >= SPS30_WARMUP_SEC) && sps30.dataReady();
+}
+
+// resume: checkpoint of this cycle left by a reset mid-cycle, or nullptr;
+// warm: sensorsStillWarm() for it. Returns the CHANNEL_BIT()s of the
+// channels averaged into finalData; the others had no samples and are left
+// at zero.
+uint32_t performMeasurementCycle(MeasurementData &finalData, time_t cycleId,
+                                 const CycleCheckpoint *resume, bool warm) {
   logToSD("[MEASURE] ========== Starting Measurement Cycle ==========");
   
-  SensorReadings accumulated;
-  
-  // Get initial pressure for SCD30 compensation
-  float temp, hum, press;
-  bme280.read(temp, hum, press);
-  
-  // Start all sensors
-  startAllSensors(press);
-  
-  // SPS30 warm-up
-  logToSD("[MEASURE] SPS30 warming up...");
-  delay(SPS30_WARMUP_SEC * 1000);
+  CycleCheckpoint cp = {};
+  cp.cycleId = cycleId;
+
+  if (resume) {
+    cp = *resume;
+    logToSDf("[MEASURE] Resuming interrupted cycle at sample %u%s", (unsigned)cp.samplesDone,
+             warm ? ", sensors still warm" : ", redoing warm-up");
+  }
+  SensorReadings &accumulated = cp.accumulated;
+  
+  // Start all sensors (SCD30 stays stopped until just before sampling)
+  startAllSensors(warm);
+  
+  // SPS30 warm-up, with SCD30 started SCD30_LEAD_SEC before it ends
+  uint32_t lead = min((uint32_t)SCD30_LEAD_SEC, (uint32_t)SPS30_WARMUP_SEC);
+  if (!warm) {
+    logToSD("[MEASURE] SPS30 warming up...");
+    cp.warmupStart = time(nullptr);
+    checkpointSave(cp);
+    delay((SPS30_WARMUP_SEC - lead) * 1000);
+  }
+  // Once sampling has begun the SCD30 was started before the reset
+  if (!warm || cp.samplesDone == 0) {
+    startSCD30();
+    delay(lead * 1000);
+  }
   
   // Calculate number of samples
   int numSamples = SAMPLE_DURATION_SEC / SAMPLE_INTERVAL_SEC;
-  logToSD("[MEASURE] Taking " + String(numSamples) + " samples over " + String(SAMPLE_DURATION_SEC) + " seconds");
+  logToSDf("[MEASURE] Taking %d samples over %d seconds", numSamples, SAMPLE_DURATION_SEC);
   
-  // Take multiple samples
-  for (int i = 0; i < numSamples; i++) {    
-    takeSingleReading(accumulated);
+  // SGP40 only samples the tail of the window; its VOC state is restored from RTC
+  int vocSamples = SGP40_SAMPLE_WINDOW_SEC / SAMPLE_INTERVAL_SEC;
+
+  // Take multiple samples, checkpointing after each one
+  for (int i = cp.samplesDone; i < numSamples; i++) {    
+    takeSingleReading(accumulated, i >= numSamples - vocSamples);
+    cp.samplesDone = i + 1;
+    checkpointSave(cp);
     
     if (i < numSamples - 1) {
       delay(SAMPLE_INTERVAL_SEC * 1000);
     }
-    
-    // Flush logs periodically
-    if ((i + 1) % 10 == 0) {
-      flushSDLog();
-    }
+
+    // No explicit log flush here: the SD writer task on the other core
+    // persists records on its own schedule without stalling sampling
   }
   
   // Average the readings
+  uint32_t channels = 0;
   if (accumulated.validSamples > 0) {
-    finalData.temperature = accumulated.temperature / accumulated.validSamples;
-    finalData.humidity = accumulated.humidity / accumulated.validSamples;
-    finalData.pressure = accumulated.pressure / accumulated.validSamples;
-    finalData.co2 = accumulated.co2 / accumulated.validSamples;
-    finalData.voc = accumulated.vocIndex / accumulated.validSamples;
-    finalData.pm1 = accumulated.pm1 / accumulated.validSamples;
-    finalData.pm25 = accumulated.pm25 / accumulated.validSamples;
-    finalData.pm10 = accumulated.pm10 / accumulated.validSamples;
+    // Each channel is averaged over the samples its sensor actually delivered
+#define UFAR_AVERAGE(field, ...)                                                      \
+    if (accumulated.stats[CHANNEL_##field].count > 0) {                               \
+      finalData.field = accumulated.field / accumulated.stats[CHANNEL_##field].count; \
+      channels |= CHANNEL_BIT(field);                                                 \
+    }
+    UFAR_CHANNELS(UFAR_AVERAGE)
+#undef UFAR_AVERAGE
     
-    logToSD("[MEASURE] Averaged data from " + String(accumulated.validSamples) + " samples");
-    logToSD("[MEASURE] Final: T=" + String(finalData.temperature, 1) + "°C, H=" + String(finalData.humidity, 1) + 
-            "%, P=" + String(finalData.pressure, 1) + "hPa, CO2=" + String((int)finalData.co2) + 
-            "ppm, VOC=" + String(finalData.voc) + ", PM2.5=" + String(finalData.pm25, 2) + "µg/m³");
+    logToSDf("[MEASURE] Averaged data from %d samples", accumulated.validSamples);
+    char t[NUM_FORMAT_MAX], h[NUM_FORMAT_MAX], p[NUM_FORMAT_MAX], pm[NUM_FORMAT_MAX];
+    formatFixed(t, finalData.temperature, 1);
+    formatFixed(h, finalData.humidity, 1);
+    formatFixed(p, finalData.pressure, 1);
+    formatFixed(pm, finalData.pm25, 2);
+    logToSDf("[MEASURE] Final: T=%s°C, H=%s%%, P=%shPa, CO2=%dppm, VOC=%d, PM2.5=%sµg/m³",
+             t, h, p, (int)finalData.co2, (int)finalData.voc, pm);
+
+    #if DEBUG
+    for (int c = 0; c < CHANNEL_COUNT; c++) {
+      const ChannelStats &st = accumulated.stats[c];
+      if (st.count == 0) continue;
+      char lo[NUM_FORMAT_MAX], hi[NUM_FORMAT_MAX];
+      formatFixed(lo, st.min, CHANNEL_INFO[c].precision);
+      formatFixed(hi, st.max, CHANNEL_INFO[c].precision);
+      logToSDf("[MEASURE] %s: n=%u min=%s max=%s %s",
+               CHANNEL_INFO[c].name, st.count, lo, hi, CHANNEL_INFO[c].units);
+    }
+    #endif
   } else {
     logToSD("[MEASURE] ERROR: No valid samples collected");
   }
@@ -299,39 +370,64 @@ void performMeasurementCycle(MeasurementData &finalData) {
   stopAllSensors();
   
   logToSD("[MEASURE] ========== Measurement Cycle Complete ==========");
+  return channels;
 }
 
 // ===================== Data Transmission =====================
 // Returns true if the API accepted the data.
 // NOTE: does NOT disconnect WiFi — caller must do that after uploadLogToS3().
-bool sendData(time_t timestamp, MeasurementData &data) {
+// Routine readings (no air quality event) are queued without bringing WiFi up
+// until UPLINK_ROUTINE_BATCH of them are due; priority readings go out now.
+bool sendData(time_t timestamp, MeasurementData &data, const AirQualityResult &aq) {
   logToSD("[SEND] ========== Starting Data Transmission ==========");
 
   // Always log the data reading to the log file, regardless of outcome
-  logDataToFile(timestamp, data.temperature, data.humidity, data.pressure,
-                data.co2, data.voc, data.pm1, data.pm25, data.pm10);
+  logDataToFile(timestamp, data);
+
+  if (!aq.priority && routineDeferred + 1 < UPLINK_ROUTINE_BATCH) {
+    routineDeferred++;
+    logToSDf("[SEND] Routine reading deferred (%u/%u) - queued for batch send",
+             routineDeferred, (unsigned)UPLINK_ROUTINE_BATCH);
+    queueFailedData(timestamp, data, &aq);
+    return false;
+  }
+
+  // Don't spend radio time on an API the circuit breaker knows is down
+  if (!uplinkAllowed()) {
+    logToSD("[SEND] Uplink backing off - queuing data for retry");
+    queueFailedData(timestamp, data, &aq);
+    return false;
+  }
 
   // Connect WiFi
   if (!connectWiFi()) {
     logToSD("[SEND] ERROR: WiFi connection failed - queuing data for retry");
-    queueFailedData(timestamp, data);
+    queueFailedData(timestamp, data, &aq);
     return false;
   }
 
-  // Prepare and send JSON to API
-  String payload = prepareJSON(DEVICE_ID, timestamp, data);
+  // Prepare and send JSON to API (the payload lives in the arena)
+  char *payload = arenaAlloc(QUEUE_LINE_MAX);
+  size_t len = payload ? prepareJSON(payload, QUEUE_LINE_MAX, DEVICE_ID, timestamp, data, &aq) : 0;
 
   #if DEBUG
-  logToSD("[SEND] JSON: " + payload);
+  logToSDf("[SEND] JSON: %.*s", (int)len, len ? payload : "");
   #endif
 
-  bool success = sendHTTP(payload);
+  bool success = len > 0 &&
+                 sendHTTP(payload, len, uplinkIsProbing() ? HTTP_PROBE_TIMEOUT_MS : HTTP_TIMEOUT_MS);
 
   if (success) {
     logToSD("[SEND] API transmission successful");
+    // Send the deferred routine readings (and any earlier failures) in the same session
+    routineDeferred = 0;
+    if (hasPendingQueue()) {
+      arenaReset();
+      flushPendingQueue();
+    }
   } else {
     logToSD("[SEND] WARNING: API transmission failed - queuing data for retry");
-    queueFailedData(timestamp, data);
+    queueFailedData(timestamp, data, &aq);
   }
 
   logToSD("[SEND] ========== Transmission Complete ==========");
@@ -341,17 +437,23 @@ bool sendData(time_t timestamp, MeasurementData &data) {
 
 // ===================== Deep Sleep =====================
 void enterDeepSleep(uint64_t sleepTimeSeconds) {
-  logToSD("[SLEEP] Entering deep sleep for " + String((uint32_t)sleepTimeSeconds) + " seconds");
-  logToSD("[SLEEP] Next wake: " + timeToStr(time(nullptr) + sleepTimeSeconds));
-  
-  flushSDLog(); // Make sure all logs are written
+  logToSDf("[SLEEP] Entering deep sleep for %u seconds", (unsigned)sleepTimeSeconds);
+  logToSDf("[SLEEP] Next wake: %s", timeText(time(nullptr) + sleepTimeSeconds).str);
   
+  logToSDf("[SLEEP] Heap: free=%u min=%u largest=%u, arena peak=%u/%u",
+           ESP.getFreeHeap(), ESP.getMinFreeHeap(),
+           (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT),
+           (unsigned)arenaPeak(), (unsigned)ARENA_SIZE);
+
   // Configure wake-up
   esp_sleep_enable_timer_wakeup(sleepTimeSeconds * 1000000ULL);
   
   // Power down peripherals
   disableI2CPower();
   
+  // Drain barrier: the SD writer task must persist everything before sleep
+  flushSDLog();
+
   // Enter deep sleep
   esp_deep_sleep_start();
 }
@@ -363,7 +465,7 @@ void setup() {
   #if DEBUG
   Serial.begin(115200);
   delay(1000);
-  Serial.println("\n\n========== BOOT " + String(bootCount) + " ==========");
+  Serial.printf("\n\n========== BOOT %u ==========\n", (unsigned)bootCount);
   #endif
   
   // Initialize SD card first
@@ -373,8 +475,11 @@ void setup() {
     #endif
   }
   
-  logToSD("[SYSTEM] ========== BOOT #" + String(bootCount) + " ==========");
-  logToSD("[SYSTEM] Wake-up reason: " + String(esp_sleep_get_wakeup_cause()));
+  logToSDf("[SYSTEM] ========== BOOT #%u ==========", (unsigned)bootCount);
+  logToSDf("[SYSTEM] Wake-up reason: %d", (int)esp_sleep_get_wakeup_cause());
+
+  // Correct the clock for the learned RTC drift over the sleep just taken
+  schedulerOnWake();
   
   // Disable modem to save power (not using SIM card)
   disableModem();
@@ -390,18 +495,20 @@ void setup() {
   if (bootCount == 1 || !timeIsSynced) {
     bool synced = false;
     for (int attempt = 1; attempt <= 3 && !synced; attempt++) {
-      logToSD("[SYSTEM] NTP sync attempt " + String(attempt) + "/3...");
+      logToSDf("[SYSTEM] NTP sync attempt %d/3...", attempt);
 
       if (WiFi.status() != WL_CONNECTED) {
         if (!connectWiFi()) {
-          logToSD("[SYSTEM] WiFi failed on attempt " + String(attempt));
+          logToSDf("[SYSTEM] WiFi failed on attempt %d", attempt);
           delay(2000);
           continue;
         }
       }
 
-      if (syncTime()) {
+      double step;
+      if (syncTime(&step)) {
         synced = true;
+        schedulerRecordSync(step, timeIsSynced);
         timeIsSynced = true;
       } else {
         logToSD("[SYSTEM] NTP failed, reconnecting WiFi and retrying...");
@@ -418,18 +525,20 @@ void setup() {
       // Never reaches here
     }
   } else {
-    // Time already synced from a previous boot - just connect WiFi
+    // Time already synced from a previous boot - just connect WiFi, and
+    // re-sync now and then (the step is how the scheduler sees RTC drift)
     if (!connectWiFi()) {
       logToSD("[SYSTEM] ERROR: WiFi connection failed on boot");
+    } else if (schedulerResyncDue()) {
+      double step;
+      if (syncTime(&step)) schedulerRecordSync(step, true);
     }
   }
   
   // CRITICAL: timezone must be re-applied on every boot (doesn't persist through deep sleep).
-  // If we just synced above, configTime was already called inside syncTime().
-  // Call it again here to guarantee timezone is set even on non-first boots.
-  configTime(ARMENIA_TZ_OFFSET, ARMENIA_DST_OFFSET,
-             "pool.ntp.org", "time.nist.gov", "time.google.com");
-  delay(100);
+  // Only the timezone: configTime() would restart SNTP, and its clock step
+  // would land somewhere in this wake instead of inside syncTime()
+  applyTimezone();
 
   // Get current time (guaranteed valid — we hard-rebooted above if NTP failed)
   time_t now = time(nullptr);
@@ -437,21 +546,25 @@ void setup() {
   // On first boot, anchor lastMeasurementTime so scheduling starts from now
   if (bootCount == 1) {
     lastMeasurementTime = now;
-    logToSD("[SYSTEM] First boot - time anchored: " + timeToStr(now));
+    logToSDf("[SYSTEM] First boot - time anchored: %s", timeText(now).str);
   } else {
-    logToSD("[SYSTEM] Current time: " + timeToStr(now));
+    logToSDf("[SYSTEM] Current time: %s", timeText(now).str);
   }
 
   // Now that time is valid, flush any queued measurements from previous failures.
   // WiFi is still connected at this point.
-  if (WiFi.status() == WL_CONNECTED && hasPendingQueue()) {
+  // Each network phase starts from an empty scratch arena.
+  // Routine readings held for a batch wait for their batch send instead.
+  if (WiFi.status() == WL_CONNECTED && hasPendingQueue() && routineDeferred == 0) {
     logToSD("[SYSTEM] Pending queue found - flushing offline data...");
+    arenaReset();
     flushPendingQueue();
   }
 
   // Check for OTA firmware update while WiFi is up.
   // If an update is applied the device reboots automatically inside checkAndApplyOTA().
   if (WiFi.status() == WL_CONNECTED) {
+    arenaReset();
     checkAndApplyOTA();
   }
   
@@ -463,34 +576,51 @@ void setup() {
   uint32_t measurementTimeNeeded = SPS30_WARMUP_SEC + SAMPLE_DURATION_SEC;
   time_t startMeasurementTime = nextSendTime - measurementTimeNeeded;
   
-  logToSD("[SYSTEM] Next send time: " + timeToStr(nextSendTime));
-  logToSD("[SYSTEM] Should start measuring at: " + timeToStr(startMeasurementTime));
+  logToSDf("[SYSTEM] Next send time: %s", timeText(nextSendTime).str);
+  logToSDf("[SYSTEM] Should start measuring at: %s", timeText(startMeasurementTime).str);
+
+  // ---- Resume a cycle cut short by a reset (brownout, watchdog, panic) ----
+  // Only while its slot is still ahead of the next cycle's window
+  CycleCheckpoint checkpoint;
+  bool resuming = false;
+  if (checkpointLoad(checkpoint)) {
+    time_t resumeDeadline = checkpoint.cycleId + MEASURE_INTERVAL_MIN * 60 - measurementTimeNeeded;
+    if (now < resumeDeadline) {
+      resuming = true;
+      logToSDf("[SYSTEM] Found interrupted cycle for %s (%u samples done)",
+               timeText(checkpoint.cycleId).str, (unsigned)checkpoint.samplesDone);
+    } else {
+      logToSDf("[SYSTEM] Discarding stale checkpoint for %s", timeText(checkpoint.cycleId).str);
+      checkpointClear();
+    }
+  }
 
   // ---- Decide what to do this boot ----
 
+  // A wake past the send time it was aimed at has lost that slot for good
+  // (calculateNextSend() has already moved on to the following one)
+  if (!resuming) schedulerCheckSlot(now, measurementTimeNeeded);
+
   bool shouldMeasure = false;
   time_t measurementTimestamp;
 
-  if (bootCount == 1) {
+  if (resuming) {
+    shouldMeasure = true;
+    measurementTimestamp = checkpoint.cycleId;
+    logToSD("[SYSTEM] Resuming interrupted measurement");
+  } else if (bootCount == 1) {
     // First boot: measure immediately, timestamp = now rounded to interval
     // This gives a clean first reading without waiting up to one full interval
     shouldMeasure = true;
     measurementTimestamp = nextSendTime; // use next interval boundary as timestamp
     logToSD("[SYSTEM] First boot - measuring immediately");
-  } else if (now >= startMeasurementTime - 30 && now < nextSendTime) {
-    // Normal wake: inside the measurement window for the upcoming send slot
+  } else if (now >= startMeasurementTime - (time_t)(schedulerLeadSec() + WAKE_MIN_SLEEP_SEC)) {
+    // Normal wake: too close to the window for another useful sleep
     shouldMeasure = true;
     measurementTimestamp = nextSendTime;
     logToSD("[SYSTEM] Time to start measurement sequence");
-  } else if (now >= nextSendTime) {
-    // Woke up too late — missed the window, skip and reschedule
-    logToSD("[SYSTEM] WARNING: Woke up too late, skipping this measurement cycle");
-    disconnectWiFi();
-    lastMeasurementTime = now;
-    nextSendTime = calculateNextSend(now, lastMeasurementTime, MEASURE_INTERVAL_MIN);
-    startMeasurementTime = nextSendTime - measurementTimeNeeded;
   } else {
-    logToSD("[SYSTEM] Not time to measure yet (next start: " + timeToStr(startMeasurementTime) + ")");
+    logToSDf("[SYSTEM] Not time to measure yet (next start: %s)", timeText(startMeasurementTime).str);
     disconnectWiFi();
   }
 
@@ -502,18 +632,37 @@ void setup() {
     scanI2CBus();
     #endif
 
-    if (!initAllSensors()) {
+    bool warm = resuming && sensorsStillWarm(checkpoint);
+    if (!initAllSensors(warm)) {
       logToSD("[SYSTEM] WARNING: Some sensors failed to initialize");
     }
 
-    MeasurementData data;
-    performMeasurementCycle(data);
+    // Ready to sample: teach the scheduler how long this wake took, then
+    // hold until the window opens so the average ends on the send slot
+    if (bootCount > 1 && !resuming) {
+      int32_t spare = schedulerRecordReady(startMeasurementTime);
+      if (spare > 0) {
+        delay(spare * 1000UL);
+      }
+    }
+
+    arenaReset();
+    MeasurementData data = {};
+    uint32_t channels = performMeasurementCycle(data, measurementTimestamp,
+                                                resuming ? &checkpoint : nullptr, warm);
 
-    logToSD("[SYSTEM] Using scheduled timestamp: " + timeToStr(measurementTimestamp));
+    logToSDf("[SYSTEM] Using scheduled timestamp: %s", timeText(measurementTimestamp).str);
+
+    // AQI and threshold/rise events decide whether this reading is sent now
+    AirQualityResult aq = {};
+    analyzeAirQuality(measurementTimestamp, data, channels, aq);
 
     // sendData reconnects WiFi internally; do NOT disconnect after it returns
     // so that uploadLogToS3 can reuse the same connection
-    bool sent = sendData(measurementTimestamp, data);
+    bool sent = sendData(measurementTimestamp, data, aq);
+
+    // Data is now sent or queued — nothing left to resume
+    checkpointClear();
 
     if (sent) {
       lastMeasurementTime = measurementTimestamp;
@@ -521,7 +670,7 @@ void setup() {
       // Upload the full daily log (logs + data) to S3 while WiFi is still up
       uploadLogToS3();
     } else {
-      logToSD("[SYSTEM] Transmission failed - data queued for retry on next boot");
+      logToSD("[SYSTEM] Data not sent - queued for retry or batch send on a later boot");
       lastMeasurementTime = measurementTimestamp;
     }
 
@@ -534,17 +683,10 @@ void setup() {
     startMeasurementTime = nextSendTime - measurementTimeNeeded;
   }
   
-  // Calculate sleep duration until next measurement START time
+  // Sleep so the next wake is ready just as the measurement window opens
+  // (learned wake latency and RTC drift; minimum WAKE_MIN_SLEEP_SEC)
   now = time(nullptr);
-  uint64_t sleepSeconds;
-
-  if (startMeasurementTime > now + 10) {
-    sleepSeconds = (startMeasurementTime - now) - 10; // wake 10s early for boot overhead
-  } else {
-    // startMeasurementTime is in the past or imminent — wake immediately
-    // (next boot will fall into the measurement window check)
-    sleepSeconds = 10;
-  }
+  uint64_t sleepSeconds = schedulerSleepSeconds(now, startMeasurementTime);
   
   enterDeepSleep(sleepSeconds);
 }
@@ -0,0 +1,136 @@
+#include "wake_scheduler.h"
+#include "sd_logger.h"
+#include "num_format.h"
+#include "config.h"
+#include <sys/time.h>
+
+// ===================== RTC state =====================
+RTC_DATA_ATTR static float    latencyMean = WAKE_LATENCY_INIT_SEC;
+RTC_DATA_ATTR static float    latencyVar  = WAKE_LATENCY_INIT_SEC;
+RTC_DATA_ATTR static float    sleepDrift  = 0;   // (actual / requested) - 1
+RTC_DATA_ATTR static uint32_t driftSamples = 0;
+RTC_DATA_ATTR static uint32_t sleepRequested = 0;
+RTC_DATA_ATTR static time_t   sleepTarget = 0;   // window start the last sleep aimed at
+
+// Since the last confirmed NTP sync: requested sleep, and what
+// schedulerOnWake() added to the clock for it
+RTC_DATA_ATTR static bool     syncBaseline = false;
+RTC_DATA_ATTR static double   sleptSinceSync = 0;
+RTC_DATA_ATTR static double   correctedSinceSync = 0;
+
+// Running totals, logged every cycle
+RTC_DATA_ATTR static uint32_t statCycles = 0;
+RTC_DATA_ATTR static uint32_t statMisses = 0;
+RTC_DATA_ATTR static uint32_t statIdleSec = 0;
+
+// ===================== Clock =====================
+
+void schedulerOnWake() {
+  if (sleepRequested == 0) return;
+
+  // The slow clock timed the sleep and kept the time through it, so the
+  // clock is behind by the same drift that made the sleep run long
+  double correction = driftSamples > 0 ? sleepRequested * (double)sleepDrift : 0;
+  if (correction != 0) {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    int64_t us = (int64_t)tv.tv_sec * 1000000 + tv.tv_usec + (int64_t)(correction * 1e6);
+    tv.tv_sec = us / 1000000;
+    tv.tv_usec = us % 1000000;
+    settimeofday(&tv, nullptr);
+  }
+  sleptSinceSync += sleepRequested;
+  correctedSinceSync += correction;
+  sleepRequested = 0;
+}
+
+bool schedulerResyncDue() {
+  return !syncBaseline || sleptSinceSync >= WAKE_RESYNC_SEC;
+}
+
+void schedulerRecordSync(double stepSec, bool hadTime) {
+  // Step = slept * drift - what was already corrected for
+  if (hadTime && syncBaseline && sleptSinceSync >= WAKE_DRIFT_MIN_SLEPT_SEC) {
+    float drift = (float)((stepSec + correctedSinceSync) / sleptSinceSync);
+    char step[NUM_FORMAT_MAX], ppm[NUM_FORMAT_MAX];
+    formatFixed(step, (float)stepSec, 3);
+    formatFixed(ppm, drift * 1e6f, 0);
+    if (fabsf(drift) < WAKE_DRIFT_MAX) {
+      sleepDrift = driftSamples == 0 ? drift : sleepDrift + WAKE_EWMA_ALPHA * (drift - sleepDrift);
+      driftSamples++;
+      logToSDf("[SCHED] NTP step %ss after %lus of sleep: drift sample %sppm",
+               step, (unsigned long)sleptSinceSync, ppm);
+    } else {
+      logToSDf("[SCHED] NTP step %ss after %lus of sleep: %sppm ignored",
+               step, (unsigned long)sleptSinceSync, ppm);
+    }
+  }
+  syncBaseline = true;
+  sleptSinceSync = 0;
+  correctedSinceSync = 0;
+}
+
+// ===================== Estimators =====================
+
+uint32_t schedulerLeadSec() {
+  float lead = latencyMean + WAKE_LATENCY_Z * sqrtf(latencyVar);
+  if (lead < 1) lead = 1;
+  return (uint32_t)ceilf(lead);
+}
+
+static void recordMiss(time_t lateBySec) {
+  statMisses++;
+  // Widen the spread so the next wake comes earlier
+  float late = (float)lateBySec + latencyMean;
+  latencyVar += WAKE_EWMA_ALPHA * late * late;
+  logToSDf("[SCHED] Missed slot by %lds (%u of %u cycles missed)",
+           (long)lateBySec, (unsigned)statMisses, (unsigned)statCycles);
+}
+
+void schedulerCheckSlot(time_t now, time_t windowSec) {
+  time_t target = sleepTarget;
+  sleepTarget = 0;
+  if (target > 0 && now >= target + windowSec) {
+    statCycles++;
+    recordMiss(now - target);
+  }
+}
+
+int32_t schedulerRecordReady(time_t target) {
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  float latency = millis() / 1000.0f;
+
+  // Exponentially weighted mean/variance of wake-to-ready latency
+  float delta = latency - latencyMean;
+  latencyMean += WAKE_EWMA_ALPHA * delta;
+  latencyVar = (1 - WAKE_EWMA_ALPHA) * (latencyVar + WAKE_EWMA_ALPHA * delta * delta);
+
+  int32_t spare = (int32_t)(target - (time_t)tv.tv_sec);
+  statCycles++;
+  if (spare > 0) statIdleSec += spare;
+
+  char lat[NUM_FORMAT_MAX], mean[NUM_FORMAT_MAX], sd[NUM_FORMAT_MAX], ppm[NUM_FORMAT_MAX];
+  formatFixed(lat, latency, 1);
+  formatFixed(mean, latencyMean, 1);
+  formatFixed(sd, sqrtf(latencyVar), 1);
+  formatFixed(ppm, sleepDrift * 1e6f, 0);
+  logToSDf("[SCHED] Ready %ss after wake, %lds before start (latency mean=%ss sd=%ss, drift=%sppm)",
+           lat, (long)spare, mean, sd, ppm);
+  if (spare < 0) recordMiss(-spare);  // sampling starts late, the window ends past the slot
+  logToSDf("[SCHED] Totals: %u cycles, %u missed, %us idle awake",
+           (unsigned)statCycles, (unsigned)statMisses, (unsigned)statIdleSec);
+  return spare;
+}
+
+uint64_t schedulerSleepSeconds(time_t now, time_t target) {
+  float awake = (float)(target - now) - schedulerLeadSec();
+  float seconds = awake / (1.0f + sleepDrift);
+
+  uint64_t sleepSeconds = WAKE_MIN_SLEEP_SEC;
+  if (seconds > WAKE_MIN_SLEEP_SEC) sleepSeconds = (uint64_t)seconds;
+
+  sleepRequested = (uint32_t)sleepSeconds;
+  sleepTarget = target;
+  return sleepSeconds;
+}
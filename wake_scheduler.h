@@ -0,0 +1,40 @@
+#pragma once
+#include <Arduino.h>
+#include <time.h>
+
+// ===================== Wake scheduler =====================
+// Learns how long a wake takes to become ready to sample (boot, SD, WiFi,
+// queue/OTA, sensor init) and how far the RTC slow clock drifts during deep
+// sleep, keeping EWMA estimates in RTC memory. Used to pick a sleep length
+// that wakes the device just in time for the next measurement window.
+//
+// The wall clock after deep sleep comes from the same slow clock, so drift
+// can't be seen from it; it is measured as the step of a confirmed NTP sync
+// over the sleep since the previous one, and corrected for on every wake.
+
+// Call first thing on every boot: adds the learned drift over the sleep just
+// taken to the wall clock
+void schedulerOnWake();
+
+// True when the clock should be re-synced (also measures drift)
+bool schedulerResyncDue();
+
+// Call after a confirmed NTP sync. stepSec is what it moved the clock by;
+// hadTime is false if the clock wasn't set before (nothing to measure)
+void schedulerRecordSync(double stepSec, bool hadTime);
+
+// Seconds to wake ahead of a target: mean + WAKE_LATENCY_Z * stddev
+uint32_t schedulerLeadSec();
+
+// Call on a wake that isn't resuming a cycle, before deciding what to do.
+// If the wake came after the send time of the slot it was aimed at
+// (startTarget + windowSec), that slot is counted as missed.
+void schedulerCheckSlot(time_t now, time_t windowSec);
+
+// Call once the device is ready to start sampling for `target`. Feeds the
+// latency estimator and returns seconds left until target; negative means
+// ready late, which counts as a miss.
+int32_t schedulerRecordReady(time_t target);
+
+// Sleep length that should leave the device ready at `target`
+uint64_t schedulerSleepSeconds(time_t now, time_t target);
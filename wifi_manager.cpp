@@ -1,7 +1,10 @@
 #include "wifi_manager.h"
 #include "sd_logger.h"
+#include "net_client.h"
 #include "config.h"
 #include <Arduino.h>
+#include <esp_sntp.h>
+#include <sys/time.h>
 
 bool connectWiFi() {
   logToSD("[WIFI] Connecting to WiFi...");
@@ -16,7 +19,8 @@ bool connectWiFi() {
   }
   
   if (WiFi.status() == WL_CONNECTED) {
-    logToSD("[WIFI] Connected! IP: " + WiFi.localIP().toString());
+    IPAddress ip = WiFi.localIP();
+    logToSDf("[WIFI] Connected! IP: %u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
     return true;
   } else {
     logToSD("[WIFI] ERROR: Connection timeout");
@@ -25,21 +29,32 @@ bool connectWiFi() {
 }
 
 void disconnectWiFi() {
+  netCloseAll();
   logToSD("[WIFI] Disconnecting...");
   WiFi.disconnect(true);
   WiFi.mode(WIFI_OFF);
 }
 
-bool syncTime() {
+bool syncTime(double *stepSec) {
   logToSD("[TIME] Syncing NTP (Armenia UTC+4)...");
 
+  struct timeval before;
+  gettimeofday(&before, nullptr);
+  unsigned long startAttempt = millis();
+
   // Use multiple servers for reliability
   configTime(ARMENIA_TZ_OFFSET, ARMENIA_DST_OFFSET,
              "pool.ntp.org", "time.nist.gov", "time.google.com");
 
-  // Wait up to 30 seconds — NTP can be slow on first connect
-  unsigned long startAttempt = millis();
-  while (time(nullptr) < 100000 && millis() - startAttempt < 30000) {
+  // Wait up to 30 seconds — NTP can be slow on first connect. A clock kept
+  // through deep sleep already looks valid, so only the SNTP client's own
+  // status says a server answered
+  bool synced = false;
+  while (millis() - startAttempt < 30000) {
+    if (sntp_get_sync_status() == SNTP_SYNC_STATUS_COMPLETED) {
+      synced = true;
+      break;
+    }
     delay(500);
     #if DEBUG
     Serial.print(".");
@@ -50,11 +65,18 @@ bool syncTime() {
   #endif
 
   time_t now = time(nullptr);
-  if (now < 100000) {
+  if (!synced || now < 100000) {
     logToSD("[TIME] ERROR: NTP sync failed after 30s");
     return false;
   }
 
-  logToSD("[TIME] Synced: " + timeToStr(now));
+  if (stepSec) {
+    struct timeval after;
+    gettimeofday(&after, nullptr);
+    double elapsed = (millis() - startAttempt) / 1000.0;
+    *stepSec = (after.tv_sec - before.tv_sec) + (after.tv_usec - before.tv_usec) / 1e6 - elapsed;
+  }
+
+  logToSDf("[TIME] Synced: %s", timeText(now).str);
   return true;
 }
@@ -4,5 +4,7 @@
 #include "rtc_utils.h"
 
 bool connectWiFi();
-bool syncTime();
+// Waits for the SNTP client to confirm a sync; stepSec (if given) gets how
+// far the sync moved the clock
+bool syncTime(double *stepSec = nullptr);
 void disconnectWiFi();
\ No newline at end of file